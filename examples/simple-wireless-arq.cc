@@ -0,0 +1,180 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This is a program to sweep the goodput of the link-layer ARQ of the
+// SimpleWirelessNetDevice against the packet error rate.
+//
+// A sender queues nPackets frames at once for a receiver 10 m away. The
+// channel loses each frame, data or ACK, with the constant ErrorRate of
+// the channel. For each error rate the program runs without ARQ, with
+// stop-and-wait ARQ and with selective repeat ARQ of window packets, and
+// prints the fraction of the frames delivered, the goodput (bytes passed
+// up by the receiver over the time to the last of them), the mean number
+// of retransmissions of a frame and the mean access delay of the
+// acknowledged frames:
+//
+//    ./ns3 run "simple-wireless-arq --window=8 --ackTimeout=500us"
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessArq");
+
+uint64_t g_rxPackets = 0;
+uint64_t g_rxBytes = 0;
+Time g_lastRx;
+uint64_t g_acked = 0;
+uint64_t g_done = 0;
+uint64_t g_retries = 0;
+Time g_accessDelay;
+
+void
+ReceiveTrace (Ptr<const Packet> p)
+{
+  g_rxPackets++;
+  g_rxBytes += p->GetSize ();
+  g_lastRx = Simulator::Now ();
+}
+
+void
+RetriesTrace (Ptr<const Packet> p, uint32_t retries)
+{
+  g_done++;
+  g_retries += retries;
+}
+
+void
+AccessDelayTrace (Ptr<const Packet> p, Time delay)
+{
+  g_acked++;
+  g_accessDelay += delay;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nPackets = 2000;
+  uint32_t packetSize = 1000;
+  DataRate dataRate ("6Mbps");
+  uint32_t window = 8;
+  uint32_t retryLimit = 7;
+  Time ackTimeout = MicroSeconds (500);
+  double maxErrorRate = 0.5;
+  double errorRateStep = 0.05;
+
+  CommandLine cmd;
+  cmd.AddValue ("nPackets", "number of frames sent for each run", nPackets);
+  cmd.AddValue ("packetSize", "frame size in bytes", packetSize);
+  cmd.AddValue ("dataRate", "data rate of the devices", dataRate);
+  cmd.AddValue ("window", "selective repeat window", window);
+  cmd.AddValue ("retryLimit", "retransmissions before a frame is dropped", retryLimit);
+  cmd.AddValue ("ackTimeout", "ACK timeout, from the end of a frame", ackTimeout);
+  cmd.AddValue ("maxErrorRate", "largest packet error rate", maxErrorRate);
+  cmd.AddValue ("errorRateStep", "packet error rate increment", errorRateStep);
+  cmd.Parse (argc, argv);
+
+  std::cout << std::setw (8) << "PER"
+            << std::setw (8) << "window"
+            << std::setw (12) << "delivered"
+            << std::setw (16) << "goodput(Mbps)"
+            << std::setw (10) << "retries"
+            << std::setw (18) << "access delay(ms)" << std::endl;
+  for (double errorRate = 0; errorRate <= maxErrorRate + 1e-9; errorRate += errorRateStep)
+    {
+      // window 0 runs without ARQ
+      uint32_t windows[] = {0, 1, window};
+      for (uint32_t w : windows)
+        {
+          g_rxPackets = 0;
+          g_rxBytes = 0;
+          g_lastRx = Seconds (0);
+          g_acked = 0;
+          g_done = 0;
+          g_retries = 0;
+          g_accessDelay = Seconds (0);
+          RngSeedManager::SetSeed (1);
+          RngSeedManager::SetRun (1);
+
+          NodeContainer nodes;
+          nodes.Create (2);
+          MobilityHelper mobility;
+          Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+          positions->Add (Vector (0, 0, 0));
+          positions->Add (Vector (10, 0, 0));
+          mobility.SetPositionAllocator (positions);
+          mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+          mobility.Install (nodes);
+
+          Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+          channel->SetAttribute ("MaxRange", DoubleValue (100));
+          channel->SetAttribute ("ErrorRate", DoubleValue (errorRate));
+
+          std::vector<Ptr<SimpleWirelessNetDevice> > devices;
+          for (uint32_t i = 0; i < 2; i++)
+            {
+              Ptr<Node> node = nodes.Get (i);
+              Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+              device->SetChannel (channel);
+              device->SetNode (node);
+              device->SetAddress (Mac48Address::Allocate ());
+              device->SetDataRate (dataRate);
+              device->SetAttribute ("Arq", BooleanValue (w > 0));
+              device->SetAttribute ("ArqWindowSize", UintegerValue (std::max (w, 1u)));
+              device->SetAttribute ("ArqRetryLimit", UintegerValue (retryLimit));
+              device->SetAttribute ("ArqAckTimeout", TimeValue (ackTimeout));
+              Ptr<DropTailQueue<Packet> > queue = CreateObject<DropTailQueue<Packet> > ();
+              queue->SetMaxSize (QueueSize (QueueSizeUnit::PACKETS, nPackets));
+              device->SetQueue (queue);
+              node->AddDevice (device);
+              devices.push_back (device);
+            }
+          devices[0]->TraceConnectWithoutContext ("ArqRetries", MakeCallback (&RetriesTrace));
+          devices[0]->TraceConnectWithoutContext ("ArqAccessDelay", MakeCallback (&AccessDelayTrace));
+          devices[1]->TraceConnectWithoutContext ("MacRx", MakeCallback (&ReceiveTrace));
+
+          Time start = Seconds (1);
+          for (uint32_t i = 0; i < nPackets; i++)
+            {
+              Simulator::Schedule (start, &SimpleWirelessNetDevice::Send, devices[0],
+                                   Create<Packet> (packetSize), devices[1]->GetAddress (), 1);
+            }
+          Simulator::Run ();
+          Simulator::Destroy ();
+
+          double duration = (g_lastRx - start).GetSeconds ();
+          std::cout << std::fixed << std::setprecision (2)
+                    << std::setw (8) << errorRate
+                    << std::setw (8) << w
+                    << std::setw (12) << std::setprecision (4) << static_cast<double> (g_rxPackets) / nPackets
+                    << std::setw (16) << std::setprecision (3) << (duration > 0 ? g_rxBytes * 8 / duration / 1e6 : 0)
+                    << std::setw (10) << (g_done ? static_cast<double> (g_retries) / g_done : 0)
+                    << std::setw (18) << (g_acked ? g_accessDelay.GetSeconds () * 1000 / g_acked : 0)
+                    << std::endl;
+        }
+    }
+  return 0;
+}
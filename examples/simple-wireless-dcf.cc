@@ -0,0 +1,358 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This is a program to validate the DCF MAC of SimpleWirelessNetDevice
+// against the single-bss-sld example, which runs the same scenario with
+// the full Wi-Fi module.
+//
+// nSld stations with the Dcf attribute enabled send uplink frames to an
+// access point. Frames arrive at each station as a Bernoulli process:
+// in every slot a frame arrives with probability perSldLambda (the
+// arrivals are drawn as geometric inter-arrival times, so that idle
+// slots cost nothing). The command line options have the same names and
+// meanings as those of single-bss-sld, with the data rate and the frame
+// overheads standing in for the MCS and the Wi-Fi PHY. The defaults
+// approximate EHT MCS 6 on 20 MHz with a 800 ns guard interval and the
+// AC_BE AIFS.
+//
+// After a warmup of 5 s, statistics are collected for simulationTime
+// and one line is appended to simple-wireless-dcf.dat with the same
+// first columns as the wifi-dcf.dat file of single-bss-sld:
+//
+//   success probability, throughput (Mbps), mean queueing delay (ms),
+//   mean access delay (ms), mean end to end delay (ms), rngRun,
+//   simulationTime, payloadSize, data rate (Mbps), nSld, perSldLambda,
+//   acBECwmin, acBECwStage
+//
+// The program also prints the results next to the Bianchi saturation
+// throughput for the same parameters, the wall clock time of the run and,
+// if wifiDat names a wifi-dcf.dat file, its last line for comparison:
+//
+//    ./ns3 run "single-bss-sld --nSld=10 --perSldLambda=0.01"
+//    ./ns3 run "simple-wireless-dcf --nSld=10 --perSldLambda=0.01 --wifiDat=wifi-dcf.dat"
+//
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessDcf");
+
+Time g_statsStart;
+Time g_statsEnd;
+uint64_t g_successes = 0;
+uint64_t g_attempts = 0;
+double g_queueDelayTotal = 0; // ms
+double g_accessDelayTotal = 0; // ms
+
+// enqueue times of the frames waiting at each station, oldest first
+std::vector<std::deque<Time> > g_enqueueTimes;
+
+bool
+InWindow (void)
+{
+  return Simulator::Now () >= g_statsStart && Simulator::Now () < g_statsEnd;
+}
+
+void
+Arrival (Ptr<SimpleWirelessNetDevice> device, uint32_t station, Mac48Address ap,
+         Ptr<UniformRandomVariable> uniform, double lambda, Time slot, uint32_t payloadSize)
+{
+  g_enqueueTimes[station].push_back (Simulator::Now ());
+  device->Send (Create<Packet> (payloadSize), ap, 1);
+
+  // number of slots to the next arrival
+  uint64_t slots = 1;
+  if (lambda < 1)
+    {
+      slots += static_cast<uint64_t> (std::floor (std::log (uniform->GetValue ()) / std::log (1 - lambda)));
+    }
+  Simulator::Schedule (slot * slots, &Arrival, device, station, ap, uniform, lambda, slot, payloadSize);
+}
+
+void
+TransmitTrace (Ptr<const Packet> p, Mac48Address from, Mac48Address to, uint16_t proto)
+{
+  if (InWindow ())
+    {
+      g_attempts++;
+    }
+}
+
+void
+AccessDelayTrace (uint32_t station, Ptr<const Packet> p, Time accessDelay)
+{
+  Time e2e = Simulator::Now () - g_enqueueTimes[station].front ();
+  g_enqueueTimes[station].pop_front ();
+  if (InWindow ())
+    {
+      g_successes++;
+      g_accessDelayTotal += accessDelay.GetSeconds () * 1000;
+      g_queueDelayTotal += (e2e - accessDelay).GetSeconds () * 1000;
+    }
+}
+
+void
+TxDropTrace (uint32_t station, Ptr<const Packet> p)
+{
+  // retry limit
+  g_enqueueTimes[station].pop_front ();
+}
+
+void
+QueueDropTrace (uint32_t station, Ptr<const Packet> p)
+{
+  // tail drop
+  g_enqueueTimes[station].pop_back ();
+}
+
+// Bianchi's fixed point for n saturated stations with minimum window W
+// and m backoff stages; returns the transmission probability per slot
+double
+BianchiTau (uint32_t n, double w, uint32_t m)
+{
+  double lo = 0;
+  double hi = 0.999;
+  double tau = 0;
+  for (int i = 0; i < 100; i++)
+    {
+      double p = (lo + hi) / 2;
+      tau = 2 * (1 - 2 * p) / ((1 - 2 * p) * (w + 1) + p * w * (1 - std::pow (2 * p, m)));
+      double pc = 1 - std::pow (1 - tau, n - 1);
+      if (pc > p)
+        {
+          lo = p;
+        }
+      else
+        {
+          hi = p;
+        }
+    }
+  return tau;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t rngRun = 6;
+  double simulationTime = 20; // seconds
+  uint32_t payloadSize = 1500;
+  uint32_t nSld = 5;
+  double perSldLambda = 0.00001;
+  uint64_t acBECwmin = 16;
+  uint32_t acBECwStage = 6;
+  DataRate dataRate ("77.4Mbps");
+  uint32_t macOverhead = 42; // QoS data header, LLC/SNAP, FCS and A-MPDU delimiter
+  Time phyHeader = MicroSeconds (48);
+  Time slot = MicroSeconds (9);
+  Time sifs = MicroSeconds (16);
+  Time difs = MicroSeconds (43); // AIFS of AC_BE
+  Time ackDuration = MicroSeconds (44);
+  uint32_t retryLimit = 7;
+  std::string wifiDat;
+
+  CommandLine cmd;
+  cmd.AddValue ("rngRun", "Seed for simulation", rngRun);
+  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("payloadSize", "Application payload size in Bytes", payloadSize);
+  cmd.AddValue ("nSld", "Number of SLD STAs on link 1", nSld);
+  cmd.AddValue ("perSldLambda", "Per node Bernoulli arrival rate of SLD STAs", perSldLambda);
+  cmd.AddValue ("acBECwmin", "Initial CW for AC_BE", acBECwmin);
+  cmd.AddValue ("acBECwStage", "Cutoff Stage for AC_BE", acBECwStage);
+  cmd.AddValue ("dataRate", "data rate of the frames", dataRate);
+  cmd.AddValue ("macOverhead", "bytes added to each payload by the MAC", macOverhead);
+  cmd.AddValue ("phyHeader", "duration of the preamble and PHY header", phyHeader);
+  cmd.AddValue ("slot", "slot time", slot);
+  cmd.AddValue ("sifs", "SIFS", sifs);
+  cmd.AddValue ("difs", "DIFS (AIFS)", difs);
+  cmd.AddValue ("ackDuration", "duration of an ACK", ackDuration);
+  cmd.AddValue ("retryLimit", "retransmissions before a frame is dropped", retryLimit);
+  cmd.AddValue ("wifiDat", "wifi-dcf.dat file written by single-bss-sld, to compare with", wifiDat);
+  cmd.Parse (argc, argv);
+  // the gap to the next arrival divides by log (1 - perSldLambda)
+  if (perSldLambda <= 0)
+    {
+      std::cerr << "perSldLambda must be positive" << std::endl;
+      return 1;
+    }
+
+  // Same contention windows as single-bss-sld
+  uint32_t cwMin = acBECwmin - 1;
+  uint32_t cwMax = acBECwmin * (1 << acBECwStage) - 1;
+
+  RngSeedManager::SetSeed (rngRun);
+  RngSeedManager::SetRun (rngRun);
+
+  NodeContainer nodes;
+  nodes.Create (nSld + 1);
+  // the access point at the center, the stations within a meter of it
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator", "rho", DoubleValue (1));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+  nodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 0));
+
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices;
+  g_enqueueTimes.resize (nSld + 1);
+  for (uint32_t i = 0; i <= nSld; i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+      device->SetChannel (channel);
+      device->SetNode (node);
+      device->SetAddress (Mac48Address::Allocate ());
+      device->SetDataRate (dataRate);
+      device->SetAttribute ("Dcf", BooleanValue (true));
+      device->SetAttribute ("DcfSlot", TimeValue (slot));
+      device->SetAttribute ("DcfSifs", TimeValue (sifs));
+      device->SetAttribute ("DcfDifs", TimeValue (difs));
+      device->SetAttribute ("DcfAckDuration", TimeValue (ackDuration));
+      device->SetAttribute ("DcfPhyHeader", TimeValue (phyHeader));
+      device->SetAttribute ("DcfCwMin", UintegerValue (cwMin));
+      device->SetAttribute ("DcfCwMax", UintegerValue (cwMax));
+      device->SetAttribute ("DcfRetryLimit", UintegerValue (retryLimit));
+      Ptr<DropTailQueue<Packet> > queue = CreateObject<DropTailQueue<Packet> > ();
+      queue->SetAttribute ("MaxSize", StringValue ("100000p"));
+      device->SetQueue (queue);
+      node->AddDevice (device);
+      devices.push_back (device);
+      if (i == 0)
+        {
+          continue;
+        }
+      device->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&TransmitTrace));
+      device->TraceConnectWithoutContext ("DcfAccessDelay", MakeBoundCallback (&AccessDelayTrace, i));
+      device->TraceConnectWithoutContext ("MacTxDrop", MakeBoundCallback (&TxDropTrace, i));
+      queue->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&QueueDropTrace, i));
+    }
+
+  Mac48Address ap = Mac48Address::ConvertFrom (devices[0]->GetAddress ());
+  Ptr<UniformRandomVariable> startTime = CreateObject<UniformRandomVariable> ();
+  startTime->SetAttribute ("Min", DoubleValue (0.1));
+  startTime->SetAttribute ("Max", DoubleValue (0.2));
+  for (uint32_t i = 1; i <= nSld; i++)
+    {
+      Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable> ();
+      // the (macOverhead) bytes of MAC header go over the air with the payload
+      Simulator::Schedule (Seconds (startTime->GetValue ()), &Arrival, devices[i], i, ap, uniform,
+                           perSldLambda, slot, payloadSize + macOverhead);
+    }
+
+  Time warmup = Seconds (5);
+  g_statsStart = warmup;
+  g_statsEnd = warmup + Seconds (simulationTime);
+  Simulator::Stop (g_statsEnd);
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+  uint64_t events = Simulator::GetEventCount ();
+  Simulator::Destroy ();
+
+  double succPr = g_attempts ? static_cast<double> (g_successes) / g_attempts : 0;
+  double throughput = static_cast<double> (g_successes) * payloadSize * 8 / simulationTime / 1000000;
+  double meanQueueDelay = g_successes ? g_queueDelayTotal / g_successes : 0;
+  double meanAccessDelay = g_successes ? g_accessDelayTotal / g_successes : 0;
+  double meanE2eDelay = meanQueueDelay + meanAccessDelay;
+
+  std::ofstream summary ("simple-wireless-dcf.dat", std::ofstream::app);
+  summary << succPr << ","
+          << throughput << ","
+          << meanQueueDelay << ","
+          << meanAccessDelay << ","
+          << meanE2eDelay << ","
+          << rngRun << ","
+          << simulationTime << ","
+          << payloadSize << ","
+          << dataRate.GetBitRate () / 1e6 << ","
+          << nSld << ","
+          << perSldLambda << ","
+          << acBECwmin << ","
+          << acBECwStage << "\n";
+  summary.close ();
+
+  // Bianchi saturation throughput, payload bits over the mean slot length
+  double frame = phyHeader.GetSeconds () + (payloadSize + macOverhead) * 8.0 / dataRate.GetBitRate ();
+  double ts = frame + sifs.GetSeconds () + ackDuration.GetSeconds () + difs.GetSeconds ();
+  double tc = ts; // the NAV of a collided frame gives the same wait (EIFS)
+  double tau = BianchiTau (nSld, cwMin + 1, acBECwStage);
+  double ptr = 1 - std::pow (1 - tau, nSld);
+  double ps = nSld * tau * std::pow (1 - tau, nSld - 1) / ptr;
+  double bianchi = ps * ptr * payloadSize * 8
+    / ((1 - ptr) * slot.GetSeconds () + ptr * ps * ts + ptr * (1 - ps) * tc) / 1000000;
+
+  double wallClock = std::chrono::duration<double> (end - begin).count ();
+  std::cout << std::fixed << std::setprecision (4);
+  std::cout << std::setw (26) << "" << std::setw (16) << "simple-wireless";
+  std::string wifiLine;
+  if (!wifiDat.empty ())
+    {
+      std::ifstream wifi (wifiDat.c_str ());
+      std::string line;
+      while (std::getline (wifi, line))
+        {
+          if (!line.empty ())
+            {
+              wifiLine = line;
+            }
+        }
+      if (wifiLine.empty ())
+        {
+          std::cerr << "No results in " << wifiDat << std::endl;
+        }
+      else
+        {
+          std::cout << std::setw (16) << "single-bss-sld";
+        }
+    }
+  std::cout << std::endl;
+
+  const char *names[] = { "success probability", "throughput (Mbps)", "queueing delay (ms)",
+                          "access delay (ms)", "end to end delay (ms)" };
+  double values[] = { succPr, throughput, meanQueueDelay, meanAccessDelay, meanE2eDelay };
+  std::istringstream wifiFields (wifiLine);
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      std::cout << std::setw (26) << std::left << names[i] << std::right << std::setw (16) << values[i];
+      std::string field;
+      if (!wifiLine.empty () && std::getline (wifiFields, field, ','))
+        {
+          std::cout << std::setw (16) << field;
+        }
+      std::cout << std::endl;
+    }
+  std::cout << std::setw (26) << std::left << "Bianchi saturation (Mbps)" << std::right
+            << std::setw (16) << bianchi << std::endl;
+  std::cout << std::setw (26) << std::left << "events" << std::right << std::setw (16) << events << std::endl;
+  std::cout << std::setw (26) << std::left << "wall clock (s)" << std::right << std::setw (16) << wallClock << std::endl;
+  return 0;
+}
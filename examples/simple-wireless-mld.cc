@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This is a program to compare the link selection policies of
+// SimpleWirelessMldNetDevice, in the two link scenario of single-bss-mld.
+//
+// nMldSta multi-link stations send uplink frames to a multi-link access
+// point.  Each device has one link on each of two channels, with the DCF
+// MAC enabled; the links of the second channel run at dataRate2.  Frames
+// arrive at each station as a Poisson process of rate mldPerNodeLambda
+// frames per second.  The policy option selects the link of each frame:
+//
+//   prob  link 1 with probability mldProbLink1, link 2 otherwise
+//   jsq   the link with the fewest bytes waiting
+//   eec   the link expected to finish sending the frame first
+//
+// The program prints, for each link, the share of the frames sent on it
+// and the throughput received by the access point, then the mean delay
+// from arrival at the station to reception at the access point:
+//
+//    ./ns3 run "simple-wireless-mld --policy=jsq --mldPerNodeLambda=2000"
+//
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+#include "ns3/simple-wireless-mld-net-device.h"
+#include "ns3/simple-wireless-link-selector.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessMld");
+
+std::map<uint64_t, Time> g_arrivalTime;
+uint64_t g_linkTx[2] = {0, 0};
+uint64_t g_linkRxBytes[2] = {0, 0};
+uint64_t g_numReceives = 0;
+Time g_totalDelay;
+
+void
+LinkTxTrace (Ptr<const Packet> p, uint32_t link)
+{
+  g_linkTx[link]++;
+}
+
+void
+LinkRxTrace (uint32_t link, Ptr<const Packet> p)
+{
+  g_linkRxBytes[link] += p->GetSize ();
+}
+
+void
+MacRxTrace (Ptr<const Packet> p)
+{
+  std::map<uint64_t, Time>::iterator it = g_arrivalTime.find (p->GetUid ());
+  if (it != g_arrivalTime.end ())
+    {
+      g_totalDelay += Simulator::Now () - it->second;
+      g_numReceives++;
+      g_arrivalTime.erase (it);
+    }
+}
+
+void
+Arrival (Ptr<SimpleWirelessMldNetDevice> device, Address dest, Ptr<ExponentialRandomVariable> interval,
+         uint32_t payloadSize, Time end)
+{
+  Ptr<Packet> p = Create<Packet> (payloadSize);
+  g_arrivalTime[p->GetUid ()] = Simulator::Now ();
+  device->Send (p, dest, 1);
+  Time next = Seconds (interval->GetValue ());
+  if (Simulator::Now () + next < end)
+    {
+      Simulator::Schedule (next, &Arrival, device, dest, interval, payloadSize, end);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nMldSta = 4;
+  double simulationTime = 10;
+  uint32_t payloadSize = 1500;
+  double mldPerNodeLambda = 1000;
+  double mldProbLink1 = 0.5;
+  DataRate dataRate ("68Mbps");
+  DataRate dataRate2 ("34Mbps");
+  std::string policy = "prob";
+  uint32_t rngRun = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nMldSta", "Number of MLD STAs", nMldSta);
+  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("payloadSize", "Application payload size in Bytes", payloadSize);
+  cmd.AddValue ("mldPerNodeLambda", "Per node arrival rate of MLD STAs, in frames per second", mldPerNodeLambda);
+  cmd.AddValue ("mldProbLink1", "MLD's splitting probability on link 1, for the prob policy", mldProbLink1);
+  cmd.AddValue ("dataRate", "Data rate of link 1", dataRate);
+  cmd.AddValue ("dataRate2", "Data rate of link 2", dataRate2);
+  cmd.AddValue ("policy", "Link selection policy: prob, jsq or eec", policy);
+  cmd.AddValue ("rngRun", "Seed for simulation", rngRun);
+  cmd.Parse (argc, argv);
+
+  RngSeedManager::SetSeed (1);
+  RngSeedManager::SetRun (rngRun);
+
+  NodeContainer nodes;
+  nodes.Create (nMldSta + 1);
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                 "rho", DoubleValue (10));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+  nodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 0));
+
+  Ptr<SimpleWirelessChannel> channels[2];
+  DataRate rates[2] = {dataRate, dataRate2};
+  for (uint32_t l = 0; l < 2; l++)
+    {
+      channels[l] = CreateObject<SimpleWirelessChannel> ();
+      channels[l]->SetAttribute ("MaxRange", DoubleValue (1000));
+    }
+
+  Time end = Seconds (simulationTime);
+  Address apAddress;
+  for (uint32_t i = 0; i <= nMldSta; i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<SimpleWirelessMldNetDevice> mld = CreateObject<SimpleWirelessMldNetDevice> ();
+      mld->SetAddress (Mac48Address::Allocate ());
+      for (uint32_t l = 0; l < 2; l++)
+        {
+          Ptr<SimpleWirelessNetDevice> link = CreateObject<SimpleWirelessNetDevice> ();
+          link->SetChannel (channels[l]);
+          link->SetDataRate (rates[l]);
+          link->SetAttribute ("Dcf", BooleanValue (true));
+          link->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+          mld->AddLink (link);
+          if (i == 0)
+            {
+              link->TraceConnectWithoutContext ("MacRx", MakeBoundCallback (&LinkRxTrace, l));
+            }
+        }
+      node->AddDevice (mld);
+      if (i == 0)
+        {
+          apAddress = mld->GetAddress ();
+          mld->TraceConnectWithoutContext ("MacRx", MakeCallback (&MacRxTrace));
+          continue;
+        }
+
+      if (policy == "prob")
+        {
+          Ptr<ProbabilisticLinkSelector> selector = CreateObject<ProbabilisticLinkSelector> ();
+          selector->SetWeights (std::vector<double> {mldProbLink1, 1 - mldProbLink1});
+          mld->SetLinkSelector (selector);
+        }
+      else if (policy == "jsq")
+        {
+          mld->SetLinkSelector (CreateObject<ShortestQueueLinkSelector> ());
+        }
+      else if (policy == "eec")
+        {
+          mld->SetLinkSelector (CreateObject<EarliestCompletionLinkSelector> ());
+        }
+      else
+        {
+          NS_FATAL_ERROR ("Unknown policy " << policy);
+        }
+      mld->TraceConnectWithoutContext ("LinkTx", MakeCallback (&LinkTxTrace));
+
+      Ptr<ExponentialRandomVariable> interval = CreateObject<ExponentialRandomVariable> ();
+      interval->SetAttribute ("Mean", DoubleValue (1 / mldPerNodeLambda));
+      Simulator::Schedule (Seconds (interval->GetValue ()), &Arrival, mld, apAddress, interval, payloadSize, end);
+    }
+
+  Simulator::Stop (end);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  uint64_t totalTx = g_linkTx[0] + g_linkTx[1];
+  std::cout << "policy " << policy << std::endl;
+  std::cout << std::setw (6) << "link"
+            << std::setw (12) << "share"
+            << std::setw (18) << "throughput (Mbps)" << std::endl;
+  for (uint32_t l = 0; l < 2; l++)
+    {
+      std::cout << std::setw (6) << l + 1
+                << std::setw (12) << std::fixed << std::setprecision (4)
+                << (totalTx ? static_cast<double> (g_linkTx[l]) / totalTx : 0)
+                << std::setw (18) << std::setprecision (2)
+                << g_linkRxBytes[l] * 8 / simulationTime / 1e6 << std::endl;
+    }
+  std::cout << "mean delay (ms) " << std::setprecision (3)
+            << (g_numReceives ? g_totalDelay.GetSeconds () * 1000 / g_numReceives : 0)
+            << std::endl;
+  return 0;
+}
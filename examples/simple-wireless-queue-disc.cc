@@ -0,0 +1,219 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This is a program to compare queue discs of the traffic control module
+// on SimpleWirelessNetDevices.
+//
+// nSta stations send UDP traffic at a constant rate of offeredLoad each
+// to an access point, over IPv4. The devices use the DCF MAC and a drop
+// tail TxQueue of deviceQueueSize packets. The queueDisc option selects
+// the root queue disc installed on every device:
+//
+//   pfifo_fast  ns3::PfifoFastQueueDisc
+//   pie         ns3::PieQueueDisc
+//   fq_codel    ns3::FqCoDelQueueDisc
+//
+// The queue disc holds the packets the device queue has no room for,
+// since the device stops its transmit queue while the device queue is
+// full; with bql, DynamicQueueLimits also bound the bytes waiting in the
+// device queue. The program prints the throughput received by the access
+// point, the packets dropped by the queue discs and by the devices, and
+// the mean time the packets spent in the queue discs and in the device
+// queues:
+//
+//    ./ns3 run "simple-wireless-queue-disc --queueDisc=pie --bql=1"
+//
+
+#include <iomanip>
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessQueueDisc");
+
+uint64_t g_qdiscPackets = 0;
+Time g_qdiscSojourn;
+uint64_t g_devicePackets = 0;
+Time g_deviceLatency;
+uint64_t g_deviceDrops = 0;
+
+void
+SojournTrace (Time sojourn)
+{
+  g_qdiscPackets++;
+  g_qdiscSojourn += sojourn;
+}
+
+void
+QueueLatencyTrace (Ptr<const Packet> p, Time latency)
+{
+  g_devicePackets++;
+  g_deviceLatency += latency;
+}
+
+void
+MacTxDropTrace (Ptr<const Packet> p)
+{
+  g_deviceDrops++;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nSta = 4;
+  double simulationTime = 10;
+  uint32_t payloadSize = 1400;
+  DataRate dataRate ("54Mbps");
+  DataRate offeredLoad ("20Mbps");
+  std::string queueDisc = "fq_codel";
+  uint32_t deviceQueueSize = 10;
+  bool bql = false;
+  uint32_t rngRun = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nSta", "Number of stations", nSta);
+  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("payloadSize", "UDP payload size in Bytes", payloadSize);
+  cmd.AddValue ("dataRate", "Data rate of the devices", dataRate);
+  cmd.AddValue ("offeredLoad", "Rate at which each station sends", offeredLoad);
+  cmd.AddValue ("queueDisc", "Root queue disc: pfifo_fast, pie or fq_codel", queueDisc);
+  cmd.AddValue ("deviceQueueSize", "Packets in the TxQueue of the devices", deviceQueueSize);
+  cmd.AddValue ("bql", "Enable byte queue limits", bql);
+  cmd.AddValue ("rngRun", "Seed for simulation", rngRun);
+  cmd.Parse (argc, argv);
+
+  RngSeedManager::SetSeed (1);
+  RngSeedManager::SetRun (rngRun);
+
+  NodeContainer nodes;
+  nodes.Create (nSta + 1);
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                 "rho", DoubleValue (10));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+  nodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 0));
+
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  NetDeviceContainer devices;
+  for (uint32_t i = 0; i <= nSta; i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+      device->SetChannel (channel);
+      device->SetNode (node);
+      device->SetAddress (Mac48Address::Allocate ());
+      device->SetDataRate (dataRate);
+      device->SetAttribute ("Dcf", BooleanValue (true));
+      Ptr<DropTailQueue<Packet> > queue = CreateObject<DropTailQueue<Packet> > ();
+      queue->SetMaxSize (QueueSize (QueueSizeUnit::PACKETS, deviceQueueSize));
+      device->SetQueue (queue);
+      device->TraceConnectWithoutContext ("QueueLatency", MakeCallback (&QueueLatencyTrace));
+      device->TraceConnectWithoutContext ("MacTxDrop", MakeCallback (&MacTxDropTrace));
+      node->AddDevice (device);
+      devices.Add (device);
+    }
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  // Installed before the addresses are assigned, which would otherwise
+  // install the default queue disc
+  TrafficControlHelper tch;
+  if (queueDisc == "pfifo_fast")
+    {
+      tch.SetRootQueueDisc ("ns3::PfifoFastQueueDisc");
+    }
+  else if (queueDisc == "pie")
+    {
+      tch.SetRootQueueDisc ("ns3::PieQueueDisc");
+    }
+  else if (queueDisc == "fq_codel")
+    {
+      tch.SetRootQueueDisc ("ns3::FqCoDelQueueDisc");
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown queue disc " << queueDisc);
+    }
+  if (bql)
+    {
+      tch.SetQueueLimits ("ns3::DynamicQueueLimits");
+    }
+  QueueDiscContainer qdiscs = tch.Install (devices);
+  for (uint32_t i = 0; i < qdiscs.GetN (); i++)
+    {
+      qdiscs.Get (i)->TraceConnectWithoutContext ("SojournTime", MakeCallback (&SojournTrace));
+    }
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = ipv4.Assign (devices);
+
+  uint16_t port = 9;
+  PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  ApplicationContainer sinkApp = sinkHelper.Install (nodes.Get (0));
+  sinkApp.Start (Seconds (0));
+
+  OnOffHelper onOff ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (0), port));
+  onOff.SetConstantRate (offeredLoad, payloadSize);
+  ApplicationContainer clientApps;
+  for (uint32_t i = 1; i <= nSta; i++)
+    {
+      clientApps.Add (onOff.Install (nodes.Get (i)));
+    }
+  clientApps.Start (Seconds (1));
+  clientApps.Stop (Seconds (1 + simulationTime));
+
+  Simulator::Stop (Seconds (1 + simulationTime));
+  Simulator::Run ();
+
+  uint64_t rxBytes = DynamicCast<PacketSink> (sinkApp.Get (0))->GetTotalRx ();
+  uint64_t qdiscDrops = 0;
+  for (uint32_t i = 0; i < qdiscs.GetN (); i++)
+    {
+      qdiscDrops += qdiscs.Get (i)->GetStats ().nTotalDroppedPackets;
+    }
+  Simulator::Destroy ();
+
+  std::cout << "queue disc " << queueDisc << (bql ? " with BQL" : "") << std::endl;
+  std::cout << std::fixed << std::setprecision (2);
+  std::cout << std::setw (34) << std::left << "throughput (Mbps)" << std::right << std::setw (12)
+            << rxBytes * 8 / simulationTime / 1e6 << std::endl;
+  std::cout << std::setw (34) << std::left << "queue disc drops" << std::right << std::setw (12)
+            << qdiscDrops << std::endl;
+  std::cout << std::setw (34) << std::left << "device drops" << std::right << std::setw (12)
+            << g_deviceDrops << std::endl;
+  std::cout << std::setprecision (3);
+  std::cout << std::setw (34) << std::left << "mean queue disc sojourn (ms)" << std::right << std::setw (12)
+            << (g_qdiscPackets ? g_qdiscSojourn.GetSeconds () * 1000 / g_qdiscPackets : 0) << std::endl;
+  std::cout << std::setw (34) << std::left << "mean device queue latency (ms)" << std::right << std::setw (12)
+            << (g_devicePackets ? g_deviceLatency.GetSeconds () * 1000 / g_devicePackets : 0) << std::endl;
+  return 0;
+}
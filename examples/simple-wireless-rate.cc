@@ -0,0 +1,221 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This is a program to sweep the throughput of the SimpleWirelessNetDevice
+// against distance, at a fixed rate and with rate adaptation.
+//
+// A sender queues nPackets frames at once for a receiver, over a log
+// distance loss model (exponent 3), with stop-and-wait ARQ. The MCS table
+// has five rates, of 6, 12, 24, 36 and 54 Mbps; the PER of a frame of
+// packetSize bytes at each rate is that of BPSK at an SNR lower by 0, 3,
+// 9, 13 and 19 dB. For each distance the program prints the SNR and the
+// goodput (bytes passed up by the receiver over the time to the last of
+// them) at the lowest rate with no rate manager, and with the oracle
+// (at a target PER of targetPer), ARF, AARF and Minstrel rate managers:
+//
+//    ./ns3 run "simple-wireless-rate --maxDistance=120 --targetPer=0.05"
+//
+
+#include <iomanip>
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+#include "ns3/simple-wireless-rate-manager.h"
+#include "ns3/snr-per-error-model.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessRate");
+
+uint64_t g_rxBytes = 0;
+Time g_lastRx;
+
+void
+ReceiveTrace (Ptr<const Packet> p)
+{
+  g_rxBytes += p->GetSize ();
+  g_lastRx = Simulator::Now ();
+}
+
+/**
+ * PER of a frame of the given size at an MCS, BPSK shifted by an SNR
+ * offset, tabulated every 0.5 dB
+ */
+Ptr<SnrPerErrorModel>
+CreatePerModel (double offset, uint32_t bytes)
+{
+  Ptr<BpskSnrPerErrorModel> bpsk = CreateObject<BpskSnrPerErrorModel> ();
+  Ptr<TableSnrPerErrorModel> table = CreateObject<TableSnrPerErrorModel> ();
+  for (double snr = -10; snr <= 50; snr += 0.5)
+    {
+      table->AddValue (snr, bpsk->Receive (snr - offset, bytes));
+    }
+  return table;
+}
+
+void
+AddMcsTable (Ptr<SimpleWirelessRateManager> manager, uint32_t bytes)
+{
+  const char *rates[] = {"6Mbps", "12Mbps", "24Mbps", "36Mbps", "54Mbps"};
+  double offsets[] = {0, 3, 9, 13, 19};
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      manager->AddMcs (DataRate (rates[i]), CreatePerModel (offsets[i], bytes));
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nPackets = 2000;
+  uint32_t packetSize = 1000;
+  double transmitPower = 16; // dBm
+  double noisePower = -100; // dBm
+  double minDistance = 10;
+  double maxDistance = 100;
+  double distanceStep = 10;
+  double targetPer = 0.1;
+
+  CommandLine cmd;
+  cmd.AddValue ("nPackets", "number of frames sent for each run", nPackets);
+  cmd.AddValue ("packetSize", "frame size in bytes", packetSize);
+  cmd.AddValue ("transmitPower", "transmit power in dBm", transmitPower);
+  cmd.AddValue ("noisePower", "noise power in dBm", noisePower);
+  cmd.AddValue ("minDistance", "smallest distance between the nodes, in meters", minDistance);
+  cmd.AddValue ("maxDistance", "largest distance between the nodes, in meters", maxDistance);
+  cmd.AddValue ("distanceStep", "distance increment, in meters", distanceStep);
+  cmd.AddValue ("targetPer", "TargetPer of the oracle", targetPer);
+  cmd.Parse (argc, argv);
+
+  // an empty type runs at the lowest rate without a rate manager
+  const char *managers[] = {"", "ns3::OracleRateManager", "ns3::ArfRateManager",
+                            "AARF", "ns3::MinstrelRateManager"};
+  std::cout << std::setw (10) << "distance"
+            << std::setw (8) << "SNR"
+            << std::setw (10) << "fixed"
+            << std::setw (10) << "oracle"
+            << std::setw (10) << "ARF"
+            << std::setw (10) << "AARF"
+            << std::setw (10) << "Minstrel"
+            << "  (goodput, Mbps)" << std::endl;
+  for (double distance = minDistance; distance <= maxDistance + 1e-9; distance += distanceStep)
+    {
+      Ptr<LogDistancePropagationLossModel> lossModel = CreateObject<LogDistancePropagationLossModel> ();
+      lossModel->SetPathLossExponent (3);
+      Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+      Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+      b->SetPosition (Vector (distance, 0, 0));
+      double snr = lossModel->CalcRxPower (transmitPower, a, b) - noisePower;
+      std::cout << std::fixed << std::setprecision (1)
+                << std::setw (10) << distance
+                << std::setw (8) << snr << std::setprecision (3);
+
+      for (const char *type : managers)
+        {
+          g_rxBytes = 0;
+          g_lastRx = Seconds (0);
+          RngSeedManager::SetSeed (1);
+          RngSeedManager::SetRun (1);
+
+          NodeContainer nodes;
+          nodes.Create (2);
+          MobilityHelper mobility;
+          Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+          positions->Add (Vector (0, 0, 0));
+          positions->Add (Vector (distance, 0, 0));
+          mobility.SetPositionAllocator (positions);
+          mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+          mobility.Install (nodes);
+
+          Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+          channel->SetAttribute ("MaxRange", DoubleValue (10 * maxDistance));
+          lossModel = CreateObject<LogDistancePropagationLossModel> ();
+          lossModel->SetPathLossExponent (3);
+          channel->AddPropagationLossModel (lossModel);
+
+          std::vector<Ptr<SimpleWirelessNetDevice> > devices;
+          for (uint32_t i = 0; i < 2; i++)
+            {
+              Ptr<Node> node = nodes.Get (i);
+              Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+              device->SetChannel (channel);
+              device->SetNode (node);
+              device->SetAddress (Mac48Address::Allocate ());
+              device->SetAttribute ("TxPower", DoubleValue (transmitPower));
+              device->SetNoisePower (noisePower);
+              device->SetAttribute ("Arq", BooleanValue (true));
+              Ptr<DropTailQueue<Packet> > queue = CreateObject<DropTailQueue<Packet> > ();
+              queue->SetMaxSize (QueueSize (QueueSizeUnit::PACKETS, nPackets));
+              device->SetQueue (queue);
+              std::string managerType = type;
+              if (managerType.empty ())
+                {
+                  device->SetDataRate (DataRate ("6Mbps"));
+                  device->SetSnrPerErrorModel (CreatePerModel (0, packetSize));
+                }
+              else
+                {
+                  // The receiver only needs the MCS table
+                  Ptr<SimpleWirelessRateManager> manager;
+                  if (i == 1)
+                    {
+                      manager = CreateObject<OracleRateManager> ();
+                    }
+                  else if (managerType == "AARF")
+                    {
+                      manager = CreateObject<ArfRateManager> ();
+                      manager->SetAttribute ("Adaptive", BooleanValue (true));
+                    }
+                  else
+                    {
+                      ObjectFactory factory;
+                      factory.SetTypeId (managerType);
+                      if (managerType == "ns3::OracleRateManager")
+                        {
+                          factory.Set ("TargetPer", DoubleValue (targetPer));
+                        }
+                      manager = factory.Create<SimpleWirelessRateManager> ();
+                    }
+                  AddMcsTable (manager, packetSize);
+                  device->SetRateManager (manager);
+                }
+              node->AddDevice (device);
+              devices.push_back (device);
+            }
+          devices[1]->TraceConnectWithoutContext ("MacRx", MakeCallback (&ReceiveTrace));
+
+          Time start = Seconds (1);
+          for (uint32_t i = 0; i < nPackets; i++)
+            {
+              Simulator::Schedule (start, &SimpleWirelessNetDevice::Send, devices[0],
+                                   Create<Packet> (packetSize), devices[1]->GetAddress (), 1);
+            }
+          Simulator::Run ();
+          Simulator::Destroy ();
+
+          double duration = (g_lastRx - start).GetSeconds ();
+          std::cout << std::setw (10) << (duration > 0 ? g_rxBytes * 8 / duration / 1e6 : 0);
+        }
+      std::cout << std::endl;
+    }
+  return 0;
+}
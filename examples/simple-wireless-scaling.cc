@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This is a program to benchmark the cost of SimpleWirelessChannel::Send
+// as the number of devices on the channel grows.
+//
+// N stationary nodes are placed uniformly at random in a square whose
+// side grows with sqrt(N), so that the number of nodes within MaxRange
+// of a sender stays roughly constant.  Every node broadcasts packets at
+// random times; no queue is used so each packet goes straight to the
+// channel.  The scenario is run for each N with the default channel
+// and with the selected optimizations (spatial index, link budget cache,
+// geometry kernels, batched delivery), and the program prints the wall clock cost per
+// channel Send, the number of simulator events and the event rate, along
+// with a checksum of all receptions so that the two runs can be compared
+// for identical results.  Note that a non-zero batchResolution rounds the
+// propagation delays, so the checksums are then expected to differ.
+//
+//    ./ns3 run "simple-wireless-scaling --maxNodes=4000"
+//    ./ns3 run "simple-wireless-scaling --maxNodes=4000 --linkCache=1"
+//    ./ns3 run "simple-wireless-scaling --index=0 --batch=1 --batchResolution=1us"
+//    ./ns3 run "simple-wireless-scaling --index=0 --kernels=1 --nodesInRange=200"
+//
+// The base run uses the generic send pipeline, which checks the error
+// model and loss model for every receiver; the optimized run uses the
+// version specialized for them unless --specialized=0.  To measure the
+// specialized pipeline on its own:
+//
+//    ./ns3 run "simple-wireless-scaling --index=0 --nodesInRange=200"
+//
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <cmath>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessScaling");
+
+uint64_t g_numSends = 0;
+uint64_t g_numReceives = 0;
+uint64_t g_rxChecksum = 0;
+
+void
+TransmitTrace (Ptr<const Packet> p, Mac48Address from, Mac48Address to, uint16_t proto)
+{
+  g_numSends++;
+}
+
+void
+ReceiveTrace (uint32_t nodeId, Ptr<const Packet> p, double rxPower, Mac48Address from)
+{
+  g_numReceives++;
+  // order dependent hash of (time, receiver, rx power) so any difference
+  // in the delivered set or delivery order shows up
+  g_rxChecksum = g_rxChecksum * 1000003 + Simulator::Now ().GetNanoSeconds () * 31 + nodeId * 7
+    + static_cast<int64_t> (rxPower * 1e6);
+}
+
+void
+SendBroadcast (Ptr<SimpleWirelessNetDevice> device, uint32_t packetSize)
+{
+  device->Send (Create<Packet> (packetSize), device->GetBroadcast (), 1);
+}
+
+struct RunConfig
+{
+  bool spatialIndex;
+  bool linkCache;
+  bool kernels;
+  bool batch;
+  Time batchResolution;
+  bool specialized;
+};
+
+struct RunResult
+{
+  double usPerSend;
+  double eventsPerSec;
+  uint64_t events;
+  uint64_t sends;
+  uint64_t receives;
+  uint64_t checksum;
+};
+
+RunResult
+RunOnce (uint32_t nNodes, const RunConfig &config, double range, double nodesInRange,
+         uint32_t packetsPerNode, uint32_t packetSize)
+{
+  g_numSends = 0;
+  g_numReceives = 0;
+  g_rxChecksum = 0;
+
+  // Same seed for both runs so the placement and send times match
+  RngSeedManager::SetSeed (1);
+  RngSeedManager::SetRun (nNodes);
+
+  NodeContainer nodes;
+  nodes.Create (nNodes);
+
+  // side of the square such that about nodesInRange nodes are within range
+  double side = std::sqrt (nNodes * M_PI * range * range / nodesInRange);
+  MobilityHelper mobility;
+  std::ostringstream sideStr;
+  sideStr << "ns3::UniformRandomVariable[Min=0.0|Max=" << side << "]";
+  mobility.SetPositionAllocator ("ns3::RandomRectanglePositionAllocator",
+                                 "X", StringValue (sideStr.str ()),
+                                 "Y", StringValue (sideStr.str ()));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (range));
+  channel->AddPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+  if (config.spatialIndex)
+    {
+      channel->EnableSpatialIndex ();
+    }
+  if (config.linkCache)
+    {
+      channel->EnableLinkCache ();
+    }
+  if (config.kernels)
+    {
+      channel->EnableGeometryKernels ();
+    }
+  channel->SetAttribute ("EnableSpecializedSend", BooleanValue (config.specialized));
+  if (config.batch)
+    {
+      channel->EnableBatchDelivery ();
+      channel->SetAttribute ("BatchDeliveryResolution", TimeValue (config.batchResolution));
+    }
+
+  Ptr<UniformRandomVariable> startTime = CreateObject<UniformRandomVariable> ();
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+      device->SetChannel (channel);
+      device->SetNode (node);
+      device->SetAddress (Mac48Address::Allocate ());
+      device->SetDataRate (DataRate ("100Mbps"));
+      device->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&TransmitTrace));
+      device->TraceConnectWithoutContext ("PhyRxBegin", MakeBoundCallback (&ReceiveTrace, node->GetId ()));
+      node->AddDevice (device);
+      for (uint32_t j = 0; j < packetsPerNode; j++)
+        {
+          Simulator::Schedule (Seconds (startTime->GetValue (0, 1)), &SendBroadcast, device, packetSize);
+        }
+    }
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+  uint64_t events = Simulator::GetEventCount ();
+  Simulator::Destroy ();
+
+  RunResult result;
+  double us = std::chrono::duration<double, std::micro> (end - begin).count ();
+  result.usPerSend = us / g_numSends;
+  result.events = events;
+  result.eventsPerSec = events / (us * 1e-6);
+  result.sends = g_numSends;
+  result.receives = g_numReceives;
+  result.checksum = g_rxChecksum;
+  return result;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t minNodes = 250;
+  uint32_t maxNodes = 4000;
+  double range = 100; // meters
+  double nodesInRange = 20;
+  uint32_t packetsPerNode = 10;
+  uint32_t packetSize = 200;
+  bool spatialIndex = true;
+  bool linkCache = false;
+  bool kernels = false;
+  bool batch = false;
+  Time batchResolution = Seconds (0);
+  bool specialized = true;
+
+  CommandLine cmd;
+  cmd.AddValue ("minNodes", "smallest number of nodes; doubled until maxNodes", minNodes);
+  cmd.AddValue ("maxNodes", "largest number of nodes", maxNodes);
+  cmd.AddValue ("range", "MaxRange of the channel in meters", range);
+  cmd.AddValue ("nodesInRange", "average number of nodes within range of a sender", nodesInRange);
+  cmd.AddValue ("packetsPerNode", "number of broadcasts sent by each node", packetsPerNode);
+  cmd.AddValue ("packetSize", "packet size in bytes", packetSize);
+  cmd.AddValue ("index", "enable the spatial index in the optimized run", spatialIndex);
+  cmd.AddValue ("linkCache", "enable the link budget cache in the optimized run", linkCache);
+  cmd.AddValue ("kernels", "enable the geometry kernels in the optimized run", kernels);
+  cmd.AddValue ("batch", "enable batched delivery in the optimized run", batch);
+  cmd.AddValue ("batchResolution", "propagation delay resolution for batched delivery", batchResolution);
+  cmd.AddValue ("specialized", "use the specialized send pipeline in the optimized run", specialized);
+  cmd.Parse (argc, argv);
+
+  RunConfig baseConfig = { false, false, false, false, Seconds (0), false };
+  RunConfig optConfig = { spatialIndex, linkCache, kernels, batch, batchResolution, specialized };
+
+  std::cout << std::setw (8) << "nodes"
+            << std::setw (12) << "sends"
+            << std::setw (12) << "receives"
+            << std::setw (14) << "base us/send"
+            << std::setw (14) << "opt us/send"
+            << std::setw (10) << "speedup"
+            << std::setw (13) << "base events"
+            << std::setw (13) << "opt events"
+            << std::setw (13) << "base Mev/s"
+            << std::setw (13) << "opt Mev/s"
+            << std::setw (8) << "match" << std::endl;
+  for (uint32_t n = minNodes; n <= maxNodes; n *= 2)
+    {
+      RunResult base = RunOnce (n, baseConfig, range, nodesInRange, packetsPerNode, packetSize);
+      RunResult opt = RunOnce (n, optConfig, range, nodesInRange, packetsPerNode, packetSize);
+      bool match = (base.sends == opt.sends) && (base.receives == opt.receives)
+        && (base.checksum == opt.checksum);
+      std::cout << std::setw (8) << n
+                << std::setw (12) << base.sends
+                << std::setw (12) << base.receives
+                << std::setw (14) << std::fixed << std::setprecision (2) << base.usPerSend
+                << std::setw (14) << opt.usPerSend
+                << std::setw (10) << base.usPerSend / opt.usPerSend
+                << std::setw (13) << base.events
+                << std::setw (13) << opt.events
+                << std::setw (13) << base.eventsPerSec * 1e-6
+                << std::setw (13) << opt.eventsPerSec * 1e-6
+                << std::setw (8) << (match ? "yes" : "NO") << std::endl;
+    }
+  return 0;
+}
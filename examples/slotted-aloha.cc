@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This is a program to sweep the throughput of slotted aloha against the
+// offered load.
+//
+// nStations nodes with SlottedAloha enabled are placed around a sink node,
+// all within range of each other.  Frames arrive at each station as a
+// Poisson process and wait in the station's queue for the start of the
+// next slot of the channel.  The frame size and data rate are chosen so
+// that a frame takes exactly one slot.  The sink counts the frames it
+// receives without a collision.  For each offered load G (frames per
+// slot, over all stations) the program prints the measured throughput S
+// (frames per slot received by the sink), the classical G exp(-G), and
+// the number of simulator events per slot.
+//
+//    ./ns3 run "slotted-aloha --nStations=100 --slots=20000"
+//
+
+#include <iomanip>
+#include <iostream>
+#include <cmath>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SlottedAloha");
+
+uint64_t g_numReceives = 0;
+
+void
+ReceiveTrace (Ptr<const Packet> p, double rxPower, Mac48Address from)
+{
+  g_numReceives++;
+}
+
+void
+Arrival (Ptr<SimpleWirelessNetDevice> device, Ptr<ExponentialRandomVariable> interval,
+         uint32_t packetSize, Time end)
+{
+  device->Send (Create<Packet> (packetSize), device->GetBroadcast (), 1);
+  Time next = Seconds (interval->GetValue ());
+  if (Simulator::Now () + next < end)
+    {
+      Simulator::Schedule (next, &Arrival, device, interval, packetSize, end);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nStations = 50;
+  uint32_t slots = 10000;
+  uint32_t packetSize = 1000;
+  Time slot = MilliSeconds (1);
+  double minLoad = 0.25;
+  double maxLoad = 3.0;
+  double loadStep = 0.25;
+
+  CommandLine cmd;
+  cmd.AddValue ("nStations", "number of transmitting stations", nStations);
+  cmd.AddValue ("slots", "number of slots simulated for each load", slots);
+  cmd.AddValue ("packetSize", "frame size in bytes", packetSize);
+  cmd.AddValue ("slot", "slot duration", slot);
+  cmd.AddValue ("minLoad", "smallest offered load, in frames per slot", minLoad);
+  cmd.AddValue ("maxLoad", "largest offered load, in frames per slot", maxLoad);
+  cmd.AddValue ("loadStep", "offered load increment", loadStep);
+  cmd.Parse (argc, argv);
+
+  // one frame per slot
+  DataRate rate (static_cast<uint64_t> (packetSize * 8 / slot.GetSeconds ()));
+
+  std::cout << std::setw (8) << "G"
+            << std::setw (12) << "S"
+            << std::setw (12) << "G*exp(-G)"
+            << std::setw (14) << "events/slot" << std::endl;
+  for (double load = minLoad; load <= maxLoad + 1e-9; load += loadStep)
+    {
+      g_numReceives = 0;
+      RngSeedManager::SetSeed (1);
+      RngSeedManager::SetRun (1);
+
+      NodeContainer nodes;
+      nodes.Create (nStations + 1);
+
+      // the sink at the center, the stations within 50 m of it, so that the
+      // propagation delays differ by less than the receiver processing delay
+      MobilityHelper mobility;
+      mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                     "rho", DoubleValue (50));
+      mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+      mobility.Install (nodes);
+      nodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 0));
+
+      Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+      channel->SetAttribute ("MaxRange", DoubleValue (1000));
+      channel->SetAttribute ("SlotDuration", TimeValue (slot));
+
+      Time end = slot * slots;
+      for (uint32_t i = 0; i <= nStations; i++)
+        {
+          Ptr<Node> node = nodes.Get (i);
+          Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+          device->SetChannel (channel);
+          device->SetNode (node);
+          device->SetAddress (Mac48Address::Allocate ());
+          device->SetDataRate (rate);
+          device->SetAttribute ("SlottedAloha", BooleanValue (true));
+          device->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+          node->AddDevice (device);
+          if (i == 0)
+            {
+              device->TraceConnectWithoutContext ("PhyRxBegin", MakeCallback (&ReceiveTrace));
+              continue;
+            }
+          Ptr<ExponentialRandomVariable> interval = CreateObject<ExponentialRandomVariable> ();
+          interval->SetAttribute ("Mean", DoubleValue (slot.GetSeconds () * nStations / load));
+          Simulator::Schedule (Seconds (interval->GetValue ()), &Arrival, device, interval, packetSize, end);
+        }
+
+      Simulator::Stop (end);
+      Simulator::Run ();
+      uint64_t events = Simulator::GetEventCount ();
+      Simulator::Destroy ();
+
+      double throughput = static_cast<double> (g_numReceives) / slots;
+      std::cout << std::setw (8) << std::fixed << std::setprecision (2) << load
+                << std::setw (12) << std::setprecision (4) << throughput
+                << std::setw (12) << load * std::exp (-load)
+                << std::setw (14) << std::setprecision (1) << static_cast<double> (events) / slots
+                << std::endl;
+    }
+  return 0;
+}
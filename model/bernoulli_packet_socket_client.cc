@@ -22,6 +22,7 @@
 
 #include "ns3/abort.h"
 #include "ns3/log.h"
+#include "ns3/node.h"
 #include "ns3/nstime.h"
 #include "ns3/packet-socket-address.h"
 #include "ns3/packet-socket-factory.h"
@@ -54,7 +55,8 @@ BernoulliPacketSocketClient::GetTypeId()
            .AddConstructor<BernoulliPacketSocketClient>()
            .AddAttribute(
                "MaxPackets",
-               "The maximum number of packets the application will send (zero means infinite)",
+               "The maximum number of packets the application will offer, including those skipped "
+               "because the device queue is stopped (zero means infinite)",
                UintegerValue(100),
                MakeUintegerAccessor(&BernoulliPacketSocketClient::m_maxPackets),
                MakeUintegerChecker<uint32_t>())
@@ -95,7 +97,11 @@ BernoulliPacketSocketClient::GetTypeId()
            .AddTraceSource("Tx",
                            "A packet has been sent",
                            MakeTraceSourceAccessor(&BernoulliPacketSocketClient::m_txTrace),
-                           "ns3::Packet::AddressTracedCallback");
+                           "ns3::Packet::AddressTracedCallback")
+           .AddTraceSource("Skipped",
+                           "Number of packets not sent because the device queue was stopped",
+                           MakeTraceSourceAccessor(&BernoulliPacketSocketClient::m_skipped),
+                           "ns3::TracedValueCallback::Uint32");
    return tid;
 }
 
@@ -103,6 +109,7 @@ BernoulliPacketSocketClient::BernoulliPacketSocketClient()
 {
    NS_LOG_FUNCTION(this);
    m_sent = 0;
+   m_skipped = 0;
    m_socket = nullptr;
    m_sendEvent = EventId();
    m_peerAddressSet = false;
@@ -131,6 +138,7 @@ void
 BernoulliPacketSocketClient::DoDispose()
 {
    NS_LOG_FUNCTION(this);
+   m_queueInterface = nullptr;
    Application::DoDispose();
 }
 
@@ -168,6 +176,12 @@ BernoulliPacketSocketClient::StartApplication()
        {
            m_socket->SetPriority(m_priority);
        }
+
+       if (m_peerAddress.IsSingleDevice())
+       {
+           Ptr<NetDevice> device = GetNode()->GetDevice(m_peerAddress.GetSingleDevice());
+           m_queueInterface = device->GetObject<NetDeviceQueueInterface>();
+       }
    }
 
    m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
@@ -188,6 +202,55 @@ BernoulliPacketSocketClient::Send()
    NS_LOG_FUNCTION(this);
    NS_ASSERT(m_sendEvent.IsExpired());
 
+   // The device would drop the packet, so do not bother creating it
+   if (IsDeviceQueueStopped())
+   {
+       NS_LOG_INFO("Device queue stopped, skipping a packet");
+       m_skipped++;
+   }
+   else
+   {
+       SendPacket();
+   }
+   m_sent++;
+
+    // sample a geometric random number from uniform distribution
+   // which is the inter-arrival time
+    double uniform = m_uniformRngForInterval->GetValue();
+    NS_ASSERT(m_bernoulliPr < 1);
+    double numInterval = std::floor(std::log(uniform) / std::log(1 - m_bernoulliPr)) + 1;
+    NS_ASSERT(numInterval > 0);
+    Time interval = numInterval * m_timeSlot;
+
+   if ((m_sent < m_maxPackets) || (m_maxPackets == 0))
+   {
+       m_sendEvent = Simulator::Schedule(interval, &BernoulliPacketSocketClient::Send, this);
+   }
+}
+
+bool
+BernoulliPacketSocketClient::IsDeviceQueueStopped() const
+{
+   if (!m_queueInterface)
+   {
+       return false;
+   }
+   // A queue of another priority may still take the packet
+   for (std::size_t i = 0; i < m_queueInterface->GetNTxQueues(); i++)
+   {
+       if (!m_queueInterface->GetTxQueue(i)->IsStopped())
+       {
+           return false;
+       }
+   }
+   return true;
+}
+
+void
+BernoulliPacketSocketClient::SendPacket()
+{
+   NS_LOG_FUNCTION(this);
+
    Ptr<Packet> p = Create<Packet>(m_size);
 
    std::stringstream peerAddressStringStream;
@@ -220,20 +283,6 @@ BernoulliPacketSocketClient::Send()
        NS_LOG_INFO("Error while sending " << m_size << " bytes to "
                                           << peerAddressStringStream.str());
    }
-   m_sent++;
-
-    // sample a geometric random number from uniform distribution
-   // which is the inter-arrival time
-    double uniform = m_uniformRngForInterval->GetValue();
-    NS_ASSERT(m_bernoulliPr < 1);
-    double numInterval = std::floor(std::log(uniform) / std::log(1 - m_bernoulliPr)) + 1;
-    NS_ASSERT(numInterval > 0);
-    Time interval = numInterval * m_timeSlot;
-
-   if ((m_sent < m_maxPackets) || (m_maxPackets == 0))
-   {
-       m_sendEvent = Simulator::Schedule(interval, &BernoulliPacketSocketClient::Send, this);
-   }
 }
 
 } // Namespace ns3
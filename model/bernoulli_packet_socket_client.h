@@ -24,9 +24,11 @@
 
 #include "ns3/application.h"
 #include "ns3/event-id.h"
+#include "ns3/net-device-queue-interface.h"
 #include "ns3/packet-socket-address.h"
 #include "ns3/ptr.h"
 #include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 #include "ns3/random-variable-stream.h"
 
 namespace ns3
@@ -52,6 +54,12 @@ class Packet;
  * Provides a "Tx" Traced Callback (transmitted packets, source address).
  *
  * Note: packets larger than the NetDevice MTU will not be sent.
+ *
+ * If the socket is bound to a device with a NetDeviceQueueInterface, no
+ * packet is created while the transmit queues of the device are stopped.
+ * Such packets are counted by the "Skipped" trace and still count toward
+ * `MaxPackets', which is the number of packets offered by the Bernoulli
+ * process.
  */
 class BernoulliPacketSocketClient : public Application
 {
@@ -92,19 +100,33 @@ class BernoulliPacketSocketClient : public Application
     void SetPriority(uint8_t priority);
 
     /**
-     * \brief Send a packet
+     * \brief Send a packet, unless the device queue is stopped, and schedule
+     * the next one
      */
     void Send();
 
+    /**
+     * \brief Create a packet and give it to the socket
+     */
+    void SendPacket();
+
+    /**
+     * \brief Whether all the transmit queues of the device are stopped
+     * \return true if the device has a queue interface and its queues are stopped
+     */
+    bool IsDeviceQueueStopped() const;
+
     uint32_t m_maxPackets; //!< Maximum number of packets the application will send
     uint32_t m_size;       //!< Size of the sent packet
     uint8_t m_priority;    //!< Priority of the sent packets
 
-    uint32_t m_sent;                   //!< Counter for sent packets
+    uint32_t m_sent;                   //!< Counter for offered packets, sent or skipped
+    TracedValue<uint32_t> m_skipped;   //!< Counter for packets skipped as the device queue was stopped
     Ptr<Socket> m_socket;              //!< Socket
     PacketSocketAddress m_peerAddress; //!< Remote peer address
     bool m_peerAddressSet;             //!< Sanity check
     EventId m_sendEvent;               //!< Event to send the next packet
+    Ptr<NetDeviceQueueInterface> m_queueInterface; //!< Queue interface of the device, if any
 
     Ptr<UniformRandomVariable> m_uniformRngForInterval;
     Ptr<UniformRandomVariable> m_uniformRngForTid;
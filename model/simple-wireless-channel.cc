@@ -26,9 +26,15 @@
 #include "ns3/ptr.h"
 #include "ns3/mobility-model.h"
 #include "ns3/propagation-loss-model.h"
+#include "ns3/error-model.h"
 #include "simple-wireless-channel.h"
 #include "simple-wireless-net-device.h"
+#include "simple-wireless-kernels.h"
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
 
 NS_LOG_COMPONENT_DEFINE ("SimpleWirelessChannel");
 
@@ -79,6 +85,77 @@ SimpleWirelessChannel::GetTypeId (void)
                    TimeValue (MicroSeconds (100.0)),
                    MakeTimeAccessor (&SimpleWirelessChannel::m_downDuration),
                    MakeTimeChecker ())
+    .AddAttribute ("EnableSpatialIndex",
+                   "Use a uniform grid of device positions to skip out of range devices in Send",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_spatialIndexEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SpatialIndexCellSize",
+                   "Grid cell size (meters) for the spatial index. 0 uses the culling range.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&SimpleWirelessChannel::m_spatialIndexCellSize),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("EnableLinkCache",
+                   "Cache distance, rx power and propagation delay between stationary devices",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_linkCacheEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LinkCacheDenseMaxDevices",
+                   "Largest number of devices for which the link cache uses a dense N x N table",
+                   UintegerValue (512),
+                   MakeUintegerAccessor (&SimpleWirelessChannel::m_linkCacheDenseMax),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("EnableBatchDelivery",
+                   "Deliver a transmission to all receivers with the same arrival time from one event",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_batchDeliveryEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("BatchDeliveryResolution",
+                   "With batched delivery, round propagation delays to a multiple of this value. "
+                   "0 keeps the exact delays.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&SimpleWirelessChannel::m_batchDeliveryResolution),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("StochasticLazyLinks",
+                   "Draw the initial state of a stochastic link on its first use instead of in "
+                   "InitStochasticModel. This changes the random number stream.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_stochasticLazyLinks),
+                   MakeBooleanChecker ())
+    .AddAttribute ("StochasticSparseLinks",
+                   "Keep stochastic link states in a hash map instead of an N x N table. Set "
+                   "StochasticLazyLinks as well to only store the links in use.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_stochasticSparseLinks),
+                   MakeBooleanChecker ())
+    .AddAttribute ("StochasticCatchUp",
+                   "Sample the state of a stochastic link that has been idle for a long time directly "
+                   "instead of replaying every ON/OFF period. This changes the random number stream.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_stochasticCatchUp),
+                   MakeBooleanChecker ())
+    .AddAttribute ("StochasticCatchUpCycles",
+                   "Idle time, in mean ON/OFF cycles, above which StochasticCatchUp samples the link state directly",
+                   DoubleValue (10),
+                   MakeDoubleAccessor (&SimpleWirelessChannel::m_stochasticCatchUpCycles),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("EnableGeometryKernels",
+                   "Compute the distance and rx power of all receivers of a transmission in one pass "
+                   "over positions kept by the channel",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_geometryKernelsEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SlotDuration",
+                   "Duration of the slots of the slot clock used by devices with SlottedAloha enabled",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&SimpleWirelessChannel::m_slotDuration),
+                   MakeTimeChecker (TimeStep (1)))
+    .AddAttribute ("EnableSpecializedSend",
+                   "Use a version of the send pipeline compiled for the error model and loss model in use. "
+                   "If false, the generic version that checks them for every receiver is used.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&SimpleWirelessChannel::m_specializedSendEnabled),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -87,10 +164,54 @@ SimpleWirelessChannel::SimpleWirelessChannel ()
 {
   // Default to a constant error model with 0 errors
   m_random = CreateObject<UniformRandomVariable> ();
+  m_stochasticStream = -1;
   m_ErrorModel = CONSTANT;
   m_errorRate = 0.0;
   m_fixedContentionEnabled = false;
   m_fixedContentionRange = 0;
+  m_devicesTracked = false;
+  m_lossModelDeterministic = true;
+  m_spatialIndexEnabled = false;
+  m_spatialIndexCellSize = 0;
+  m_gridCellSize = 0;
+  m_gridValid = false;
+  m_linkCacheEnabled = false;
+  m_linkCacheDenseMax = 512;
+  m_batchDeliveryEnabled = false;
+  m_batchDeliveryResolution = Seconds (0);
+  m_nodeDevicesValid = false;
+  m_stochasticLazyLinks = false;
+  m_stochasticSparseLinks = false;
+  m_stochasticNodes = 0;
+  m_stochasticCatchUp = false;
+  m_stochasticCatchUpCycles = 10;
+  m_perTableValid = false;
+  m_perTableMin = 0;
+  m_perTableScale = 0;
+  m_geometryKernelsEnabled = false;
+  m_lossKernel = LOSS_KERNEL_NONE;
+  m_contentionValid = false;
+  m_contentionRangeBuilt = 0;
+  m_contentionTime = Seconds (-1);
+  m_specializedSendEnabled = true;
+  m_slotDuration = MilliSeconds (1);
+  m_carrierSenseEnabled = false;
+}
+
+int64_t
+SimpleWirelessChannel::AssignStreams (int64_t stream)
+{
+  m_random->SetStream (stream);
+  // The STOCHASTIC variables are created by InitStochasticModel, which
+  // sets their streams
+  m_stochasticStream = stream + 1;
+  if (m_randomUp)
+    {
+      m_randomUp->SetStream (m_stochasticStream);
+      m_randomDown->SetStream (m_stochasticStream + 1);
+      m_randomCatchUp->SetStream (m_stochasticStream + 2);
+    }
+  return 4;
 }
 
 void
@@ -100,107 +221,328 @@ SimpleWirelessChannel::Send (Ptr<Packet> p, double txPower, uint16_t protocol,
 {
   NS_LOG_FUNCTION (p << txPower << protocol << to << from << sender);
 
-  uint32_t senderNodeId = sender->GetNode ()->GetId ();
-
-  if (m_fixedContentionEnabled)
+  SendContext ctx;
+  ctx.packet = p;
+  ctx.txPower = txPower;
+  ctx.protocol = protocol;
+  ctx.to = to;
+  ctx.from = from;
+  ctx.sender = sender;
+  ctx.txTime = txTime;
+  ctx.senderNodeId = sender->GetNode ()->GetId ();
+  ctx.mobility = sender->GetNode ()->GetObject<MobilityModel> ();
+
+  if ((m_spatialIndexEnabled || m_linkCacheEnabled || m_geometryKernelsEnabled) && !m_devicesTracked)
     {
-      sender->ClearNbrCount ();
+      TrackDevices ();
+    }
 
-      // if the range has not been set, use the tx range.
-      // We do this here because we want the value for range that the user selected value.
-      // If we set the contention range to m_range in other places (like the call to
-      // EnableFixedContention), at that point the range could still be the default
-      // value and not the value the user has set.
-      if (m_fixedContentionRange == 0)
+  // The link cache can only be used between stationary devices, and
+  // only if the loss model gives the same answer every time.
+  ctx.senderIdx = 0;
+  ctx.useLinkCache = false;
+  if (m_linkCacheEnabled && m_lossModelDeterministic)
+    {
+      std::unordered_map<const SimpleWirelessNetDevice *, uint32_t>::const_iterator it = m_deviceIndex.find (PeekPointer (sender));
+      if (it != m_deviceIndex.end ())
         {
-          m_fixedContentionRange = m_range;
+          ctx.senderIdx = it->second;
+          ctx.useLinkCache = m_deviceStationary[ctx.senderIdx];
         }
     }
 
-  for (std::vector<Ptr<SimpleWirelessNetDevice> >::const_iterator i = m_devices.begin (); i != m_devices.end (); ++i)
+  // A directional transmission only goes to the devices of the destination
+  // node, which are looked up directly. Otherwise, with the spatial index
+  // only the devices in cells within range are visited. Either way devices
+  // are visited in the same order as the full scan so that random draws
+  // and event insertion order are unchanged.
+  ctx.visit = 0;
+  if (destId != NO_DIRECTIONAL_NBR)
+    {
+      ctx.visit = &GetNodeDevices (destId);
+    }
+  else if (GetCandidates (ctx.mobility, m_range))
+    {
+      ctx.visit = &m_candidates;
+    }
+  ctx.nVisit = ctx.visit ? ctx.visit->size () : m_devices.size ();
+
+  // With the geometry kernels the distance and rx power of the receivers
+  // are computed after the filter pass, all at once, from the device
+  // positions kept by the channel.
+  ctx.useKernels = m_geometryKernelsEnabled && m_devicesTracked && ctx.mobility;
+
+  (this->*GetSendKernel ()) (ctx);
+}
+
+template <int ErrorPolicy, int LossPolicy>
+void
+SimpleWirelessChannel::SendToReceivers (const SendContext &ctx)
+{
+  // A fixed policy is a compile time constant, so the branches on it
+  // below are folded away. The generic version reads the channel.
+  const ErrorModelType errorModel = (ErrorPolicy == POLICY_RUNTIME) ? m_ErrorModel : static_cast<ErrorModelType> (ErrorPolicy);
+  const bool hasLossModel = (LossPolicy == POLICY_RUNTIME) ? (m_lossModel != 0) : (LossPolicy == POLICY_ON);
+  NS_ASSERT (errorModel == m_ErrorModel && hasLossModel == (m_lossModel != 0));
+
+  const Ptr<MobilityModel> &a = ctx.mobility;
+  uint32_t senderNodeId = ctx.senderNodeId;
+  double txPower = ctx.txPower;
+
+  m_rxIndex.clear ();
+  m_rxDistance.clear ();
+  m_rxPower.clear ();
+  m_rxPropDelay.clear ();
+  m_pendingDeliveries.clear ();
+  m_geoPending.clear ();
+
+  for (std::size_t k = 0; k < ctx.nVisit; ++k)
     {
-      Ptr<SimpleWirelessNetDevice> tmp = *i;
-      uint32_t destNodeId = tmp->GetNode ()->GetId ();
+      uint32_t idx = ctx.visit ? (*ctx.visit)[k] : k;
+      const Ptr<SimpleWirelessNetDevice> &tmp = m_devices[idx];
+      uint32_t destNodeId = m_devicesTracked ? m_deviceNodeId[idx] : tmp->GetNode ()->GetId ();
 
       // don't send to ourselves
-      if (tmp == sender)
+      if (tmp == ctx.sender)
         {
           NS_LOG_INFO ("Node " << senderNodeId << " NOT sending to node " << destNodeId << ". Node is self");
           continue;
         }
 
-      // See if we have directional networking enabled and if so if this is destination node
-      if ( (destId != NO_DIRECTIONAL_NBR) && (destNodeId != destId) )
-        {
-          NS_LOG_INFO ("Node " << senderNodeId << " NOT sending to node " << destNodeId << ". Directional networking enabled and node is not destination " << destId);
-          continue;
-        }
-
       // See if we are using stochastic. If so see if the sender's link
       // to the destination is up or down
-      if (CheckStochasticError (senderNodeId, destNodeId))
+      if (errorModel == STOCHASTIC && CheckStochasticError (senderNodeId, destNodeId))
         {
           NS_LOG_INFO ("Node " << senderNodeId << " NOT sending to node " << destNodeId << ". Stochastic error enabled and link to node is in OFF state");
           continue;
         }
 
-      Ptr<MobilityModel> a = sender->GetNode ()->GetObject<MobilityModel> ();
-      Ptr<MobilityModel> b = tmp->GetNode ()->GetObject<MobilityModel> ();
-      NS_ASSERT_MSG (a && b, "Error:  nodes must have mobility models");
-
       // Get distance and determine error rate based on that
       // and the error model
-      double distance = a->GetDistanceFrom (b);
-
-      double rxPower = txPower;
-      if (m_lossModel)
+      double distance;
+      double rxPower;
+      Time propDelay;
+      if (ctx.useLinkCache && m_deviceStationary[idx])
         {
-          rxPower = m_lossModel->CalcRxPower (txPower, a, b);
-          NS_LOG_INFO ("Propagation loss model reducing txPower from " << txPower << " to " << rxPower << " to node " << tmp->GetNode ()->GetId ());
+          const LinkBudget &link = GetLinkBudget (ctx.senderIdx, idx, txPower);
+          distance = link.distance;
+          rxPower = link.rxPower;
+          propDelay = link.propDelay;
         }
-
-      // if fixed contention is enabled then we need to peg the neighbor count
-      if ( (m_fixedContentionEnabled) && (distance < m_fixedContentionRange) )
+      else if (ctx.useKernels)
         {
-          sender->IncrementNbrCount ();
-          NS_LOG_INFO ("Node " << senderNodeId << " pegging nbr count for contention. distane is " << distance << ". count is now " << sender->GetNbrCount ());
+          m_geoPending.push_back (m_rxIndex.size ());
+          distance = 0;
+          rxPower = txPower;
         }
+      else
+        {
+          Ptr<MobilityModel> b = tmp->GetNode ()->GetObject<MobilityModel> ();
+          NS_ASSERT_MSG (a && b, "Error:  nodes must have mobility models");
+
+          distance = a->GetDistanceFrom (b);
+
+          rxPower = txPower;
+          if (hasLossModel)
+            {
+              rxPower = m_lossModel->CalcRxPower (txPower, a, b);
+              NS_LOG_INFO ("Propagation loss model reducing txPower from " << txPower << " to " << rxPower << " to node " << destNodeId);
+            }
+
+          // propagation delay. speed of light is 3.3 ns/meter
+          propDelay = NanoSeconds (3.3 * distance);
+        }
+
+      m_rxIndex.push_back (idx);
+      m_rxDistance.push_back (distance);
+      m_rxPower.push_back (rxPower);
+      m_rxPropDelay.push_back (propDelay);
+    }
+
+  if (!m_geoPending.empty ())
+    {
+      ComputeGeometry (a, txPower);
+    }
+
+  // Keep the receivers within range
+  std::size_t nRx = 0;
+  for (std::size_t k = 0; k < m_rxIndex.size (); ++k)
+    {
+      double distance = m_rxDistance[k];
 
       // Is this packet beyond the transmission range?
       if (distance > m_range)
         {
-          NS_LOG_INFO ("Node " << senderNodeId << " NOT sending to node " << destNodeId << ". distance of " << distance << "  is out of range");
+          NS_LOG_INFO ("Node " << senderNodeId << " NOT sending to node " << m_devices[m_rxIndex[k]]->GetNode ()->GetId () << ". distance of " << distance << "  is out of range");
           continue;
         }
 
+      m_rxIndex[nRx] = m_rxIndex[k];
+      m_rxDistance[nRx] = distance;
+      m_rxPower[nRx] = m_rxPower[k];
+      m_rxPropDelay[nRx] = m_rxPropDelay[k];
+      nRx++;
+    }
+  m_rxIndex.resize (nRx);
+  m_rxDistance.resize (nRx);
+  m_rxPower.resize (nRx);
+  m_rxPropDelay.resize (nRx);
+
+  // The PER curve is looked up for all the receivers at once. The error
+  // draws are still made one receiver at a time, in device order.
+  if (errorModel == PER_CURVE)
+    {
+      m_rxErrorRate.resize (nRx);
+      GetPerCurveErrorRates (m_rxDistance.data (), m_rxErrorRate.data (), nRx);
+    }
+
+  for (std::size_t k = 0; k < nRx; ++k)
+    {
+      const Ptr<SimpleWirelessNetDevice> &tmp = m_devices[m_rxIndex[k]];
+      double distance = m_rxDistance[k];
+      double rxPower = m_rxPower[k];
+      Time propDelay = m_rxPropDelay[k];
+      if (m_batchDeliveryEnabled && m_batchDeliveryResolution.IsStrictlyPositive ())
+        {
+          int64_t res = m_batchDeliveryResolution.GetTimeStep ();
+          propDelay = TimeStep (((propDelay.GetTimeStep () + res / 2) / res) * res);
+        }
+
+      // A receiver senses the medium busy even if the packet is in error
+      if (m_carrierSenseEnabled)
+        {
+          tmp->NotifyMediumBusy (ctx.sender, ctx.packet->GetUid (), propDelay, ctx.txTime, ctx.to);
+        }
+
       // Is this packet in error or can we send it based on the distance?
-      if (packetInError (distance))
+      // Same checks as packetInError; the stochastic model has no per
+      // packet errors.
+      if (errorModel == CONSTANT)
         {
-          continue;
+          if (m_random->GetValue () < m_errorRate)
+            {
+              NS_LOG_INFO ("Error Model: " << m_ErrorModel << " Checking for error at distance: " << distance << "  Too high error. Packet in error.");
+              continue;
+            }
+        }
+      else if (errorModel == PER_CURVE)
+        {
+          if (PerCurveInError (distance, m_rxErrorRate[k]))
+            {
+              continue;
+            }
         }
 
-      // propagation delay. speed of light is 3.3 ns/meter
-      double propDelay = 3.3 * distance;
+      uint32_t destNodeId = m_devicesTracked ? m_deviceNodeId[m_rxIndex[k]] : tmp->GetNode ()->GetId ();
       NS_LOG_INFO ("Node " << senderNodeId << " sending to node " << destNodeId
                            << " at distance " << distance << " meters; time (ns): " << Simulator::Now ().GetNanoSeconds ()
-                           << " txDelay: " << txTime << "  propDelay: " << propDelay);
+                           << " txDelay: " << ctx.txTime << "  propDelay: " << propDelay);
 
-      Simulator::ScheduleWithContext (destNodeId, (txTime + NanoSeconds(propDelay)),
-                                      &SimpleWirelessNetDevice::Receive, tmp, p->Copy (), rxPower, protocol, to, from);
+      if (m_batchDeliveryEnabled)
+        {
+          BatchReceiver receiver;
+          receiver.device = tmp;
+          receiver.nodeId = destNodeId;
+          receiver.rxPower = rxPower;
+          m_pendingDeliveries.push_back (std::make_pair (ctx.txTime + propDelay, receiver));
+          continue;
+        }
 
+      Simulator::ScheduleWithContext (destNodeId, (ctx.txTime + propDelay),
+                                      &SimpleWirelessNetDevice::Receive, tmp, ctx.packet->Copy (), rxPower, ctx.protocol, ctx.to, ctx.from);
+
+    }
+
+  if (!m_pendingDeliveries.empty ())
+    {
+      ScheduleBatches (ctx.packet, ctx.protocol, ctx.to, ctx.from);
     }
 }
 
+SimpleWirelessChannel::SendKernel
+SimpleWirelessChannel::GetSendKernel (void) const
+{
+  if (!m_specializedSendEnabled)
+    {
+      return &SimpleWirelessChannel::SendToReceivers<POLICY_RUNTIME, POLICY_RUNTIME>;
+    }
+
+  // One version per error model and loss model presence. The table is
+  // indexed on every Send because both can be changed at any time, the
+  // error model through its attribute as well as setErrorModelType.
+  static const SendKernel kernels[3][2] = {
+    { &SimpleWirelessChannel::SendToReceivers<CONSTANT, POLICY_OFF>,
+      &SimpleWirelessChannel::SendToReceivers<CONSTANT, POLICY_ON> },
+    { &SimpleWirelessChannel::SendToReceivers<PER_CURVE, POLICY_OFF>,
+      &SimpleWirelessChannel::SendToReceivers<PER_CURVE, POLICY_ON> },
+    { &SimpleWirelessChannel::SendToReceivers<STOCHASTIC, POLICY_OFF>,
+      &SimpleWirelessChannel::SendToReceivers<STOCHASTIC, POLICY_ON> }
+  };
+  NS_ASSERT (m_ErrorModel >= CONSTANT && m_ErrorModel <= STOCHASTIC);
+  return kernels[m_ErrorModel][m_lossModel ? 1 : 0];
+}
+
 void
 SimpleWirelessChannel::Add (Ptr<SimpleWirelessNetDevice> device)
 {
   m_devices.push_back (device);
+  m_devicesTracked = false;
+  m_gridValid = false;
+  m_nodeDevicesValid = false;
+}
+
+// Loss models whose result depends only on the two positions. Any other
+// model (e.g. TwoStatePropagationLossModel, Nakagami) may draw random
+// variates on each call, so skipping calls for out of range devices would
+// change the results.
+static bool
+IsDeterministicLossModel (Ptr<PropagationLossModel> model)
+{
+  static const std::set<std::string> deterministic = {
+    "ns3::FriisPropagationLossModel",
+    "ns3::LogDistancePropagationLossModel",
+    "ns3::ThreeLogDistancePropagationLossModel",
+    "ns3::TwoRayGroundPropagationLossModel",
+    "ns3::RangePropagationLossModel",
+    "ns3::FixedRssLossModel",
+    "ns3::MatrixPropagationLossModel",
+  };
+  for (; model; model = model->GetNext ())
+    {
+      if (deterministic.find (model->GetInstanceTypeId ().GetName ()) == deterministic.end ())
+        {
+          return false;
+        }
+    }
+  return true;
 }
 
 void
 SimpleWirelessChannel::AddPropagationLossModel (Ptr<PropagationLossModel> lossModel)
 {
   m_lossModel = lossModel;
+  m_lossModelDeterministic = IsDeterministicLossModel (lossModel);
+
+  // Loss models that the geometry kernels evaluate themselves. A chained
+  // model is evaluated with CalcRxPower.
+  m_lossKernel = LOSS_KERNEL_VIRTUAL;
+  if (!lossModel)
+    {
+      m_lossKernel = LOSS_KERNEL_NONE;
+    }
+  else if (!lossModel->GetNext ())
+    {
+      std::string name = lossModel->GetInstanceTypeId ().GetName ();
+      if (name == "ns3::FriisPropagationLossModel")
+        {
+          m_lossKernel = LOSS_KERNEL_FRIIS;
+        }
+      else if (name == "ns3::LogDistancePropagationLossModel")
+        {
+          m_lossKernel = LOSS_KERNEL_LOG_DISTANCE;
+        }
+    }
+  FlushLinkCache ();
 }
 
 std::size_t
@@ -222,23 +564,716 @@ void SimpleWirelessChannel::EnableFixedContention (void)
 {
   m_fixedContentionEnabled = true;
 
-  // Set up all the devices to support contention.
-  // IMPORTANT NOTE: There may not be any devices at this point on the channel.
-  // If there are not any, then the first packet sent by the device will use the
-  // full data rate and will not use contention. That is, the device will be notified
-  // by the channel when the channel gets the first packet from the device and that is
-  // after the data rate has been used to set the tx time. All subsequent packets sent
-  // by the device will use contention just not the first one.
-  for (std::vector<Ptr<SimpleWirelessNetDevice> >::const_iterator i = m_devices.begin (); i != m_devices.end (); ++i)
-    {
-      Ptr<SimpleWirelessNetDevice> tmp = *i;
-      tmp->ClearNbrCount ();
-    }
+  // The neighbor counts are built when a device first asks for its count,
+  // since the devices may not be on the channel (or have a position) yet.
+  m_contentionValid = false;
 }
 
 void SimpleWirelessChannel::SetFixedContentionRange (double range)
 {
   m_fixedContentionRange = range;
+  m_contentionValid = false;
+}
+
+double
+SimpleWirelessChannel::GetContentionRange (void) const
+{
+  // if the range has not been set, use the tx range. This is evaluated
+  // when the counts are used so that it is the range the user selected.
+  if (m_fixedContentionRange == 0)
+    {
+      return m_range;
+    }
+  return m_fixedContentionRange;
+}
+
+bool
+SimpleWirelessChannel::InContentionRange (uint32_t i, uint32_t j, double range) const
+{
+  // Same expression as MobilityModel::GetDistanceFrom
+  double dx = m_devicePosX[j] - m_devicePosX[i];
+  double dy = m_devicePosY[j] - m_devicePosY[i];
+  double dz = m_devicePosZ[j] - m_devicePosZ[i];
+  return std::sqrt (dx * dx + dy * dy + dz * dz) < range;
+}
+
+void
+SimpleWirelessChannel::RefreshPosition (uint32_t idx)
+{
+  if (!m_deviceStationary[idx] && m_deviceMobility[idx])
+    {
+      Vector pos = m_deviceMobility[idx]->GetPosition ();
+      m_devicePosX[idx] = pos.x;
+      m_devicePosY[idx] = pos.y;
+      m_devicePosZ[idx] = pos.z;
+    }
+}
+
+void
+SimpleWirelessChannel::BuildContention (void)
+{
+  NS_LOG_FUNCTION (this << m_devices.size ());
+  double range = GetContentionRange ();
+  m_contentionCount.assign (m_devices.size (), 0);
+  m_contentionMoving.clear ();
+  for (uint32_t i = 0; i < m_devices.size (); ++i)
+    {
+      if (!m_deviceStationary[i])
+        {
+          if (m_deviceMobility[i])
+            {
+              m_contentionMoving.push_back (i);
+            }
+          continue;
+        }
+      for (uint32_t j = i + 1; j < m_devices.size (); ++j)
+        {
+          if (m_deviceStationary[j] && InContentionRange (i, j, range))
+            {
+              m_contentionCount[i]++;
+              m_contentionCount[j]++;
+            }
+        }
+    }
+  m_contentionRangeBuilt = range;
+  m_contentionValid = true;
+  m_contentionTime = Seconds (-1);
+}
+
+void
+SimpleWirelessChannel::UpdateContention (uint32_t idx, bool add)
+{
+  double range = m_contentionRangeBuilt;
+  for (uint32_t j = 0; j < m_devices.size (); ++j)
+    {
+      if (j != idx && m_deviceStationary[j] && InContentionRange (idx, j, range))
+        {
+          if (add)
+            {
+              m_contentionCount[j]++;
+              m_contentionCount[idx]++;
+            }
+          else
+            {
+              m_contentionCount[j]--;
+              m_contentionCount[idx]--;
+            }
+        }
+    }
+}
+
+uint32_t
+SimpleWirelessChannel::GetContentionCount (Ptr<const SimpleWirelessNetDevice> device)
+{
+  if (!m_fixedContentionEnabled)
+    {
+      return 0;
+    }
+  if (!m_devicesTracked)
+    {
+      TrackDevices ();
+    }
+  if (!m_contentionValid || GetContentionRange () != m_contentionRangeBuilt)
+    {
+      BuildContention ();
+    }
+
+  std::unordered_map<const SimpleWirelessNetDevice *, uint32_t>::const_iterator it = m_deviceIndex.find (PeekPointer (device));
+  NS_ASSERT_MSG (it != m_deviceIndex.end (), "Device is not on this channel");
+  uint32_t idx = it->second;
+  double range = m_contentionRangeBuilt;
+
+  // we always have to count ourselves
+  uint32_t count = 1;
+  if (m_deviceStationary[idx] && m_contentionMoving.empty ())
+    {
+      count += m_contentionCount[idx];
+      NS_LOG_DEBUG ("Contention count for device " << idx << " is " << count);
+      return count;
+    }
+
+  // Moving devices are involved: the positions, and so the counts, only
+  // change with time or on a course change, so a count is computed once
+  // per time step
+  Time now = Simulator::Now ();
+  if (m_contentionTime != now)
+    {
+      m_contentionCached.assign (m_devices.size (), 0);
+      m_contentionTime = now;
+    }
+  if (m_contentionCached[idx] != 0)
+    {
+      return m_contentionCached[idx];
+    }
+
+  if (m_deviceStationary[idx])
+    {
+      // Counts between stationary devices are kept up to date by
+      // CourseChanged; moving devices are checked now.
+      count += m_contentionCount[idx];
+      // (by index, reading a position may report a course change)
+      for (std::size_t k = 0; k < m_contentionMoving.size (); ++k)
+        {
+          uint32_t j = m_contentionMoving[k];
+          RefreshPosition (j);
+          if (InContentionRange (idx, j, range))
+            {
+              count++;
+            }
+        }
+    }
+  else
+    {
+      RefreshPosition (idx);
+      for (uint32_t j = 0; j < m_devices.size (); ++j)
+        {
+          if (j == idx || !(m_deviceStationary[j] || m_deviceMobility[j]))
+            {
+              continue;
+            }
+          RefreshPosition (j);
+          if (InContentionRange (idx, j, range))
+            {
+              count++;
+            }
+        }
+    }
+  NS_LOG_DEBUG ("Contention count for device " << idx << " is " << count);
+  if (m_contentionTime == now)
+    {
+      m_contentionCached[idx] = count;
+    }
+  return count;
+}
+
+//********************************************************************
+// Device tracking functions
+void
+SimpleWirelessChannel::TrackDevices (void)
+{
+  NS_LOG_FUNCTION (this << m_devices.size ());
+  m_deviceIndex.clear ();
+  m_deviceStationary.assign (m_devices.size (), false);
+  m_deviceEpoch.assign (m_devices.size (), 1);
+  m_deviceNodeId.assign (m_devices.size (), 0);
+  m_deviceMobility.assign (m_devices.size (), 0);
+  m_devicePosX.assign (m_devices.size (), 0);
+  m_devicePosY.assign (m_devices.size (), 0);
+  m_devicePosZ.assign (m_devices.size (), 0);
+  for (std::map<const MobilityModel *, std::vector<uint32_t> >::iterator it = m_mobilityDevices.begin (); it != m_mobilityDevices.end (); ++it)
+    {
+      it->second.clear ();
+    }
+
+  for (uint32_t idx = 0; idx < m_devices.size (); ++idx)
+    {
+      m_deviceIndex[PeekPointer (m_devices[idx])] = idx;
+      Ptr<Node> node = m_devices[idx]->GetNode ();
+      Ptr<MobilityModel> mobility = node ? node->GetObject<MobilityModel> () : Ptr<MobilityModel> ();
+      m_deviceNodeId[idx] = node ? node->GetId () : NO_DIRECTIONAL_NBR;
+      if (mobility)
+        {
+          Vector pos = mobility->GetPosition ();
+          m_deviceMobility[idx] = PeekPointer (mobility);
+          m_devicePosX[idx] = pos.x;
+          m_devicePosY[idx] = pos.y;
+          m_devicePosZ[idx] = pos.z;
+
+          // Hook each mobility model once; several devices may share it
+          std::map<const MobilityModel *, std::vector<uint32_t> >::iterator it = m_mobilityDevices.find (PeekPointer (mobility));
+          if (it == m_mobilityDevices.end ())
+            {
+              mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&SimpleWirelessChannel::CourseChanged, this));
+              it = m_mobilityDevices.insert (std::make_pair (PeekPointer (mobility), std::vector<uint32_t> ())).first;
+            }
+          it->second.push_back (idx);
+          m_deviceStationary[idx] = (mobility->GetVelocity ().GetLength () == 0);
+        }
+    }
+
+  // The epochs were reset, so all cached links must go
+  m_linkCacheSparse.clear ();
+  m_linkCacheDense.clear ();
+  if (m_linkCacheEnabled && m_devices.size () <= m_linkCacheDenseMax)
+    {
+      m_linkCacheDense.resize (m_devices.size () * m_devices.size ());
+    }
+
+  m_gridValid = false;
+  m_contentionValid = false;
+  m_devicesTracked = true;
+}
+
+const std::vector<uint32_t> &
+SimpleWirelessChannel::GetNodeDevices (uint32_t nodeId)
+{
+  // Built on first use since devices are usually attached to the channel
+  // before they are attached to their node.
+  if (!m_nodeDevicesValid)
+    {
+      m_nodeDevices.clear ();
+      for (uint32_t idx = 0; idx < m_devices.size (); ++idx)
+        {
+          Ptr<Node> node = m_devices[idx]->GetNode ();
+          if (node)
+            {
+              m_nodeDevices[node->GetId ()].push_back (idx);
+            }
+        }
+      m_nodeDevicesValid = true;
+    }
+
+  static const std::vector<uint32_t> none;
+  std::unordered_map<uint32_t, std::vector<uint32_t> >::const_iterator it = m_nodeDevices.find (nodeId);
+  if (it == m_nodeDevices.end ())
+    {
+      return none;
+    }
+  return it->second;
+}
+
+void
+SimpleWirelessChannel::CourseChanged (Ptr<const MobilityModel> mobility)
+{
+  if (!m_devicesTracked)
+    {
+      return;
+    }
+  std::map<const MobilityModel *, std::vector<uint32_t> >::iterator it = m_mobilityDevices.find (PeekPointer (mobility));
+  if (it == m_mobilityDevices.end ())
+    {
+      return;
+    }
+  Vector pos = mobility->GetPosition ();
+  bool stationary = (mobility->GetVelocity ().GetLength () == 0);
+  // Counts cached for the current time may involve these devices
+  m_contentionTime = Seconds (-1);
+  for (std::vector<uint32_t>::const_iterator i = it->second.begin (); i != it->second.end (); ++i)
+    {
+      // Take the device out of the contention counts at its old position
+      if (m_contentionValid && m_deviceStationary[*i])
+        {
+          UpdateContention (*i, false);
+        }
+      else if (m_contentionValid)
+        {
+          m_contentionMoving.erase (std::lower_bound (m_contentionMoving.begin (), m_contentionMoving.end (), *i));
+        }
+
+      m_devicePosX[*i] = pos.x;
+      m_devicePosY[*i] = pos.y;
+      m_devicePosZ[*i] = pos.z;
+      // Invalidates every cached link to or from this device
+      if (++m_deviceEpoch[*i] == 0)
+        {
+          m_deviceEpoch[*i] = 1;
+        }
+      m_deviceStationary[*i] = stationary;
+
+      if (m_contentionValid && stationary)
+        {
+          UpdateContention (*i, true);
+        }
+      else if (m_contentionValid)
+        {
+          m_contentionMoving.insert (std::lower_bound (m_contentionMoving.begin (), m_contentionMoving.end (), *i), *i);
+        }
+      if (m_gridValid)
+        {
+          UnindexDevice (*i);
+          IndexDevice (*i);
+        }
+    }
+}
+
+//********************************************************************
+// Spatial index functions
+void SimpleWirelessChannel::EnableSpatialIndex (void)
+{
+  m_spatialIndexEnabled = true;
+  m_gridValid = false;
+}
+
+int64_t
+SimpleWirelessChannel::GetCellKey (double cx, double cy) const
+{
+  // clamp so that far away positions do not overflow the key (and never
+  // produce the key used to mark devices that are not in a cell)
+  cx = std::min (std::max (cx, -1073741824.0), 1073741823.0);
+  cy = std::min (std::max (cy, -1073741824.0), 1073741823.0);
+  return static_cast<int64_t> ((static_cast<uint64_t> (static_cast<int64_t> (cx)) << 32)
+                               | static_cast<uint32_t> (static_cast<int32_t> (cy)));
+}
+
+void
+SimpleWirelessChannel::IndexDevice (uint32_t idx)
+{
+  if (m_deviceStationary[idx])
+    {
+      // A stationary device stays in its cell until its mobility model
+      // reports a course change.
+      Vector pos = m_devices[idx]->GetNode ()->GetObject<MobilityModel> ()->GetPosition ();
+      int64_t key = GetCellKey (std::floor (pos.x / m_gridCellSize), std::floor (pos.y / m_gridCellSize));
+      std::vector<uint32_t> &cell = m_grid[key];
+      cell.insert (std::lower_bound (cell.begin (), cell.end (), idx), idx);
+      m_gridCellOf[idx] = key;
+    }
+  else
+    {
+      // Moving devices (and devices without mobility, which the full scan
+      // asserts on) are checked on every Send.
+      m_gridAlwaysVisit.insert (std::lower_bound (m_gridAlwaysVisit.begin (), m_gridAlwaysVisit.end (), idx), idx);
+      m_gridCellOf[idx] = std::numeric_limits<int64_t>::min ();
+    }
+}
+
+void
+SimpleWirelessChannel::UnindexDevice (uint32_t idx)
+{
+  std::vector<uint32_t> *list = &m_gridAlwaysVisit;
+  std::unordered_map<int64_t, std::vector<uint32_t> >::iterator it = m_grid.find (m_gridCellOf[idx]);
+  if (it != m_grid.end ())
+    {
+      list = &it->second;
+    }
+  std::vector<uint32_t>::iterator pos = std::lower_bound (list->begin (), list->end (), idx);
+  NS_ASSERT (pos != list->end () && *pos == idx);
+  list->erase (pos);
+  if (list->empty () && it != m_grid.end ())
+    {
+      m_grid.erase (it);
+    }
+}
+
+void
+SimpleWirelessChannel::BuildSpatialIndex (void)
+{
+  NS_LOG_FUNCTION (this << m_devices.size ());
+  m_grid.clear ();
+  m_gridAlwaysVisit.clear ();
+  m_gridCellOf.assign (m_devices.size (), 0);
+
+  m_gridCellSize = m_spatialIndexCellSize;
+  if (m_gridCellSize <= 0)
+    {
+      m_gridCellSize = m_range;
+    }
+
+  for (uint32_t idx = 0; idx < m_devices.size (); ++idx)
+    {
+      IndexDevice (idx);
+    }
+  m_gridValid = true;
+}
+
+bool
+SimpleWirelessChannel::GetCandidates (Ptr<MobilityModel> sender, double radius)
+{
+  // The index can only skip devices whose processing has no side effects
+  // when they are out of range: the stochastic error model draws a link
+  // state for every device, and a random loss model draws on every call.
+  if (!m_spatialIndexEnabled || !sender || m_ErrorModel == STOCHASTIC || !m_lossModelDeterministic)
+    {
+      return false;
+    }
+  if (!m_gridValid)
+    {
+      BuildSpatialIndex ();
+    }
+  if (!(m_gridCellSize > 0) || !std::isfinite (radius))
+    {
+      return false;
+    }
+
+  Vector pos = sender->GetPosition ();
+  double x0 = std::floor ((pos.x - radius) / m_gridCellSize);
+  double x1 = std::floor ((pos.x + radius) / m_gridCellSize);
+  double y0 = std::floor ((pos.y - radius) / m_gridCellSize);
+  double y1 = std::floor ((pos.y + radius) / m_gridCellSize);
+  // Not worth it when there are more cells to look at than devices
+  if ((x1 - x0 + 1) * (y1 - y0 + 1) > m_devices.size ())
+    {
+      return false;
+    }
+
+  m_candidates.assign (m_gridAlwaysVisit.begin (), m_gridAlwaysVisit.end ());
+  for (double cx = x0; cx <= x1; ++cx)
+    {
+      for (double cy = y0; cy <= y1; ++cy)
+        {
+          std::unordered_map<int64_t, std::vector<uint32_t> >::const_iterator it = m_grid.find (GetCellKey (cx, cy));
+          if (it != m_grid.end ())
+            {
+              m_candidates.insert (m_candidates.end (), it->second.begin (), it->second.end ());
+            }
+        }
+    }
+  std::sort (m_candidates.begin (), m_candidates.end ());
+  return true;
+}
+
+//********************************************************************
+// Link budget cache functions
+void SimpleWirelessChannel::EnableLinkCache (void)
+{
+  m_linkCacheEnabled = true;
+  m_devicesTracked = false;
+}
+
+void SimpleWirelessChannel::FlushLinkCache (void)
+{
+  m_linkCacheSparse.clear ();
+  std::fill (m_linkCacheDense.begin (), m_linkCacheDense.end (), LinkBudget ());
+}
+
+const SimpleWirelessChannel::LinkBudget &
+SimpleWirelessChannel::GetLinkBudget (uint32_t src, uint32_t dst, double txPower)
+{
+  LinkBudget *link;
+  if (!m_linkCacheDense.empty ())
+    {
+      link = &m_linkCacheDense[src * m_devices.size () + dst];
+    }
+  else
+    {
+      link = &m_linkCacheSparse[(static_cast<uint64_t> (src) << 32) | dst];
+    }
+
+  if (link->srcEpoch == m_deviceEpoch[src] && link->dstEpoch == m_deviceEpoch[dst] && link->txPower == txPower)
+    {
+      return *link;
+    }
+
+  // Miss: compute exactly as the uncached path in Send does
+  Ptr<MobilityModel> a = m_devices[src]->GetNode ()->GetObject<MobilityModel> ();
+  Ptr<MobilityModel> b = m_devices[dst]->GetNode ()->GetObject<MobilityModel> ();
+  NS_ASSERT_MSG (a && b, "Error:  nodes must have mobility models");
+  link->srcEpoch = m_deviceEpoch[src];
+  link->dstEpoch = m_deviceEpoch[dst];
+  link->txPower = txPower;
+  link->distance = a->GetDistanceFrom (b);
+  link->rxPower = txPower;
+  if (m_lossModel)
+    {
+      link->rxPower = m_lossModel->CalcRxPower (txPower, a, b);
+    }
+  // propagation delay. speed of light is 3.3 ns/meter
+  link->propDelay = NanoSeconds (3.3 * link->distance);
+  NS_LOG_DEBUG ("Link cache miss src " << src << " dst " << dst << " distance " << link->distance << " rxPower " << link->rxPower);
+  return *link;
+}
+
+//********************************************************************
+// Geometry kernel functions
+void SimpleWirelessChannel::EnableGeometryKernels (void)
+{
+  m_geometryKernelsEnabled = true;
+}
+
+void
+SimpleWirelessChannel::ComputeGeometry (Ptr<MobilityModel> sender, double txPower)
+{
+  std::size_t n = m_geoPending.size ();
+  m_geoX.resize (n);
+  m_geoY.resize (n);
+  m_geoZ.resize (n);
+  m_geoDistance.resize (n);
+  m_geoRxPower.resize (n);
+
+  // Gather the receiver positions. Moving devices do not report every
+  // position change, so their position is read from the mobility model.
+  for (std::size_t j = 0; j < n; j++)
+    {
+      uint32_t idx = m_rxIndex[m_geoPending[j]];
+      if (!m_deviceStationary[idx])
+        {
+          NS_ASSERT_MSG (m_deviceMobility[idx], "Error:  nodes must have mobility models");
+          Vector pos = m_deviceMobility[idx]->GetPosition ();
+          m_devicePosX[idx] = pos.x;
+          m_devicePosY[idx] = pos.y;
+          m_devicePosZ[idx] = pos.z;
+        }
+      m_geoX[j] = m_devicePosX[idx];
+      m_geoY[j] = m_devicePosY[idx];
+      m_geoZ[j] = m_devicePosZ[idx];
+    }
+
+  Vector pos = sender->GetPosition ();
+  SimpleWirelessKernels::Distances (pos.x, pos.y, pos.z, m_geoX.data (), m_geoY.data (), m_geoZ.data (),
+                                    m_geoDistance.data (), n);
+
+  switch (m_lossKernel)
+    {
+    case LOSS_KERNEL_NONE:
+      std::fill (m_geoRxPower.begin (), m_geoRxPower.end (), txPower);
+      break;
+    case LOSS_KERNEL_FRIIS:
+      {
+        // The parameters are read on every transmission so that changes
+        // to the attributes of the model take effect as they would
+        // without the kernels.
+        DoubleValue frequency;
+        DoubleValue systemLoss;
+        DoubleValue minLoss;
+        m_lossModel->GetAttribute ("Frequency", frequency);
+        m_lossModel->GetAttribute ("SystemLoss", systemLoss);
+        m_lossModel->GetAttribute ("MinLoss", minLoss);
+        // speed of light in vacuum, as in FriisPropagationLossModel
+        double lambda = 299792458.0 / frequency.Get ();
+        SimpleWirelessKernels::FriisRxPower (txPower, lambda, systemLoss.Get (), minLoss.Get (),
+                                             m_geoDistance.data (), m_geoRxPower.data (), n);
+      }
+      break;
+    case LOSS_KERNEL_LOG_DISTANCE:
+      {
+        DoubleValue exponent;
+        DoubleValue referenceDistance;
+        DoubleValue referenceLoss;
+        m_lossModel->GetAttribute ("Exponent", exponent);
+        m_lossModel->GetAttribute ("ReferenceDistance", referenceDistance);
+        m_lossModel->GetAttribute ("ReferenceLoss", referenceLoss);
+        SimpleWirelessKernels::LogDistanceRxPower (txPower, exponent.Get (), referenceDistance.Get (), referenceLoss.Get (),
+                                                   m_geoDistance.data (), m_geoRxPower.data (), n);
+      }
+      break;
+    default:
+      // Called in device order, so a loss model that draws random
+      // variates sees the same sequence of calls as without the kernels
+      for (std::size_t j = 0; j < n; j++)
+        {
+          Ptr<MobilityModel> b = m_deviceMobility[m_rxIndex[m_geoPending[j]]];
+          m_geoRxPower[j] = m_lossModel->CalcRxPower (txPower, sender, b);
+        }
+      break;
+    }
+
+  for (std::size_t j = 0; j < n; j++)
+    {
+      std::size_t k = m_geoPending[j];
+      m_rxDistance[k] = m_geoDistance[j];
+      m_rxPower[k] = m_geoRxPower[j];
+      // propagation delay. speed of light is 3.3 ns/meter
+      m_rxPropDelay[k] = NanoSeconds (3.3 * m_geoDistance[j]);
+    }
+}
+
+//********************************************************************
+// Batched delivery functions
+void SimpleWirelessChannel::EnableBatchDelivery (void)
+{
+  m_batchDeliveryEnabled = true;
+}
+
+void
+SimpleWirelessChannel::EnableCarrierSense (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_carrierSenseEnabled = true;
+}
+
+void
+SimpleWirelessChannel::RequestSlot (Ptr<SimpleWirelessNetDevice> device)
+{
+  NS_LOG_FUNCTION (this << device);
+  m_slotWaiting.push_back (device);
+  if (!m_slotEvent.IsRunning ())
+    {
+      // start of the current slot if now is on a boundary, else of the next one
+      int64_t slot = m_slotDuration.GetTimeStep ();
+      int64_t now = Simulator::Now ().GetTimeStep ();
+      int64_t start = ((now + slot - 1) / slot) * slot;
+      m_slotEvent = Simulator::Schedule (TimeStep (start - now), &SimpleWirelessChannel::StartSlot, this);
+    }
+}
+
+void
+SimpleWirelessChannel::StartSlot (void)
+{
+  NS_LOG_FUNCTION (this);
+  // A device called here may ask for the next slot
+  m_slotStarting.swap (m_slotWaiting);
+  NS_LOG_DEBUG ("Slot at " << Simulator::Now () << " for " << m_slotStarting.size () << " devices");
+  for (std::size_t i = 0; i < m_slotStarting.size (); ++i)
+    {
+      m_slotStarting[i]->HandleStartOfFrame ();
+    }
+  m_slotStarting.clear ();
+}
+
+void
+SimpleWirelessChannel::ScheduleBatches (Ptr<Packet> p, uint16_t protocol, Mac48Address to, Mac48Address from)
+{
+  // A stable sort keeps device order within an arrival time, and events
+  // are inserted in the same relative order as the per receiver events
+  // would have been, so the delivery order is unchanged.
+  std::stable_sort (m_pendingDeliveries.begin (), m_pendingDeliveries.end (),
+                    [] (const std::pair<Time, BatchReceiver> &x, const std::pair<Time, BatchReceiver> &y)
+                    {
+                      return x.first < y.first;
+                    });
+
+  Ptr<Packet> shared = p->Copy ();
+  std::size_t i = 0;
+  while (i < m_pendingDeliveries.size ())
+    {
+      // Every receiver of a batch must be of the node whose context the
+      // event runs in, so that the events they schedule, and their log
+      // output, belong to it
+      std::size_t j = i + 1;
+      while (j < m_pendingDeliveries.size () && m_pendingDeliveries[j].first == m_pendingDeliveries[i].first
+             && m_pendingDeliveries[j].second.nodeId == m_pendingDeliveries[i].second.nodeId)
+        {
+          j++;
+        }
+
+      Time delay = m_pendingDeliveries[i].first;
+      Ptr<SimpleWirelessNetDevice> first = m_pendingDeliveries[i].second.device;
+      if (j - i == 1)
+        {
+          // a batch of one is no cheaper than a plain event; as in
+          // DeliverBatch, only a receive error model needs its own copy
+          Simulator::ScheduleWithContext (m_pendingDeliveries[i].second.nodeId, delay,
+                                          &SimpleWirelessNetDevice::Receive, first,
+                                          first->GetReceiveErrorModel () ? p->Copy () : shared,
+                                          m_pendingDeliveries[i].second.rxPower, protocol, to, from);
+        }
+      else
+        {
+          Ptr<DeliveryBatch> batch = Create<DeliveryBatch> ();
+          batch->packet = shared;
+          batch->protocol = protocol;
+          batch->to = to;
+          batch->from = from;
+          batch->receivers.reserve (j - i);
+          for (std::size_t k = i; k < j; k++)
+            {
+              batch->receivers.push_back (m_pendingDeliveries[k].second);
+            }
+          NS_LOG_DEBUG ("Batch of " << batch->receivers.size () << " receivers at +" << delay);
+          Simulator::ScheduleWithContext (m_pendingDeliveries[i].second.nodeId, delay,
+                                          &SimpleWirelessChannel::DeliverBatch, this, batch);
+        }
+      i = j;
+    }
+  m_pendingDeliveries.clear ();
+}
+
+void
+SimpleWirelessChannel::DeliverBatch (Ptr<DeliveryBatch> batch)
+{
+  NS_LOG_FUNCTION (this << batch->receivers.size ());
+  for (std::vector<BatchReceiver>::const_iterator it = batch->receivers.begin (); it != batch->receivers.end (); ++it)
+    {
+      // Upper layers only see a Ptr<const Packet>. The receive error
+      // model is the only part of the receive path that is handed a
+      // mutable packet, so only receivers with one get a private copy.
+      Ptr<Packet> packet = batch->packet;
+      if (it->device->GetReceiveErrorModel ())
+        {
+          packet = batch->packet->Copy ();
+        }
+      it->device->Receive (packet, it->rxPower, batch->protocol, batch->to, batch->from);
+    }
 }
 
 //********************************************************************
@@ -265,6 +1300,7 @@ void SimpleWirelessChannel::addToPERmodel (double distance, double error)
 {
   // NOTE: distance is in meters
   mPERmap.insert (std::pair<double, double> (distance, error));
+  m_perTableValid = false;
 
   if (distance > m_range)
     {
@@ -272,13 +1308,127 @@ void SimpleWirelessChannel::addToPERmodel (double distance, double error)
     }
 }
 
+void
+SimpleWirelessChannel::BuildPerTable (void)
+{
+  m_perDistance.clear ();
+  m_perError.clear ();
+  m_perBucket.clear ();
+  for (std::map<double, double>::const_iterator it = mPERmap.begin (); it != mPERmap.end (); ++it)
+    {
+      m_perDistance.push_back (it->first);
+      m_perError.push_back (it->second);
+    }
+
+  // Uniform buckets over the curve. Each bucket holds the index of the
+  // last point at or before the start of the bucket, so a lookup starts
+  // at most a few points from the segment holding the distance.
+  m_perTableMin = 0;
+  m_perTableScale = 0;
+  if (m_perDistance.size () > 1)
+    {
+      uint32_t nBuckets = std::max<std::size_t> (64, 4 * m_perDistance.size ());
+      m_perTableMin = m_perDistance.front ();
+      m_perTableScale = nBuckets / (m_perDistance.back () - m_perDistance.front ());
+      uint32_t i = 0;
+      for (uint32_t b = 0; b < nBuckets; b++)
+        {
+          double start = m_perTableMin + b / m_perTableScale;
+          while (i + 1 < m_perDistance.size () && m_perDistance[i + 1] <= start)
+            {
+              i++;
+            }
+          m_perBucket.push_back (i);
+        }
+    }
+  m_perTableValid = true;
+  NS_LOG_DEBUG ("PER table built with " << m_perDistance.size () << " points and " << m_perBucket.size () << " buckets");
+}
+
+void
+SimpleWirelessChannel::GetPerCurveErrorRates (const double *distances, double *errorRates, std::size_t n)
+{
+  if (!m_perTableValid)
+    {
+      BuildPerTable ();
+    }
+  std::size_t nPoints = m_perDistance.size ();
+  if (nPoints < 2)
+    {
+      for (std::size_t k = 0; k < n; k++)
+        {
+          errorRates[k] = nPoints ? (distances[k] > m_perDistance[0] ? 1.0 : m_perError[0]) : 1.0;
+        }
+      return;
+    }
+
+  // First pass: bucket of each distance. Plain arithmetic that the
+  // compiler can vectorize; errorRates is used as scratch.
+  double maxBucket = m_perBucket.size () - 1;
+  for (std::size_t k = 0; k < n; k++)
+    {
+      errorRates[k] = std::min (std::max ((distances[k] - m_perTableMin) * m_perTableScale, 0.0), maxBucket);
+    }
+
+  // Second pass: find the segment from the bucket and interpolate, with
+  // the same expression as the map based lookup used so that the rates
+  // are bit for bit the same.
+  for (std::size_t k = 0; k < n; k++)
+    {
+      double distance = distances[k];
+      std::size_t i = m_perBucket[static_cast<std::size_t> (errorRates[k])];
+      while (i > 0 && m_perDistance[i] > distance)
+        {
+          i--;
+        }
+      while (i + 1 < nPoints && m_perDistance[i + 1] <= distance)
+        {
+          i++;
+        }
+
+      if (distance <= m_perDistance[i])
+        {
+          // exact match, or before the first point of the curve
+          errorRates[k] = m_perError[i];
+        }
+      else if (i + 1 == nPoints)
+        {
+          // beyond the end of the curve
+          errorRates[k] = 1.0;
+        }
+      else
+        {
+          errorRates[k] = m_perError[i] + ( ((distance - m_perDistance[i]) / (m_perDistance[i + 1] - m_perDistance[i])) * (m_perError[i + 1] - m_perError[i]));
+        }
+    }
+}
+
+bool
+SimpleWirelessChannel::PerCurveInError (double distance, double errorRate)
+{
+  if (m_perDistance.empty () || distance > m_perDistance.back ())
+    {
+      // this distance is beyond the upper bound so error is 100%
+      NS_LOG_INFO ("Error Model: " << m_ErrorModel << " Checking for error at distance: " << distance << "  Too high error. Packet in error.");
+      return true;
+    }
+
+  NS_LOG_INFO ("Error Model: " << m_ErrorModel << "  distance: " << distance << "  error rate: " << errorRate);
+  if (m_random->GetValue () < errorRate)
+    {
+      NS_LOG_INFO ("Error Model: " << m_ErrorModel << " Checking for error at distance: " << distance << "  Too high error. Packet in error.");
+      return true;
+    }
+  return false;
+}
+
 
 //********************************************************************
 // Stochastic error functions
 
 void SimpleWirelessChannel::InitStochasticModel ()
 {
-  // Build the map of neighbor links, setting all links to
+  // Build the table of neighbor links, setting all links to
   // ON state and pick a duration for that state.
   if (m_ErrorModel == STOCHASTIC)
     {
@@ -287,13 +1437,56 @@ void SimpleWirelessChannel::InitStochasticModel ()
           NS_LOG_ERROR ("InitStochasticModel called but there are no devices on the channel. Be sure to call InitStochasticModel AFTER devices have been added.");
         }
 
+      if (m_stochasticSparseLinks && !m_stochasticLazyLinks)
+        {
+          NS_LOG_WARN ("StochasticSparseLinks without StochasticLazyLinks still creates every link in InitStochasticModel");
+        }
+
       m_randomUp = CreateObject<ExponentialRandomVariable> ();
       m_randomDown = CreateObject<ExponentialRandomVariable> ();
 
       m_randomUp->SetAttribute ("Mean", DoubleValue (m_upDuration.GetMicroSeconds ()));
       m_randomDown->SetAttribute ("Mean", DoubleValue (m_downDuration.GetMicroSeconds ()));
+      m_randomCatchUp = CreateObject<UniformRandomVariable> ();
+      if (m_stochasticStream >= 0)
+        {
+          m_randomUp->SetStream (m_stochasticStream);
+          m_randomDown->SetStream (m_stochasticStream + 1);
+          m_randomCatchUp->SetStream (m_stochasticStream + 2);
+        }
 
-      Time currTime = Simulator::Now ();
+      // Map node ids to dense indices
+      m_stochasticNodeIndex.clear ();
+      m_stochasticNodes = 0;
+      for (std::vector<Ptr<SimpleWirelessNetDevice> >::const_iterator i = m_devices.begin (); i != m_devices.end (); ++i)
+        {
+          uint32_t id = (*i)->GetNode ()->GetId ();
+          if (id >= m_stochasticNodeIndex.size ())
+            {
+              m_stochasticNodeIndex.resize (id + 1, std::numeric_limits<uint32_t>::max ());
+            }
+          if (m_stochasticNodeIndex[id] == std::numeric_limits<uint32_t>::max ())
+            {
+              m_stochasticNodeIndex[id] = m_stochasticNodes++;
+            }
+        }
+
+      m_stochasticSparse.clear ();
+      m_stochasticDense.clear ();
+      if (!m_stochasticSparseLinks)
+        {
+          StochasticLink none;
+          none.linkState = false;
+          none.linkCreated = false;
+          m_stochasticDense.resize (static_cast<std::size_t> (m_stochasticNodes) * m_stochasticNodes, none);
+        }
+
+      m_stochasticInitTime = Simulator::Now ();
+      if (m_stochasticLazyLinks)
+        {
+          // link states are drawn by GetStochasticLink on first use
+          return;
+        }
 
       for (std::vector<Ptr<SimpleWirelessNetDevice> >::const_iterator i = m_devices.begin (); i != m_devices.end (); ++i)
         {
@@ -307,19 +1500,62 @@ void SimpleWirelessChannel::InitStochasticModel ()
                   continue;
                 }
 
-              StochasticLink tempLink;
-              tempLink.linkState = true;
-              tempLink.stateExpireTime = currTime + MicroSeconds (m_randomUp->GetValue ());
-              //tempLink.stateExpireTime = Simulator::Now() + Seconds(1.0);
-
-              m_StochasticLinks.insert (std::pair<StochasticKey, StochasticLink> (StochasticKey (src,dst), tempLink));
-              NS_LOG_DEBUG ("Add link to stochastic map. src: " << src << " dst: " << dst << " expireTime: "
-                                                                << std::setprecision (9) << tempLink.stateExpireTime.GetSeconds () << " state: " << tempLink.linkState);
+              // Draw for every device pair, even if a node has several
+              // devices on the channel, and keep the first state.
+              Time expireTime = m_stochasticInitTime + MicroSeconds (m_randomUp->GetValue ());
+              StochasticLink &link = GetStochasticLink (src, dst);
+              if (!link.linkCreated)
+                {
+                  link.linkState = true;
+                  link.linkCreated = true;
+                  link.stateExpireTime = expireTime;
+                }
+              NS_LOG_DEBUG ("Add link to stochastic table. src: " << src << " dst: " << dst << " expireTime: "
+                                                                  << std::setprecision (9) << link.stateExpireTime.GetSeconds () << " state: " << link.linkState);
             }
         }
     }
 }
 
+StochasticLink &
+SimpleWirelessChannel::GetStochasticLink (uint32_t srcId, uint32_t dstId)
+{
+  NS_ASSERT_MSG (srcId < m_stochasticNodeIndex.size () && m_stochasticNodeIndex[srcId] != std::numeric_limits<uint32_t>::max ()
+                 && dstId < m_stochasticNodeIndex.size () && m_stochasticNodeIndex[dstId] != std::numeric_limits<uint32_t>::max (),
+                 "Node " << srcId << " or " << dstId << " was not on the channel when InitStochasticModel was called");
+  uint32_t src = m_stochasticNodeIndex[srcId];
+  uint32_t dst = m_stochasticNodeIndex[dstId];
+
+  StochasticLink *link;
+  if (!m_stochasticSparseLinks)
+    {
+      link = &m_stochasticDense[static_cast<std::size_t> (src) * m_stochasticNodes + dst];
+    }
+  else
+    {
+      std::pair<std::unordered_map<uint64_t, StochasticLink>::iterator, bool> ins =
+        m_stochasticSparse.insert (std::make_pair ((static_cast<uint64_t> (src) << 32) | dst, StochasticLink ()));
+      link = &ins.first->second;
+      if (ins.second)
+        {
+          link->linkState = false;
+          link->linkCreated = false;
+        }
+    }
+
+  if (!link->linkCreated && m_stochasticLazyLinks)
+    {
+      // Same process as drawing it in InitStochasticModel: the link came
+      // up when the model was initialized.
+      link->linkState = true;
+      link->linkCreated = true;
+      link->stateExpireTime = m_stochasticInitTime + MicroSeconds (m_randomUp->GetValue ());
+      NS_LOG_DEBUG ("Create stochastic link src: " << srcId << " dst: " << dstId << " expireTime: "
+                                                   << std::setprecision (9) << link->stateExpireTime.GetSeconds ());
+    }
+  return *link;
+}
+
 
 // This returns true if we should NOT send the packet.
 // That is, return true == packet fails to send
@@ -328,20 +1564,48 @@ bool SimpleWirelessChannel::CheckStochasticError (uint32_t srcId, uint32_t dstId
 {
   if (m_ErrorModel == STOCHASTIC)
     {
-      // get entry from map for this src/dst pair
-      StochasIt iter = m_StochasticLinks.find (StochasticKey (srcId, dstId));
-      NS_ASSERT ( iter != m_StochasticLinks.end ());
+      // get entry from the table for this src/dst pair
+      StochasticLink &link = GetStochasticLink (srcId, dstId);
+      NS_ASSERT (link.linkCreated);
 
       Time currTime = Simulator::Now ();
 
-      //std::cout << std::setprecision (9) << currTime.GetSeconds() << " Checking state for link src: " << srcId << " dst: " << dstId << " expireTime: " << iter->second.stateExpireTime << std::endl;
+      //std::cout << std::setprecision (9) << currTime.GetSeconds() << " Checking state for link src: " << srcId << " dst: " << dstId << " expireTime: " << link.stateExpireTime << std::endl;
 
-      if (currTime >= iter->second.stateExpireTime)
+      if (currTime >= link.stateExpireTime)
         {
           // the time at which the previous state was set to end has already passed.
-          Time endTime = iter->second.stateExpireTime;
-          bool tempState = iter->second.linkState;
+          Time endTime = link.stateExpireTime;
+          bool tempState = link.linkState;
           Time newDuration;
+          if (m_stochasticCatchUp && (currTime - endTime).GetMicroSeconds ()
+              > m_stochasticCatchUpCycles * (m_randomUp->GetMean () + m_randomDown->GetMean ()))
+            {
+              // The link has been idle for many ON/OFF cycles. The states
+              // form a two state Markov chain, so rather than replaying
+              // every cycle draw the state at the current time from its
+              // transition probability, and the time left in that state
+              // from the same exponential as a fresh state.
+              double upRate = 1.0 / m_randomUp->GetMean ();
+              double downRate = 1.0 / m_randomDown->GetMean ();
+              double elapsed = (currTime - endTime).GetSeconds () * 1e6;
+              double decay = std::exp (-(upRate + downRate) * elapsed);
+              // a state !tempState started at endTime
+              double pUp = downRate / (upRate + downRate);
+              if (!tempState)
+                {
+                  pUp += upRate / (upRate + downRate) * decay;
+                }
+              else
+                {
+                  pUp -= downRate / (upRate + downRate) * decay;
+                }
+              tempState = (m_randomCatchUp->GetValue () < pUp);
+              newDuration = MicroSeconds (tempState ? m_randomUp->GetValue () : m_randomDown->GetValue ());
+              endTime = currTime + newDuration;
+              NS_LOG_DEBUG ("---> " << std::setprecision (9) << currTime.GetSeconds () << " caught up link src: " << srcId << " dst: " << dstId
+                                    << " over " << elapsed << " us. P(ON) " << pUp);
+            }
           // Pick the new states until we get to one that is at or greater
           // than the current time.
           while (endTime < currTime)
@@ -364,24 +1628,24 @@ bool SimpleWirelessChannel::CheckStochasticError (uint32_t srcId, uint32_t dstId
             }
 
           // When we get here, the new state and time are selected
-          iter->second.linkState = tempState;
-          iter->second.stateExpireTime = endTime;
+          link.linkState = tempState;
+          link.stateExpireTime = endTime;
 
-          NS_LOG_DEBUG (std::setprecision (9) << currTime.GetSeconds () << " New state " << iter->second.linkState << " for link src: " << srcId << " dst: " << dstId
+          NS_LOG_DEBUG (std::setprecision (9) << currTime.GetSeconds () << " New state " << link.linkState << " for link src: " << srcId << " dst: " << dstId
                                               << " duration of next state: " << std::setprecision (9) << newDuration.GetSeconds ()
-                                              << " expireTime: " << std::setprecision (9) << iter->second.stateExpireTime.GetSeconds ());
+                                              << " expireTime: " << std::setprecision (9) << link.stateExpireTime.GetSeconds ());
 
         }
       else
         {
-          NS_LOG_DEBUG (std::setprecision (9) << currTime.GetSeconds () << " State " << iter->second.linkState << " for link src: " << srcId << " dst: " << dstId
-                                              << " expireTime: " << std::setprecision (9) << iter->second.stateExpireTime.GetSeconds ());
+          NS_LOG_DEBUG (std::setprecision (9) << currTime.GetSeconds () << " State " << link.linkState << " for link src: " << srcId << " dst: " << dstId
+                                              << " expireTime: " << std::setprecision (9) << link.stateExpireTime.GetSeconds ());
         }
 
       // now return true or false depending on state
       // true = packet is in "error" and failes
       // false = packet not in error and sends
-      if (iter->second.linkState)
+      if (link.linkState)
         {
           return false;
         }
@@ -400,10 +1664,6 @@ bool SimpleWirelessChannel::CheckStochasticError (uint32_t srcId, uint32_t dstId
 
 bool SimpleWirelessChannel::packetInError (double distance)
 {
-  std::map<double, double>::iterator it;
-  std::map<double, double>::iterator up_iter;
-  std::map<double, double>::iterator low_iter;
-
   if (m_ErrorModel == CONSTANT)
     {
       if ( m_random->GetValue () < m_errorRate )
@@ -414,46 +1674,9 @@ bool SimpleWirelessChannel::packetInError (double distance)
     }
   else if (m_ErrorModel == PER_CURVE)
     {
-      it = mPERmap.find (distance);
-      if (it != mPERmap.end ())
-        {
-          // we found an exact match in the map for this distance
-          if (m_random->GetValue () < it->second)
-            {
-              NS_LOG_INFO ("Error Model: " << m_ErrorModel << " Checking for error at distance: " << distance << "  Too high error. Packet in error.");
-              return true;
-            }
-        }
-      else
-        {
-          // we did not find an exact match in the map. That's OK
-          // since it could actually be unlikely to find one.
-          // Now we just extrapolate between the two entries in the map
-
-          // first get iterator to upper bound
-          up_iter = mPERmap.upper_bound (distance);
-          if (up_iter == mPERmap.end ())
-            {
-              // We shouldn't hit this situation because we already checked the distance
-              // relative to the range but go ahead and leave this here
-              // this distance is beyond the upper bound so error is 100%
-              NS_LOG_INFO ("Error Model: " << m_ErrorModel << " Checking for error at distance: " << distance << "  Too high error. Packet in error.");
-              return true;
-            }
-
-          // Set low iter to upper then decrement it
-          low_iter = up_iter;
-          --low_iter;
-
-          double errorRate = low_iter->second + ( ((distance - low_iter->first) / (up_iter->first - low_iter->first)) * (up_iter->second - low_iter->second));
-          NS_LOG_INFO ("Error Model: " << m_ErrorModel << "  distance: " << distance << "  calculated error rate: " << errorRate << "  low distance: " << low_iter->first << "  low error: " << low_iter->second
-                                       << "  high distance: " << up_iter->first << "  high error: " << up_iter->second);
-
-          if (m_random->GetValue () < errorRate)
-            {
-              return true;
-            }
-        }
+      double errorRate;
+      GetPerCurveErrorRates (&distance, &errorRate, 1);
+      return PerCurveInError (distance, errorRate);
     }
 
 
@@ -21,11 +21,17 @@
 #define SIMPLE_WIRELESS_CHANNEL_H
 
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include "ns3/channel.h"
 #include "ns3/mac48-address.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/enum.h"
 #include "ns3/string.h"
+#include "ns3/vector.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/simple-ref-count.h"
 
 
 
@@ -33,6 +39,7 @@ namespace ns3 {
 
 class SimpleWirelessNetDevice;
 class PropagationLossModel;
+class MobilityModel;
 class Packet;
 
 enum ErrorModelType
@@ -58,44 +65,15 @@ enum ErrorModelType
 };
 
 //***************************************************************
-// Define key for stochastic error map key
+// State of the link between two nodes for the stochastic error model
 //***************************************************************
-class StochasticKey
-{
-public:
-  int srcNodeId;
-  int destNodeId;
-
-  StochasticKey (int k1, int k2)
-    : srcNodeId (k1), destNodeId (k2)
-  {
-  }
-
-  // Ordering is:
-  //   1. lowest source node id
-  //   2. lowest destination node id
-
-  bool operator< (const StochasticKey &right) const
-  {
-    if (srcNodeId == right.srcNodeId)
-      {
-        return(destNodeId < right.destNodeId);
-      }
-    else
-      {
-        return (srcNodeId < right.srcNodeId);
-      }
-  }
-};
-
 struct StochasticLink
 {
   bool  linkState;   // 1 = ON, 0 = OFF
+  bool  linkCreated; // state has been drawn
   Time  stateExpireTime;
 };
 
-typedef std::map<StochasticKey, StochasticLink> ::iterator  StochasIt;
-
 /**
  * \ingroup channel
  * \brief A simple channel, for simple things and testing
@@ -124,12 +102,293 @@ public:
   void setErrorRate (double error);
   void addToPERmodel (double distance, double error);
   bool packetInError (double distance);
+
+  /**
+   * Look up the PER curve (see addToPERmodel) for several distances at
+   * once. Distances before the first point of the curve get the error
+   * rate of that point, and distances beyond the last point an error rate
+   * of 1. The curve is compiled into a uniformly bucketed table on the
+   * first lookup after it changes.
+   *
+   * \param distances the distances (meters)
+   * \param errorRates the error rates, one for each distance
+   * \param n the number of distances
+   */
+  void GetPerCurveErrorRates (const double *distances, double *errorRates, std::size_t n);
   void EnableFixedContention (void);
   void SetFixedContentionRange (double error);
+
+  /**
+   * The number of devices contending with a device when fixed contention
+   * is enabled: the device itself plus the devices within the fixed
+   * contention range (MaxRange if it is not set). The counts are built on
+   * first use and updated when mobility models report a course change.
+   *
+   * \param device a device on this channel
+   * \return the count, or 0 if fixed contention is disabled
+   */
+  uint32_t GetContentionCount (Ptr<const SimpleWirelessNetDevice> device);
   void InitStochasticModel ();
   bool CheckStochasticError (uint32_t srcId, uint32_t dstId);
 
+  /**
+   * Enable the uniform grid spatial index used by Send to skip devices
+   * that are beyond the transmission (or fixed contention) range.
+   * The index gives the same results as the linear scan and is
+   * bypassed automatically when it cannot (see EnableSpatialIndex).
+   */
+  void EnableSpatialIndex (void);
+
+  /**
+   * Enable the link budget cache, which keeps the distance, received
+   * power and propagation delay of each (sender, receiver) pair of
+   * stationary devices so that Send does not recompute them on every
+   * packet. Entries for a device are invalidated when its mobility model
+   * reports a course change. The cache is bypassed for loss models that
+   * draw random variates, such as TwoStatePropagationLossModel.
+   */
+  void EnableLinkCache (void);
+
+  /**
+   * Drop all link budget cache entries. Call this after changing the
+   * attributes of the propagation loss model during a simulation.
+   */
+  void FlushLinkCache (void);
+
+  /**
+   * Enable batched delivery. Consecutive receivers of a transmission on
+   * the same node that share an arrival time get the packet from a single
+   * scheduled event, run in the context of that node, and all the
+   * receivers share a single copy of it, instead of one event and one
+   * copy each. Set the
+   * BatchDeliveryResolution attribute to round propagation delays so that
+   * more receivers share an arrival time.
+   */
+  void EnableBatchDelivery (void);
+
+  /**
+   * Enable the geometry kernels. The channel keeps the positions of the
+   * devices in arrays, updated on course changes, and computes the
+   * distance and received power of all the receivers of a transmission
+   * in one pass, vectorized where the CPU allows. Friis and LogDistance
+   * loss models (without a chained model) are evaluated inline; other
+   * models are called through CalcRxPower. Results are the same as
+   * without the kernels.
+   */
+  void EnableGeometryKernels (void);
+
+  /**
+   * Ask for the device to be called back, through HandleStartOfFrame, at
+   * the start of the next slot of the channel slot clock. Slots start at
+   * multiples of the SlotDuration attribute; a request made at the start
+   * of a slot is served in that slot. All the devices waiting for a slot
+   * share one event, run in the order of their requests.
+   *
+   * \param device the device with a frame to send
+   */
+  void RequestSlot (Ptr<SimpleWirelessNetDevice> device);
+
+  /**
+   * Tell every device in range of a sender, through NotifyMediumBusy, when
+   * a transmission starts. Called by the devices that use the DCF MAC.
+   */
+  void EnableCarrierSense (void);
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this channel: the constant error model and the stochastic
+   * link model.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this channel
+   */
+  int64_t AssignStreams (int64_t stream);
+
 private:
+  void StartSlot (void);
+
+  /**
+   * The per transmission state shared by Send and the send kernels
+   */
+  struct SendContext
+  {
+    Ptr<Packet> packet;
+    double txPower;
+    uint16_t protocol;
+    Mac48Address to;
+    Mac48Address from;
+    Ptr<SimpleWirelessNetDevice> sender;
+    Time txTime;
+    uint32_t senderNodeId;
+    Ptr<MobilityModel> mobility;
+    const std::vector<uint32_t> *visit; // devices to visit, or 0 for all
+    std::size_t nVisit;
+    uint32_t senderIdx;
+    bool useLinkCache;
+    bool useKernels;
+  };
+
+  /**
+   * Value of a send kernel policy that is read from the channel for
+   * every receiver instead of being fixed at compile time
+   */
+  enum SendPolicy
+  {
+    POLICY_RUNTIME = -1,
+    POLICY_OFF = 0,
+    POLICY_ON = 1
+  };
+
+  /**
+   * Filter the devices to visit, compute their geometry, apply the error
+   * model and schedule the receptions.
+   *
+   * \tparam ErrorPolicy the ErrorModelType in use, or POLICY_RUNTIME
+   * \tparam LossPolicy POLICY_ON if there is a loss model, POLICY_OFF if
+   * not, or POLICY_RUNTIME
+   * \param ctx the transmission
+   */
+  template <int ErrorPolicy, int LossPolicy>
+  void SendToReceivers (const SendContext &ctx);
+
+  typedef void (SimpleWirelessChannel::*SendKernel)(const SendContext &ctx);
+
+  /**
+   * \return the send kernel for the current error model and loss model
+   */
+  SendKernel GetSendKernel (void) const;
+
+  /**
+   * Decide whether the spatial index can be used for this transmission
+   * and, if so, fill m_candidates with the indices (into m_devices) of
+   * the devices within radius of the sender, in ascending order.
+   *
+   * \param sender the sending mobility model
+   * \param radius the culling radius (meters)
+   * \return true if m_candidates is valid, false to fall back to a full scan
+   */
+  bool GetCandidates (Ptr<MobilityModel> sender, double radius);
+  void BuildSpatialIndex (void);
+  void IndexDevice (uint32_t idx);
+  void UnindexDevice (uint32_t idx);
+  int64_t GetCellKey (double cx, double cy) const;
+
+  /**
+   * Build the device index and hook the CourseChange trace of every
+   * mobility model on the channel. Used by the spatial index and the
+   * link budget cache.
+   */
+  void TrackDevices (void);
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+
+  double GetContentionRange (void) const;
+  bool InContentionRange (uint32_t i, uint32_t j, double range) const;
+  void RefreshPosition (uint32_t idx);
+  void BuildContention (void);
+  /**
+   * Add (or remove) the stationary device idx to (or from) the contention
+   * counts of the stationary devices within range of it.
+   */
+  void UpdateContention (uint32_t idx, bool add);
+
+  /**
+   * \param srcId the source node id
+   * \param dstId the destination node id
+   * \return the stochastic state of the link, drawing its initial state
+   * if it has not been used yet
+   */
+  StochasticLink & GetStochasticLink (uint32_t srcId, uint32_t dstId);
+
+  /**
+   * \param nodeId a node id
+   * \return the indices (into m_devices) of the devices of the node on
+   * this channel, in ascending order
+   */
+  const std::vector<uint32_t> & GetNodeDevices (uint32_t nodeId);
+
+  /**
+   * Cached distance, received power and propagation delay for a link.
+   * The entry is valid while the epochs match the current epochs of the
+   * two devices, and is only used for the tx power it was computed for.
+   */
+  struct LinkBudget
+  {
+    uint32_t srcEpoch {0};
+    uint32_t dstEpoch {0};
+    double txPower {0};
+    double distance {0};
+    double rxPower {0};
+    Time propDelay;
+  };
+
+  /**
+   * \param src index of the sending device in m_devices
+   * \param dst index of the receiving device in m_devices
+   * \param txPower the transmit power (dBm)
+   * \return the (possibly freshly computed) link budget for the pair
+   */
+  const LinkBudget & GetLinkBudget (uint32_t src, uint32_t dst, double txPower);
+
+  /**
+   * Compute the distance, rx power and propagation delay of the receivers
+   * listed in m_geoPending.
+   *
+   * \param sender the sending mobility model
+   * \param txPower the transmit power (dBm)
+   */
+  void ComputeGeometry (Ptr<MobilityModel> sender, double txPower);
+
+  /**
+   * How the geometry kernels evaluate the propagation loss model
+   */
+  enum LossKernel
+  {
+    LOSS_KERNEL_NONE,
+    LOSS_KERNEL_FRIIS,
+    LOSS_KERNEL_LOG_DISTANCE,
+    LOSS_KERNEL_VIRTUAL
+  };
+
+  void BuildPerTable (void);
+  /**
+   * Draw whether a packet is in error for a PER_CURVE error rate
+   * \param distance the distance (meters)
+   * \param errorRate the error rate from GetPerCurveErrorRates
+   * \return true if the packet is in error
+   */
+  bool PerCurveInError (double distance, double errorRate);
+
+  /**
+   * A receiver of a batched delivery
+   */
+  struct BatchReceiver
+  {
+    Ptr<SimpleWirelessNetDevice> device;
+    uint32_t nodeId;
+    double rxPower;
+  };
+
+  /**
+   * The receivers of one transmission that share an arrival time and a
+   * node, so that the event runs in their context. The packet is read only; a receiver that may modify it gets its own copy.
+   */
+  class DeliveryBatch : public SimpleRefCount<DeliveryBatch>
+  {
+  public:
+    Ptr<Packet> packet;
+    uint16_t protocol;
+    Mac48Address to;
+    Mac48Address from;
+    std::vector<BatchReceiver> receivers;
+  };
+
+  /**
+   * Schedule the deliveries collected in m_pendingDeliveries, one event
+   * per run of receivers of the same node with the same arrival time.
+   */
+  void ScheduleBatches (Ptr<Packet> p, uint16_t protocol, Mac48Address to, Mac48Address from);
+  void DeliverBatch (Ptr<DeliveryBatch> batch);
+
   std::vector<Ptr<SimpleWirelessNetDevice> > m_devices;
   double m_range;
   double m_errorRate;
@@ -137,15 +396,123 @@ private:
   ErrorModelType m_ErrorModel;
   Ptr<UniformRandomVariable> m_random;
   std::map<double, double>  mPERmap;
+  // mPERmap compiled into arrays, plus uniform buckets of the distance
+  // range holding the index of the curve point at the start of the bucket
+  bool   m_perTableValid;
+  double m_perTableMin;
+  double m_perTableScale;
+  std::vector<double> m_perDistance;
+  std::vector<double> m_perError;
+  std::vector<uint32_t> m_perBucket;
+
+  // Receivers of the transmission being sent that are in range, as
+  // parallel arrays
+  std::vector<uint32_t> m_rxIndex;
+  std::vector<double> m_rxDistance;
+  std::vector<double> m_rxPower;
+  std::vector<double> m_rxErrorRate;
+  std::vector<Time> m_rxPropDelay;
+
+  // Geometry kernels. m_geoPending holds the positions in the m_rx arrays
+  // of the receivers whose geometry is computed by ComputeGeometry.
+  bool   m_geometryKernelsEnabled;
+  LossKernel m_lossKernel;
+  std::vector<std::size_t> m_geoPending;
+  std::vector<double> m_geoX;
+  std::vector<double> m_geoY;
+  std::vector<double> m_geoZ;
+  std::vector<double> m_geoDistance;
+  std::vector<double> m_geoRxPower;
+
+  bool   m_specializedSendEnabled;
 
   bool   m_fixedContentionEnabled;
   double m_fixedContentionRange;
   Ptr<ExponentialRandomVariable> m_randomUp;
   Ptr<ExponentialRandomVariable> m_randomDown;
+  Ptr<UniformRandomVariable> m_randomCatchUp;
+  int64_t m_stochasticStream; //!< first stream of the STOCHASTIC variables, -1 if not assigned
 
   Time m_upDuration;
   Time m_downDuration;
-  std::map<StochasticKey, StochasticLink>   m_StochasticLinks;
+
+  // Stochastic link states. Node ids are mapped to dense indices by
+  // InitStochasticModel; links are kept in an N x N table indexed by
+  // (src * N + dst), or in a hash map keyed on (src << 32 | dst).
+  bool   m_stochasticLazyLinks;
+  bool   m_stochasticSparseLinks;
+  Time   m_stochasticInitTime;
+  std::vector<uint32_t> m_stochasticNodeIndex;
+  uint32_t m_stochasticNodes;
+  std::vector<StochasticLink> m_stochasticDense;
+  std::unordered_map<uint64_t, StochasticLink> m_stochasticSparse;
+
+  // Direct sampling of the link state after a long idle period
+  bool   m_stochasticCatchUp;
+  double m_stochasticCatchUpCycles;
+
+  // Device tracking. m_deviceEpoch is bumped whenever the mobility model
+  // of the device reports a course change.
+  bool   m_devicesTracked;
+  bool   m_lossModelDeterministic;
+  std::unordered_map<const SimpleWirelessNetDevice *, uint32_t> m_deviceIndex;
+  std::map<const MobilityModel *, std::vector<uint32_t> > m_mobilityDevices;
+  std::vector<bool> m_deviceStationary;
+  std::vector<uint32_t> m_deviceEpoch;
+  std::vector<uint32_t> m_deviceNodeId;
+  std::vector<MobilityModel *> m_deviceMobility;
+  std::vector<double> m_devicePosX;
+  std::vector<double> m_devicePosY;
+  std::vector<double> m_devicePosZ;
+
+  // Fixed contention. m_contentionCount counts, for each stationary
+  // device, the other stationary devices within range. Moving devices are
+  // listed in m_contentionMoving and checked when a count is read; counts
+  // that involve them are kept in m_contentionCached (0 if not computed)
+  // for the rest of m_contentionTime, or until a course change.
+  bool   m_contentionValid;
+  double m_contentionRangeBuilt;
+  std::vector<uint32_t> m_contentionCount;
+  std::vector<uint32_t> m_contentionMoving;
+  Time   m_contentionTime;
+  std::vector<uint32_t> m_contentionCached;
+
+  // Node id to device indices, for directional transmissions
+  bool   m_nodeDevicesValid;
+  std::unordered_map<uint32_t, std::vector<uint32_t> > m_nodeDevices;
+
+  // Spatial index. Devices whose node has a stationary mobility model are
+  // bucketed by (x,y) cell; all others are kept in m_gridAlwaysVisit.
+  bool   m_spatialIndexEnabled;
+  double m_spatialIndexCellSize;
+  double m_gridCellSize;
+  bool   m_gridValid;
+  std::unordered_map<int64_t, std::vector<uint32_t> > m_grid;
+  std::vector<int64_t> m_gridCellOf;
+  std::vector<uint32_t> m_gridAlwaysVisit;
+  std::vector<uint32_t> m_candidates;
+
+  // Link budget cache. Dense N x N table up to m_linkCacheDenseMax
+  // devices, hash map keyed on (src << 32 | dst) above that.
+  bool     m_linkCacheEnabled;
+  uint32_t m_linkCacheDenseMax;
+  std::vector<LinkBudget> m_linkCacheDense;
+  std::unordered_map<uint64_t, LinkBudget> m_linkCacheSparse;
+
+  // Batched delivery. m_pendingDeliveries holds the (delay, receiver)
+  // pairs of the transmission being sent, in device order.
+  bool m_batchDeliveryEnabled;
+  Time m_batchDeliveryResolution;
+  std::vector<std::pair<Time, BatchReceiver> > m_pendingDeliveries;
+
+  // Slot clock for slotted aloha. m_slotWaiting holds the devices
+  // waiting for the slot at which m_slotEvent runs.
+  Time m_slotDuration;
+  EventId m_slotEvent;
+  std::vector<Ptr<SimpleWirelessNetDevice> > m_slotWaiting;
+  std::vector<Ptr<SimpleWirelessNetDevice> > m_slotStarting;
+
+  bool m_carrierSenseEnabled;
 
 };
 
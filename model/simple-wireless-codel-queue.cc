@@ -0,0 +1,385 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cmath>
+#include "simple-wireless-codel-queue.h"
+#include "simple-wireless-net-device.h"
+
+#include "ns3/ethernet-header.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessCoDelQueue");
+
+NS_OBJECT_ENSURE_REGISTERED (SimpleWirelessCoDelQueue);
+
+TypeId
+SimpleWirelessCoDelQueue::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SimpleWirelessCoDelQueue")
+    .SetParent<Queue<Packet> > ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<SimpleWirelessCoDelQueue> ()
+    .AddAttribute ("MaxSize",
+                   "The max queue size, shared by the flows",
+                   QueueSizeValue (QueueSize ("1000p")),
+                   MakeQueueSizeAccessor (&QueueBase::SetMaxSize,
+                                          &QueueBase::GetMaxSize),
+                   MakeQueueSizeChecker ())
+    .AddAttribute ("Target",
+                   "Sojourn time above which packets may be dropped",
+                   TimeValue (MilliSeconds (5)),
+                   MakeTimeAccessor (&SimpleWirelessCoDelQueue::m_target),
+                   MakeTimeChecker ())
+    .AddAttribute ("Interval",
+                   "Time the sojourn time must stay above Target before the first drop",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&SimpleWirelessCoDelQueue::m_interval),
+                   MakeTimeChecker (TimeStep (1)))
+    .AddAttribute ("MinBytes",
+                   "No packet of a flow is dropped while the flow holds this many bytes or fewer",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&SimpleWirelessCoDelQueue::m_minBytes),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Flows",
+                   "Number of flow queues, by destination MAC address and protocol; 1 for plain CoDel",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&SimpleWirelessCoDelQueue::m_nFlows),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Quantum",
+                   "Bytes a flow may send in its turn",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&SimpleWirelessCoDelQueue::m_quantum),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("Sojourn",
+                     "Sojourn time of each packet dequeued",
+                     MakeTraceSourceAccessor (&SimpleWirelessCoDelQueue::m_sojournTrace),
+                     "ns3::Time::TracedCallback")
+  ;
+  return tid;
+}
+
+SimpleWirelessCoDelQueue::SimpleWirelessCoDelQueue ()
+  : m_minBytes (1500),
+    m_nFlows (1),
+    m_quantum (1500),
+    m_selected (-1),
+    m_aqmDrops (0),
+    m_nDequeued (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SimpleWirelessCoDelQueue::~SimpleWirelessCoDelQueue ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SimpleWirelessCoDelQueue::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_flows.clear ();
+  m_newFlows.clear ();
+  m_oldFlows.clear ();
+  m_selected = -1;
+  Queue<Packet>::DoDispose ();
+}
+
+uint32_t
+SimpleWirelessCoDelQueue::GetAqmDrops (void) const
+{
+  return m_aqmDrops;
+}
+
+uint32_t
+SimpleWirelessCoDelQueue::GetNDequeued (void) const
+{
+  return m_nDequeued;
+}
+
+Time
+SimpleWirelessCoDelQueue::GetMeanSojourn (void) const
+{
+  if (m_nDequeued == 0)
+    {
+      return Time (0);
+    }
+  return m_totalSojourn / m_nDequeued;
+}
+
+Time
+SimpleWirelessCoDelQueue::GetMaxSojourn (void) const
+{
+  return m_maxSojourn;
+}
+
+uint32_t
+SimpleWirelessCoDelQueue::Classify (Ptr<const Packet> item) const
+{
+  if (m_nFlows == 1)
+    {
+      return 0;
+    }
+  EthernetHeader ethHeader;
+  item->PeekHeader (ethHeader);
+  uint8_t mac[6];
+  ethHeader.GetDestination ().CopyTo (mac);
+  uint64_t key = ethHeader.GetLengthType ();
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      key = (key << 8) | mac[i];
+    }
+  // Fibonacci hashing; the high bits are the best mixed
+  return ((key * 0x9E3779B97F4A7C15ULL) >> 32) % m_nFlows;
+}
+
+bool
+SimpleWirelessCoDelQueue::Enqueue (Ptr<Packet> item)
+{
+  NS_LOG_FUNCTION (this << item);
+  if (m_flows.empty ())
+    {
+      m_flows.resize (m_nFlows);
+    }
+  uint32_t i = Classify (item);
+
+  Iterator pos;
+  if (!DoEnqueue (GetContainer ().end (), item, pos))
+    {
+      return false;
+    }
+  Flow &flow = m_flows[i];
+  flow.packets.push_back (pos);
+  flow.bytes += item->GetSize ();
+  if (flow.status == Flow::INACTIVE)
+    {
+      flow.status = Flow::NEW_FLOW;
+      flow.deficit = m_quantum;
+      m_newFlows.push_back (i);
+    }
+  NS_LOG_LOGIC ("Packet in flow " << i << ", " << flow.packets.size () << " packets in the flow");
+  return true;
+}
+
+Time
+SimpleWirelessCoDelQueue::GetSojourn (const Flow &flow) const
+{
+  TimestampTags timestamp;
+  if (!(*flow.packets.front ())->PeekPacketTag (timestamp))
+    {
+      return Time (0);
+    }
+  return Simulator::Now () - timestamp.GetTimestamp ();
+}
+
+bool
+SimpleWirelessCoDelQueue::OkToDrop (Flow &flow, Time now)
+{
+  Time sojourn = GetSojourn (flow);
+  // The backlog of the flow, not of the whole queue: a flow holding a
+  // single packet has no standing queue whatever the other flows hold
+  uint32_t bytesLeft = flow.bytes - (*flow.packets.front ())->GetSize ();
+  if (sojourn < m_target || bytesLeft <= m_minBytes)
+    {
+      flow.firstAboveTime = Time (0);
+      return false;
+    }
+  if (flow.firstAboveTime.IsZero ())
+    {
+      flow.firstAboveTime = now + m_interval;
+      return false;
+    }
+  return now >= flow.firstAboveTime;
+}
+
+void
+SimpleWirelessCoDelQueue::DropHead (Flow &flow)
+{
+  ConstIterator pos = flow.packets.front ();
+  flow.packets.pop_front ();
+  Ptr<Packet> item = DoDequeue (pos);
+  flow.bytes -= item->GetSize ();
+  m_aqmDrops++;
+  NS_LOG_LOGIC ("CoDel drop of " << item << ", " << m_aqmDrops << " drops");
+  DropAfterDequeue (item);
+}
+
+void
+SimpleWirelessCoDelQueue::CoDel (Flow &flow, Time now)
+{
+  for (;;)
+    {
+      if (flow.packets.empty ())
+        {
+          flow.firstAboveTime = Time (0);
+          flow.dropping = false;
+          return;
+        }
+      bool okToDrop = OkToDrop (flow, now);
+      if (flow.dropping)
+        {
+          if (!okToDrop)
+            {
+              flow.dropping = false;
+              return;
+            }
+          if (now < flow.dropNext)
+            {
+              return;
+            }
+          DropHead (flow);
+          flow.count++;
+          flow.dropNext += Seconds (m_interval.GetSeconds () / std::sqrt (flow.count));
+          continue;
+        }
+      if (!okToDrop)
+        {
+          return;
+        }
+      // Enter the dropping state, at about the drop rate it was left at
+      // if that was recent
+      DropHead (flow);
+      flow.dropping = true;
+      uint32_t delta = flow.count - flow.lastCount;
+      flow.count = (delta > 1 && now - flow.dropNext < m_interval * 16) ? delta : 1;
+      flow.dropNext = now + Seconds (m_interval.GetSeconds () / std::sqrt (flow.count));
+      flow.lastCount = flow.count;
+    }
+}
+
+int32_t
+SimpleWirelessCoDelQueue::SelectFlow (void)
+{
+  Time now = Simulator::Now ();
+  if (m_selected >= 0 && m_selectedAt == now)
+    {
+      return m_selected;
+    }
+  m_selected = -1;
+  for (;;)
+    {
+      std::list<uint32_t> *flows;
+      if (!m_newFlows.empty ())
+        {
+          flows = &m_newFlows;
+        }
+      else if (!m_oldFlows.empty ())
+        {
+          flows = &m_oldFlows;
+        }
+      else
+        {
+          return -1;
+        }
+      uint32_t i = flows->front ();
+      Flow &flow = m_flows[i];
+      if (flow.deficit <= 0)
+        {
+          flow.deficit += m_quantum;
+          flow.status = Flow::OLD_FLOW;
+          flows->pop_front ();
+          m_oldFlows.push_back (i);
+          continue;
+        }
+      CoDel (flow, now);
+      if (flow.packets.empty ())
+        {
+          flows->pop_front ();
+          // An emptied new flow waits a round as an old flow, so that a
+          // flow cannot stay new by sending one packet at a time
+          if (flows == &m_newFlows && !m_oldFlows.empty ())
+            {
+              flow.status = Flow::OLD_FLOW;
+              m_oldFlows.push_back (i);
+            }
+          else
+            {
+              flow.status = Flow::INACTIVE;
+            }
+          continue;
+        }
+      m_selected = i;
+      m_selectedAt = now;
+      return i;
+    }
+}
+
+Ptr<Packet>
+SimpleWirelessCoDelQueue::Dequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+  int32_t i = SelectFlow ();
+  if (i < 0)
+    {
+      return 0;
+    }
+  m_selected = -1;
+  Flow &flow = m_flows[i];
+  Time sojourn = GetSojourn (flow);
+  ConstIterator pos = flow.packets.front ();
+  flow.packets.pop_front ();
+  Ptr<Packet> item = DoDequeue (pos);
+  flow.bytes -= item->GetSize ();
+  flow.deficit -= item->GetSize ();
+
+  m_nDequeued++;
+  m_totalSojourn += sojourn;
+  m_maxSojourn = std::max (m_maxSojourn, sojourn);
+  m_sojournTrace (sojourn);
+  NS_LOG_LOGIC ("Popped " << item << " from flow " << i << ", sojourn " << sojourn);
+  return item;
+}
+
+Ptr<Packet>
+SimpleWirelessCoDelQueue::Remove (void)
+{
+  NS_LOG_FUNCTION (this);
+  int32_t i = SelectFlow ();
+  if (i < 0)
+    {
+      return 0;
+    }
+  m_selected = -1;
+  Flow &flow = m_flows[i];
+  ConstIterator pos = flow.packets.front ();
+  flow.packets.pop_front ();
+  Ptr<Packet> item = DoRemove (pos);
+  flow.bytes -= item->GetSize ();
+  return item;
+}
+
+Ptr<const Packet>
+SimpleWirelessCoDelQueue::Peek (void) const
+{
+  NS_LOG_FUNCTION (this);
+  // The AQM decides at dequeue which packets are dropped, so finding the
+  // packet Dequeue would return means running it on the head packets
+  int32_t i = const_cast<SimpleWirelessCoDelQueue *> (this)->SelectFlow ();
+  if (i < 0)
+    {
+      return 0;
+    }
+  return *m_flows[i].packets.front ();
+}
+
+} // namespace ns3
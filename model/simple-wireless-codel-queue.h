@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SIMPLE_WIRELESS_CODEL_QUEUE_H
+#define SIMPLE_WIRELESS_CODEL_QUEUE_H
+
+#include <deque>
+#include <list>
+#include <vector>
+#include "ns3/queue.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup simple-wireless
+ * \brief A transmit queue with CoDel, or FQ-CoDel, active queue management
+ *
+ * Used as the TxQueue of a SimpleWirelessNetDevice.  The sojourn time of a
+ * packet is taken from the TimestampTags the device adds when it queues
+ * the packet.  With Flows set to 1 the queue is a single CoDel queue
+ * (RFC 8289): once the sojourn time has stayed above Target for Interval,
+ * packets are dropped at dequeue, ever more often, until it falls below
+ * Target again.  With more flows, packets are hashed into Flows queues by
+ * their destination MAC address and protocol (read from the Ethernet
+ * header the device adds), each with its own CoDel state, and served by
+ * deficit round robin with new flows first, as in FQ-CoDel (RFC 8290).
+ *
+ * A full queue drops the arriving packet.  Packets are dropped rather
+ * than ECN marked, since the device does not look into the IP header.
+ * Peek applies the AQM to the head packets, so that it returns the packet
+ * that Dequeue would return at the same time.
+ */
+class SimpleWirelessCoDelQueue : public Queue<Packet>
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  SimpleWirelessCoDelQueue ();
+  virtual ~SimpleWirelessCoDelQueue ();
+
+  virtual bool Enqueue (Ptr<Packet> item);
+  virtual Ptr<Packet> Dequeue (void);
+  virtual Ptr<Packet> Remove (void);
+  virtual Ptr<const Packet> Peek (void) const;
+
+  /**
+   * \return the number of packets dropped by the AQM, not counting the
+   * packets dropped because the queue was full
+   */
+  uint32_t GetAqmDrops (void) const;
+
+  /**
+   * \return the number of packets dequeued
+   */
+  uint32_t GetNDequeued (void) const;
+
+  /**
+   * \return the mean sojourn time of the packets dequeued
+   */
+  Time GetMeanSojourn (void) const;
+
+  /**
+   * \return the largest sojourn time of a packet dequeued
+   */
+  Time GetMaxSojourn (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * The packets and CoDel state of a flow
+   */
+  struct Flow
+  {
+    enum Status
+    {
+      INACTIVE,
+      NEW_FLOW,
+      OLD_FLOW
+    };
+    std::deque<ConstIterator> packets; //!< packets of the flow, in order
+    uint32_t bytes {0};                //!< bytes of the packets of the flow
+    int32_t deficit {0};               //!< bytes the flow may still send in its turn
+    Status status {INACTIVE};
+    Time firstAboveTime;               //!< when the sojourn time is known to have stayed above Target for Interval
+    Time dropNext;                     //!< time of the next drop in the dropping state
+    uint32_t count {0};                //!< drops since entering the dropping state
+    uint32_t lastCount {0};            //!< count when the dropping state was last entered
+    bool dropping {false};             //!< whether in the dropping state
+  };
+
+  /**
+   * \return the flow of a packet
+   */
+  uint32_t Classify (Ptr<const Packet> item) const;
+
+  /**
+   * \return the sojourn time of the head packet of a flow
+   */
+  Time GetSojourn (const Flow &flow) const;
+
+  /**
+   * Note whether the sojourn time of the head packet of a flow allows
+   * a drop (the ok_to_drop of RFC 8289)
+   */
+  bool OkToDrop (Flow &flow, Time now);
+
+  /**
+   * Drop the head packet of a flow
+   */
+  void DropHead (Flow &flow);
+
+  /**
+   * Apply CoDel to the head packets of a flow until its head packet may
+   * be sent or the flow is empty
+   */
+  void CoDel (Flow &flow, Time now);
+
+  /**
+   * Choose the flow of the next packet, applying CoDel on the way.
+   * Repeated calls at the same time return the same flow until Dequeue.
+   *
+   * \return the flow, or -1 if the queue is empty
+   */
+  int32_t SelectFlow (void);
+
+  Time m_target;          //!< sojourn time target
+  Time m_interval;        //!< width of the moving window
+  uint32_t m_minBytes;    //!< no drops with this many bytes or fewer in the flow
+  uint32_t m_nFlows;      //!< number of flow queues
+  uint32_t m_quantum;     //!< DRR bytes per turn of a flow
+
+  std::vector<Flow> m_flows;
+  std::list<uint32_t> m_newFlows;
+  std::list<uint32_t> m_oldFlows;
+  int32_t m_selected;     //!< flow chosen by SelectFlow, -1 if none
+  Time m_selectedAt;      //!< time of the choice
+
+  uint32_t m_aqmDrops;
+  uint32_t m_nDequeued;
+  Time m_totalSojourn;
+  Time m_maxSojourn;
+
+  /**
+   * The trace source fired when a packet is dequeued, with its sojourn
+   * time
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Time> m_sojournTrace;
+};
+
+} // namespace ns3
+
+#endif /* SIMPLE_WIRELESS_CODEL_QUEUE_H */
@@ -0,0 +1,189 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "simple-wireless-kernels.h"
+
+// The AVX2 kernels are compiled with a target attribute and selected at
+// run time, so the module does not need to be built with -mavx2. Only
+// plain multiplies, adds, divides and square roots are vectorized; these
+// are correctly rounded in AVX2 as in scalar code. log10 is always
+// evaluated with the C library.
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define SIMPLE_WIRELESS_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace ns3 {
+
+namespace SimpleWirelessKernels {
+
+#ifdef SIMPLE_WIRELESS_AVX2
+
+bool
+HaveAvx2 (void)
+{
+  static const bool haveAvx2 = __builtin_cpu_supports ("avx2");
+  return haveAvx2;
+}
+
+__attribute__ ((target ("avx2"))) static std::size_t
+DistancesAvx2 (double x, double y, double z, const double *bx, const double *by, const double *bz,
+               double *distance, std::size_t n)
+{
+  __m256d ax = _mm256_set1_pd (x);
+  __m256d ay = _mm256_set1_pd (y);
+  __m256d az = _mm256_set1_pd (z);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256d dx = _mm256_sub_pd (_mm256_loadu_pd (bx + i), ax);
+      __m256d dy = _mm256_sub_pd (_mm256_loadu_pd (by + i), ay);
+      __m256d dz = _mm256_sub_pd (_mm256_loadu_pd (bz + i), az);
+      __m256d sum = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (dx, dx), _mm256_mul_pd (dy, dy)), _mm256_mul_pd (dz, dz));
+      _mm256_storeu_pd (distance + i, _mm256_sqrt_pd (sum));
+    }
+  return i;
+}
+
+// out[i] = num / (((c * d[i]) * d[i]) * l)
+__attribute__ ((target ("avx2"))) static std::size_t
+FriisRatioAvx2 (double num, double c, double l, const double *distance, double *out, std::size_t n)
+{
+  __m256d vnum = _mm256_set1_pd (num);
+  __m256d vc = _mm256_set1_pd (c);
+  __m256d vl = _mm256_set1_pd (l);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256d d = _mm256_loadu_pd (distance + i);
+      __m256d den = _mm256_mul_pd (_mm256_mul_pd (_mm256_mul_pd (vc, d), d), vl);
+      _mm256_storeu_pd (out + i, _mm256_div_pd (vnum, den));
+    }
+  return i;
+}
+
+// out[i] = d[i] / r
+__attribute__ ((target ("avx2"))) static std::size_t
+DivideAvx2 (double r, const double *distance, double *out, std::size_t n)
+{
+  __m256d vr = _mm256_set1_pd (r);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (out + i, _mm256_div_pd (_mm256_loadu_pd (distance + i), vr));
+    }
+  return i;
+}
+
+#else
+
+bool
+HaveAvx2 (void)
+{
+  return false;
+}
+
+#endif
+
+void
+Distances (double x, double y, double z, const double *bx, const double *by, const double *bz,
+           double *distance, std::size_t n)
+{
+  std::size_t i = 0;
+#ifdef SIMPLE_WIRELESS_AVX2
+  if (HaveAvx2 ())
+    {
+      i = DistancesAvx2 (x, y, z, bx, by, bz, distance, n);
+    }
+#endif
+  // CalculateDistance (a, b) is (b - a).GetLength ()
+  for (; i < n; i++)
+    {
+      double dx = bx[i] - x;
+      double dy = by[i] - y;
+      double dz = bz[i] - z;
+      distance[i] = std::sqrt (dx * dx + dy * dy + dz * dz);
+    }
+}
+
+void
+FriisRxPower (double txPowerDbm, double lambda, double systemLoss, double minLoss,
+              const double *distance, double *rxPowerDbm, std::size_t n)
+{
+  // Same as FriisPropagationLossModel::DoCalcRxPower
+  double numerator = lambda * lambda;
+  double c = 16 * M_PI * M_PI;
+  std::size_t i = 0;
+#ifdef SIMPLE_WIRELESS_AVX2
+  if (HaveAvx2 ())
+    {
+      i = FriisRatioAvx2 (numerator, c, systemLoss, distance, rxPowerDbm, n);
+    }
+#endif
+  for (; i < n; i++)
+    {
+      double denominator = c * distance[i] * distance[i] * systemLoss;
+      rxPowerDbm[i] = numerator / denominator;
+    }
+  for (i = 0; i < n; i++)
+    {
+      if (distance[i] <= 0)
+        {
+          rxPowerDbm[i] = txPowerDbm - minLoss;
+          continue;
+        }
+      double lossDb = -10 * std::log10 (rxPowerDbm[i]);
+      rxPowerDbm[i] = txPowerDbm - std::max (lossDb, minLoss);
+    }
+}
+
+void
+LogDistanceRxPower (double txPowerDbm, double exponent, double referenceDistance, double referenceLoss,
+                    const double *distance, double *rxPowerDbm, std::size_t n)
+{
+  // Same as LogDistancePropagationLossModel::DoCalcRxPower
+  std::size_t i = 0;
+#ifdef SIMPLE_WIRELESS_AVX2
+  if (HaveAvx2 ())
+    {
+      i = DivideAvx2 (referenceDistance, distance, rxPowerDbm, n);
+    }
+#endif
+  for (; i < n; i++)
+    {
+      rxPowerDbm[i] = distance[i] / referenceDistance;
+    }
+  for (i = 0; i < n; i++)
+    {
+      if (distance[i] <= referenceDistance)
+        {
+          rxPowerDbm[i] = txPowerDbm - referenceLoss;
+          continue;
+        }
+      double pathLossDb = 10 * exponent * std::log10 (rxPowerDbm[i]);
+      double rxc = -referenceLoss - pathLossDb;
+      rxPowerDbm[i] = txPowerDbm + rxc;
+    }
+}
+
+} // namespace SimpleWirelessKernels
+
+} // namespace ns3
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SIMPLE_WIRELESS_KERNELS_H
+#define SIMPLE_WIRELESS_KERNELS_H
+
+#include <cstddef>
+
+namespace ns3 {
+
+/**
+ * Array kernels used by SimpleWirelessChannel to compute the geometry of
+ * a transmission for all its receivers at once.
+ *
+ * Each kernel has an AVX2 version, used when the CPU supports it, and a
+ * scalar version. Both evaluate the same expressions, in the same order,
+ * as MobilityModel::GetDistanceFrom and the corresponding propagation
+ * loss model, so the results are bit for bit the same as the per
+ * receiver calls.
+ */
+namespace SimpleWirelessKernels {
+
+/**
+ * \return true if the AVX2 versions of the kernels are used
+ */
+bool HaveAvx2 (void);
+
+/**
+ * Distance from (x, y, z) to each of n positions.
+ *
+ * \param x sender x coordinate
+ * \param y sender y coordinate
+ * \param z sender z coordinate
+ * \param bx receiver x coordinates
+ * \param by receiver y coordinates
+ * \param bz receiver z coordinates
+ * \param distance output distances (meters)
+ * \param n number of receivers
+ */
+void Distances (double x, double y, double z, const double *bx, const double *by, const double *bz,
+                double *distance, std::size_t n);
+
+/**
+ * Received power with FriisPropagationLossModel.
+ *
+ * \param txPowerDbm the transmit power (dBm)
+ * \param lambda the wavelength (meters)
+ * \param systemLoss the system loss (dimensionless)
+ * \param minLoss the minimum loss (dB)
+ * \param distance the distances (meters)
+ * \param rxPowerDbm output received powers (dBm)
+ * \param n number of receivers
+ */
+void FriisRxPower (double txPowerDbm, double lambda, double systemLoss, double minLoss,
+                   const double *distance, double *rxPowerDbm, std::size_t n);
+
+/**
+ * Received power with LogDistancePropagationLossModel.
+ *
+ * \param txPowerDbm the transmit power (dBm)
+ * \param exponent the path loss exponent
+ * \param referenceDistance the reference distance (meters)
+ * \param referenceLoss the loss at the reference distance (dB)
+ * \param distance the distances (meters)
+ * \param rxPowerDbm output received powers (dBm)
+ * \param n number of receivers
+ */
+void LogDistanceRxPower (double txPowerDbm, double exponent, double referenceDistance, double referenceLoss,
+                         const double *distance, double *rxPowerDbm, std::size_t n);
+
+} // namespace SimpleWirelessKernels
+
+} // namespace ns3
+
+#endif /* SIMPLE_WIRELESS_KERNELS_H */
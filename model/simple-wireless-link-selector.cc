@@ -0,0 +1,220 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "simple-wireless-link-selector.h"
+#include "simple-wireless-net-device.h"
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessLinkSelector");
+
+NS_OBJECT_ENSURE_REGISTERED (SimpleWirelessLinkSelector);
+
+TypeId SimpleWirelessLinkSelector::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SimpleWirelessLinkSelector")
+    .SetParent<Object> ()
+    .SetGroupName ("SimpleWireless")
+  ;
+  return tid;
+}
+
+SimpleWirelessLinkSelector::SimpleWirelessLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SimpleWirelessLinkSelector::~SimpleWirelessLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+SimpleWirelessLinkSelector::SelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet)
+{
+  NS_LOG_FUNCTION (this << links.size () << packet);
+  NS_ASSERT_MSG (!links.empty (), "No link to select");
+  uint32_t link = DoSelectLink (links, packet);
+  NS_ASSERT (link < links.size ());
+  return link;
+}
+
+int64_t
+SimpleWirelessLinkSelector::AssignStreams (int64_t stream)
+{
+  return 0;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (ProbabilisticLinkSelector);
+
+TypeId ProbabilisticLinkSelector::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ProbabilisticLinkSelector")
+    .SetParent<SimpleWirelessLinkSelector> ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<ProbabilisticLinkSelector> ()
+  ;
+  return tid;
+}
+
+ProbabilisticLinkSelector::ProbabilisticLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+ProbabilisticLinkSelector::~ProbabilisticLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+ProbabilisticLinkSelector::DoDispose (void)
+{
+  m_random = 0;
+  SimpleWirelessLinkSelector::DoDispose ();
+}
+
+void
+ProbabilisticLinkSelector::SetWeights (const std::vector<double> &weights)
+{
+  NS_LOG_FUNCTION (this << weights.size ());
+  m_cumulative.clear ();
+  double total = 0;
+  for (std::size_t i = 0; i < weights.size (); ++i)
+    {
+      NS_ASSERT_MSG (weights[i] >= 0, "Negative link weight");
+      total += weights[i];
+      m_cumulative.push_back (total);
+    }
+  NS_ASSERT_MSG (weights.empty () || total > 0, "All link weights are zero");
+}
+
+int64_t
+ProbabilisticLinkSelector::AssignStreams (int64_t stream)
+{
+  m_random->SetStream (stream);
+  return 1;
+}
+
+uint32_t
+ProbabilisticLinkSelector::DoSelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet)
+{
+  if (m_cumulative.empty ())
+    {
+      return m_random->GetInteger (0, links.size () - 1);
+    }
+  std::size_t n = std::min (links.size (), m_cumulative.size ());
+  double x = m_random->GetValue (0, m_cumulative[n - 1]);
+  for (std::size_t i = 0; i < n; ++i)
+    {
+      if (x < m_cumulative[i])
+        {
+          return i;
+        }
+    }
+  return n - 1;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (ShortestQueueLinkSelector);
+
+TypeId ShortestQueueLinkSelector::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ShortestQueueLinkSelector")
+    .SetParent<SimpleWirelessLinkSelector> ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<ShortestQueueLinkSelector> ()
+  ;
+  return tid;
+}
+
+ShortestQueueLinkSelector::ShortestQueueLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+ShortestQueueLinkSelector::~ShortestQueueLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+ShortestQueueLinkSelector::DoSelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet)
+{
+  // ties go to the first link
+  uint32_t best = 0;
+  uint32_t bestBacklog = links[0]->GetTxBacklog ();
+  for (uint32_t i = 1; i < links.size (); ++i)
+    {
+      uint32_t backlog = links[i]->GetTxBacklog ();
+      if (backlog < bestBacklog)
+        {
+          best = i;
+          bestBacklog = backlog;
+        }
+    }
+  return best;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (EarliestCompletionLinkSelector);
+
+TypeId EarliestCompletionLinkSelector::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::EarliestCompletionLinkSelector")
+    .SetParent<SimpleWirelessLinkSelector> ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<EarliestCompletionLinkSelector> ()
+  ;
+  return tid;
+}
+
+EarliestCompletionLinkSelector::EarliestCompletionLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+EarliestCompletionLinkSelector::~EarliestCompletionLinkSelector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+EarliestCompletionLinkSelector::DoSelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet)
+{
+  // Ignores the time left on the frame being sent and any contention
+  uint32_t best = 0;
+  double bestTime = 0;
+  for (uint32_t i = 0; i < links.size (); ++i)
+    {
+      double bytes = links[i]->GetTxBacklog () + packet->GetSize ();
+      double time = bytes * 8 / links[i]->GetDataRate ().GetBitRate ();
+      if (i == 0 || time < bestTime)
+        {
+          best = i;
+          bestTime = time;
+        }
+    }
+  return best;
+}
+
+} // namespace ns3
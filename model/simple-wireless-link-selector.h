@@ -0,0 +1,147 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SIMPLE_WIRELESS_LINK_SELECTOR_H
+#define SIMPLE_WIRELESS_LINK_SELECTOR_H
+
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+class Packet;
+class SimpleWirelessNetDevice;
+class UniformRandomVariable;
+
+/**
+ * Chooses the link of a SimpleWirelessMldNetDevice on which a packet is
+ * sent
+ */
+class SimpleWirelessLinkSelector : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  SimpleWirelessLinkSelector ();
+  virtual ~SimpleWirelessLinkSelector ();
+
+  /**
+   * \param links the links of the device, at least one
+   * \param packet the packet to send
+   * \return the index in links of the link to send the packet on
+   */
+  uint32_t SelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet);
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  virtual int64_t AssignStreams (int64_t stream);
+
+private:
+  virtual uint32_t DoSelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet) = 0;
+};
+
+/**
+ * Send each packet on a link drawn at random with fixed probabilities,
+ * like the mldProbLink1 split of single-bss-mld
+ */
+class ProbabilisticLinkSelector : public SimpleWirelessLinkSelector
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  ProbabilisticLinkSelector ();
+  virtual ~ProbabilisticLinkSelector ();
+
+  /**
+   * Set the relative weights of the links; they do not need to add up
+   * to 1. Links without a weight get none. Without weights, the links
+   * are equally likely.
+   *
+   * \param weights the weight of each link, in link order
+   */
+  void SetWeights (const std::vector<double> &weights);
+
+  virtual int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  uint32_t DoSelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet);
+  std::vector<double> m_cumulative; //!< cumulative weights
+  Ptr<UniformRandomVariable> m_random;
+};
+
+/**
+ * Send each packet on the link with the fewest bytes waiting
+ * (join the shortest queue)
+ */
+class ShortestQueueLinkSelector : public SimpleWirelessLinkSelector
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  ShortestQueueLinkSelector ();
+  virtual ~ShortestQueueLinkSelector ();
+
+private:
+  uint32_t DoSelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet);
+};
+
+/**
+ * Send each packet on the link expected to finish sending it first: the
+ * bytes waiting plus the packet, over the data rate of the link
+ */
+class EarliestCompletionLinkSelector : public SimpleWirelessLinkSelector
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  EarliestCompletionLinkSelector ();
+  virtual ~EarliestCompletionLinkSelector ();
+
+private:
+  uint32_t DoSelectLink (const std::vector<Ptr<SimpleWirelessNetDevice> > &links, Ptr<const Packet> packet);
+};
+
+} // namespace ns3
+
+#endif /* SIMPLE_WIRELESS_LINK_SELECTOR_H */
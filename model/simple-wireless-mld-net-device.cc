@@ -0,0 +1,323 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "simple-wireless-mld-net-device.h"
+#include "simple-wireless-net-device.h"
+#include "simple-wireless-link-selector.h"
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessMldNetDevice");
+
+NS_OBJECT_ENSURE_REGISTERED (SimpleWirelessMldNetDevice);
+
+TypeId
+SimpleWirelessMldNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SimpleWirelessMldNetDevice")
+    .SetParent<NetDevice> ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<SimpleWirelessMldNetDevice> ()
+    .AddAttribute ("LinkSelector",
+                   "The policy choosing the link each packet is sent on",
+                   PointerValue (),
+                   MakePointerAccessor (&SimpleWirelessMldNetDevice::SetLinkSelector,
+                                        &SimpleWirelessMldNetDevice::GetLinkSelector),
+                   MakePointerChecker<SimpleWirelessLinkSelector> ())
+    .AddTraceSource ("LinkTx",
+                     "Trace source indicating a packet has been handed to one of the links",
+                     MakeTraceSourceAccessor (&SimpleWirelessMldNetDevice::m_linkTxTrace),
+                     "ns3::SimpleWirelessMldNetDevice::LinkTxTracedCallback")
+    .AddTraceSource ("MacRx",
+                     "A packet has been received on one of the links and is being forwarded up "
+                     "the local protocol stack",
+                     MakeTraceSourceAccessor (&SimpleWirelessMldNetDevice::m_macRxTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+SimpleWirelessMldNetDevice::SimpleWirelessMldNetDevice ()
+  : m_node (0),
+    m_mtu (0xffff),
+    m_ifIndex (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_linkSelector = CreateObject<ProbabilisticLinkSelector> ();
+}
+
+uint32_t
+SimpleWirelessMldNetDevice::AddLink (Ptr<SimpleWirelessNetDevice> link)
+{
+  NS_LOG_FUNCTION (this << link);
+  link->SetAddress (m_address);
+  link->SetNode (m_node);
+  link->SetReceiveCallback (MakeCallback (&SimpleWirelessMldNetDevice::LinkReceive, this));
+  link->SetPromiscReceiveCallback (MakeCallback (&SimpleWirelessMldNetDevice::LinkPromiscReceive, this));
+  m_links.push_back (link);
+  return m_links.size () - 1;
+}
+
+uint32_t
+SimpleWirelessMldNetDevice::GetNLinks (void) const
+{
+  return m_links.size ();
+}
+
+Ptr<SimpleWirelessNetDevice>
+SimpleWirelessMldNetDevice::GetLink (uint32_t i) const
+{
+  NS_ASSERT (i < m_links.size ());
+  return m_links[i];
+}
+
+void
+SimpleWirelessMldNetDevice::SetLinkSelector (Ptr<SimpleWirelessLinkSelector> selector)
+{
+  NS_LOG_FUNCTION (this << selector);
+  NS_ASSERT_MSG (selector, "A link selector is required");
+  m_linkSelector = selector;
+}
+
+Ptr<SimpleWirelessLinkSelector>
+SimpleWirelessMldNetDevice::GetLinkSelector (void) const
+{
+  return m_linkSelector;
+}
+
+int64_t
+SimpleWirelessMldNetDevice::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  int64_t currentStream = stream;
+  currentStream += m_linkSelector->AssignStreams (currentStream);
+  for (std::size_t i = 0; i < m_links.size (); ++i)
+    {
+      currentStream += m_links[i]->AssignStreams (currentStream);
+    }
+  return currentStream - stream;
+}
+
+bool
+SimpleWirelessMldNetDevice::LinkReceive (Ptr<NetDevice> link, Ptr<const Packet> packet, uint16_t protocol,
+                                         const Address &from)
+{
+  NS_LOG_FUNCTION (this << link << packet << protocol << from);
+  m_macRxTrace (packet);
+  if (m_rxCallback.IsNull ())
+    {
+      return false;
+    }
+  return m_rxCallback (this, packet, protocol, from);
+}
+
+bool
+SimpleWirelessMldNetDevice::LinkPromiscReceive (Ptr<NetDevice> link, Ptr<const Packet> packet, uint16_t protocol,
+                                                const Address &from, const Address &to, PacketType packetType)
+{
+  if (m_promiscCallback.IsNull ())
+    {
+      return false;
+    }
+  return m_promiscCallback (this, packet, protocol, from, to, packetType);
+}
+
+bool
+SimpleWirelessMldNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  return SendFrom (packet, m_address, dest, protocolNumber);
+}
+
+bool
+SimpleWirelessMldNetDevice::SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (this << packet << source << dest << protocolNumber);
+  NS_ASSERT_MSG (!m_links.empty (), "No link to send on");
+  uint32_t link = m_linkSelector->SelectLink (m_links, packet);
+  NS_LOG_INFO ("Sending packet " << packet->GetUid () << " on link " << link);
+  m_linkTxTrace (packet, link);
+  return m_links[link]->SendFrom (packet, source, dest, protocolNumber);
+}
+
+void
+SimpleWirelessMldNetDevice::SetIfIndex (const uint32_t index)
+{
+  m_ifIndex = index;
+}
+uint32_t
+SimpleWirelessMldNetDevice::GetIfIndex (void) const
+{
+  return m_ifIndex;
+}
+Ptr<Channel>
+SimpleWirelessMldNetDevice::GetChannel (void) const
+{
+  // Only one channel can be reported; use the first link's
+  if (m_links.empty ())
+    {
+      return 0;
+    }
+  return m_links[0]->GetChannel ();
+}
+void
+SimpleWirelessMldNetDevice::SetAddress (Address address)
+{
+  m_address = Mac48Address::ConvertFrom (address);
+  for (std::size_t i = 0; i < m_links.size (); ++i)
+    {
+      m_links[i]->SetAddress (address);
+    }
+}
+Address
+SimpleWirelessMldNetDevice::GetAddress (void) const
+{
+  return m_address;
+}
+bool
+SimpleWirelessMldNetDevice::SetMtu (const uint16_t mtu)
+{
+  m_mtu = mtu;
+  for (std::size_t i = 0; i < m_links.size (); ++i)
+    {
+      m_links[i]->SetMtu (mtu);
+    }
+  return true;
+}
+uint16_t
+SimpleWirelessMldNetDevice::GetMtu (void) const
+{
+  return m_mtu;
+}
+bool
+SimpleWirelessMldNetDevice::IsLinkUp (void) const
+{
+  return true;
+}
+void
+SimpleWirelessMldNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+}
+bool
+SimpleWirelessMldNetDevice::IsBroadcast (void) const
+{
+  return true;
+}
+Address
+SimpleWirelessMldNetDevice::GetBroadcast (void) const
+{
+  return Mac48Address ("ff:ff:ff:ff:ff:ff");
+}
+bool
+SimpleWirelessMldNetDevice::IsMulticast (void) const
+{
+  return false;
+}
+Address
+SimpleWirelessMldNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast (multicastGroup);
+}
+
+Address SimpleWirelessMldNetDevice::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+bool
+SimpleWirelessMldNetDevice::IsPointToPoint (void) const
+{
+  return false;
+}
+
+bool
+SimpleWirelessMldNetDevice::IsBridge (void) const
+{
+  return false;
+}
+
+Ptr<Node>
+SimpleWirelessMldNetDevice::GetNode (void) const
+{
+  return m_node;
+}
+void
+SimpleWirelessMldNetDevice::SetNode (Ptr<Node> node)
+{
+  m_node = node;
+  for (std::size_t i = 0; i < m_links.size (); ++i)
+    {
+      m_links[i]->SetNode (node);
+    }
+}
+bool
+SimpleWirelessMldNetDevice::NeedsArp (void) const
+{
+  return true;
+}
+void
+SimpleWirelessMldNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+void
+SimpleWirelessMldNetDevice::SetPromiscReceiveCallback (PromiscReceiveCallback cb)
+{
+  m_promiscCallback = cb;
+}
+
+bool
+SimpleWirelessMldNetDevice::SupportsSendFrom (void) const
+{
+  return true;
+}
+
+void
+SimpleWirelessMldNetDevice::DoInitialize (void)
+{
+  NS_LOG_FUNCTION (this);
+  // the links are not on the node, so the node does not initialize them
+  for (std::size_t i = 0; i < m_links.size (); ++i)
+    {
+      m_links[i]->Initialize ();
+    }
+  NetDevice::DoInitialize ();
+}
+
+void
+SimpleWirelessMldNetDevice::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::size_t i = 0; i < m_links.size (); ++i)
+    {
+      m_links[i]->Dispose ();
+    }
+  m_links.clear ();
+  m_linkSelector = 0;
+  m_node = 0;
+  m_rxCallback.Nullify ();
+  m_promiscCallback.Nullify ();
+  NetDevice::DoDispose ();
+}
+
+} // namespace ns3
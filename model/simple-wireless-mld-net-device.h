@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SIMPLE_WIRELESS_MLD_NET_DEVICE_H
+#define SIMPLE_WIRELESS_MLD_NET_DEVICE_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/traced-callback.h"
+#include "ns3/net-device.h"
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+class Node;
+class SimpleWirelessNetDevice;
+class SimpleWirelessLinkSelector;
+
+/**
+ * \ingroup simple-wireless
+ * \brief A multi-link device over several SimpleWirelessNetDevice links
+ *
+ * Each link is a SimpleWirelessNetDevice attached to its own
+ * SimpleWirelessChannel, with its own DataRate, queue and MAC state (for
+ * example DCF).  The multi-link device is the one added to the node: it
+ * gives its address to all of its links, sends each packet on the link
+ * chosen by its SimpleWirelessLinkSelector, and passes up the packets
+ * received on any link as its own.  Links are not added to the node.
+ */
+class SimpleWirelessMldNetDevice : public NetDevice
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  SimpleWirelessMldNetDevice ();
+
+  /**
+   * Add a link.  The link takes the address and node of this device; it
+   * should already have its channel, data rate and queue.
+   *
+   * \param link the link to add
+   * \return the index of the link
+   */
+  uint32_t AddLink (Ptr<SimpleWirelessNetDevice> link);
+
+  /**
+   * \return the number of links
+   */
+  uint32_t GetNLinks (void) const;
+
+  /**
+   * \param i the index of the link
+   * \return the link
+   */
+  Ptr<SimpleWirelessNetDevice> GetLink (uint32_t i) const;
+
+  /**
+   * \param selector the policy choosing the link of each packet
+   */
+  void SetLinkSelector (Ptr<SimpleWirelessLinkSelector> selector);
+
+  /**
+   * \return the policy choosing the link of each packet
+   */
+  Ptr<SimpleWirelessLinkSelector> GetLinkSelector (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model and its links.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  // inherited from NetDevice base class.
+  virtual void SetIfIndex (const uint32_t index);
+  virtual uint32_t GetIfIndex (void) const;
+  virtual Ptr<Channel> GetChannel (void) const;
+  virtual void SetAddress (Address address);
+  virtual Address GetAddress (void) const;
+  virtual bool SetMtu (const uint16_t mtu);
+  virtual uint16_t GetMtu (void) const;
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+  virtual bool IsBroadcast (void) const;
+  virtual Address GetBroadcast (void) const;
+  virtual bool IsMulticast (void) const;
+  virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+  virtual Address GetMulticast (Ipv6Address addr) const;
+  virtual bool IsPointToPoint (void) const;
+  virtual bool IsBridge (void) const;
+  virtual bool Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+  virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+  virtual Ptr<Node> GetNode (void) const;
+  virtual void SetNode (Ptr<Node> node);
+  virtual bool NeedsArp (void) const;
+  virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+  virtual void SetPromiscReceiveCallback (PromiscReceiveCallback cb);
+  virtual bool SupportsSendFrom (void) const;
+
+  /**
+   * TracedCallback signature for link transmit events
+   *
+   * \param [in] p the packet
+   * \param [in] link the index of the link the packet is sent on
+   */
+  typedef void (*LinkTxTracedCallback)(Ptr<const Packet> p, uint32_t link);
+
+protected:
+  virtual void DoDispose (void);
+  virtual void DoInitialize (void);
+
+private:
+  /**
+   * Pass up a packet received on a link
+   */
+  bool LinkReceive (Ptr<NetDevice> link, Ptr<const Packet> packet, uint16_t protocol, const Address &from);
+  /**
+   * Pass up a packet sniffed on a link
+   */
+  bool LinkPromiscReceive (Ptr<NetDevice> link, Ptr<const Packet> packet, uint16_t protocol,
+                           const Address &from, const Address &to, PacketType packetType);
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > m_links; //!< the links
+  Ptr<SimpleWirelessLinkSelector> m_linkSelector;      //!< the link selection policy
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscCallback;
+  Ptr<Node> m_node;
+  uint16_t m_mtu;
+  uint32_t m_ifIndex;
+  Mac48Address m_address;
+
+  /**
+   * The trace source fired when a packet is handed to a link, with the
+   * index of the link.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, uint32_t> m_linkTxTrace;
+
+  /**
+   * The trace source fired for packets received on any link and passed
+   * up.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macRxTrace;
+};
+
+} // namespace ns3
+
+#endif /* SIMPLE_WIRELESS_MLD_NET_DEVICE_H */
@@ -0,0 +1,290 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "simple-wireless-multi-queue.h"
+#include "simple-wireless-net-device.h"
+
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessMultiQueue");
+
+NS_OBJECT_ENSURE_REGISTERED (SimpleWirelessMultiQueue);
+
+TypeId
+SimpleWirelessMultiQueue::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SimpleWirelessMultiQueue")
+    .SetParent<Queue<Packet> > ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<SimpleWirelessMultiQueue> ()
+    .AddAttribute ("MaxSize",
+                   "The max queue size, shared by the sub-queues",
+                   QueueSizeValue (QueueSize ("100p")),
+                   MakeQueueSizeAccessor (&QueueBase::SetMaxSize,
+                                          &QueueBase::GetMaxSize),
+                   MakeQueueSizeChecker ())
+    .AddAttribute ("Scheduler",
+                   "How the sub-queue of the next packet is chosen",
+                   EnumValue (STRICT_PRIORITY),
+                   MakeEnumAccessor<Scheduler> (&SimpleWirelessMultiQueue::m_scheduler),
+                   MakeEnumChecker (STRICT_PRIORITY, "StrictPriority",
+                                    WEIGHTED_ROUND_ROBIN, "WeightedRoundRobin",
+                                    DEFICIT_ROUND_ROBIN, "DeficitRoundRobin"))
+    .AddAttribute ("AcMapping",
+                   "One sub-queue per 802.11 access category (VO, VI, BE, BK) instead of one per "
+                   "socket priority (7 down to 0)",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&SimpleWirelessMultiQueue::m_acMapping),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Quantum",
+                   "Bytes a sub-queue of weight 1 may send in its turn, with DeficitRoundRobin",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&SimpleWirelessMultiQueue::m_quantum),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("SubQueueLatency",
+                     "A packet has left a sub-queue, with the time since it was queued",
+                     MakeTraceSourceAccessor (&SimpleWirelessMultiQueue::m_subQueueLatencyTrace),
+                     "ns3::SimpleWirelessMultiQueue::SubQueueLatencyTracedCallback")
+  ;
+  return tid;
+}
+
+SimpleWirelessMultiQueue::SimpleWirelessMultiQueue ()
+  : m_scheduler (STRICT_PRIORITY),
+    m_acMapping (true),
+    m_quantum (1500)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < MAX_SUB_QUEUES; i++)
+    {
+      m_weights[i] = 1;
+      m_subQueueBytes[i] = 0;
+      m_state.deficit[i] = 0;
+    }
+  m_state.current = 0;
+  m_state.fresh = true;
+  m_state.credit = m_weights[0];
+}
+
+SimpleWirelessMultiQueue::~SimpleWirelessMultiQueue ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SimpleWirelessMultiQueue::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < MAX_SUB_QUEUES; i++)
+    {
+      m_subQueues[i].clear ();
+      m_subQueueBytes[i] = 0;
+    }
+  Queue<Packet>::DoDispose ();
+}
+
+void
+SimpleWirelessMultiQueue::SetWeights (const std::vector<uint32_t> &weights)
+{
+  NS_LOG_FUNCTION (this << weights.size ());
+  NS_ASSERT_MSG (weights.size () <= MAX_SUB_QUEUES, "More weights than sub-queues");
+  for (uint32_t i = 0; i < MAX_SUB_QUEUES; i++)
+    {
+      m_weights[i] = i < weights.size () ? weights[i] : 1;
+      NS_ASSERT_MSG (m_weights[i] >= 1, "Sub-queue weights must be at least 1");
+    }
+  m_state.credit = m_weights[m_state.current];
+}
+
+uint32_t
+SimpleWirelessMultiQueue::GetNSubQueues (void) const
+{
+  return m_acMapping ? 4 : MAX_SUB_QUEUES;
+}
+
+uint32_t
+SimpleWirelessMultiQueue::GetSubQueue (uint8_t priority) const
+{
+  // 802.11 user priority to access category: 1 and 2 are BK, 0 and 3 BE,
+  // 4 and 5 VI, 6 and 7 VO
+  static const uint32_t acSubQueue[8] = {2, 3, 3, 2, 1, 1, 0, 0};
+  priority &= 0x07;
+  return m_acMapping ? acSubQueue[priority] : 7 - priority;
+}
+
+uint32_t
+SimpleWirelessMultiQueue::GetSubQueueNPackets (uint32_t i) const
+{
+  NS_ASSERT (i < MAX_SUB_QUEUES);
+  return m_subQueues[i].size ();
+}
+
+uint32_t
+SimpleWirelessMultiQueue::GetSubQueueNBytes (uint32_t i) const
+{
+  NS_ASSERT (i < MAX_SUB_QUEUES);
+  return m_subQueueBytes[i];
+}
+
+bool
+SimpleWirelessMultiQueue::Enqueue (Ptr<Packet> item)
+{
+  NS_LOG_FUNCTION (this << item);
+  SocketPriorityTag priorityTag;
+  uint8_t priority = 0;
+  if (item->PeekPacketTag (priorityTag))
+    {
+      priority = priorityTag.GetPriority ();
+    }
+  uint32_t i = GetSubQueue (priority);
+
+  Iterator pos;
+  if (!DoEnqueue (GetContainer ().end (), item, pos))
+    {
+      return false;
+    }
+  NS_LOG_LOGIC ("Packet of priority " << +priority << " in sub-queue " << i);
+  m_subQueues[i].push_back (pos);
+  m_subQueueBytes[i] += item->GetSize ();
+  return true;
+}
+
+uint32_t
+SimpleWirelessMultiQueue::Schedule (SchedulerState &state) const
+{
+  uint32_t n = GetNSubQueues ();
+  switch (m_scheduler)
+    {
+    case WEIGHTED_ROUND_ROBIN:
+      for (;;)
+        {
+          if (!m_subQueues[state.current].empty () && state.credit > 0)
+            {
+              return state.current;
+            }
+          state.current = (state.current + 1) % n;
+          state.credit = m_weights[state.current];
+        }
+    case DEFICIT_ROUND_ROBIN:
+      for (;;)
+        {
+          const std::deque<ConstIterator> &subQueue = m_subQueues[state.current];
+          if (subQueue.empty ())
+            {
+              // an idle sub-queue does not save up bytes
+              state.deficit[state.current] = 0;
+            }
+          else
+            {
+              if (state.fresh)
+                {
+                  state.deficit[state.current] += m_quantum * m_weights[state.current];
+                  state.fresh = false;
+                }
+              if ((*subQueue.front ())->GetSize () <= state.deficit[state.current])
+                {
+                  return state.current;
+                }
+            }
+          state.current = (state.current + 1) % n;
+          state.fresh = true;
+        }
+    case STRICT_PRIORITY:
+    default:
+      for (uint32_t i = 0; i < n; i++)
+        {
+          if (!m_subQueues[i].empty ())
+            {
+              return i;
+            }
+        }
+    }
+  NS_FATAL_ERROR ("No packet to schedule");
+  return 0;
+}
+
+Ptr<Packet>
+SimpleWirelessMultiQueue::TakeHead (uint32_t i, bool dequeue)
+{
+  ConstIterator pos = m_subQueues[i].front ();
+  m_subQueues[i].pop_front ();
+  m_subQueueBytes[i] -= (*pos)->GetSize ();
+  return dequeue ? DoDequeue (pos) : DoRemove (pos);
+}
+
+Ptr<Packet>
+SimpleWirelessMultiQueue::Dequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (IsEmpty ())
+    {
+      return 0;
+    }
+  uint32_t i = Schedule (m_state);
+  Ptr<Packet> item = TakeHead (i, true);
+  if (m_scheduler == WEIGHTED_ROUND_ROBIN)
+    {
+      m_state.credit--;
+    }
+  else if (m_scheduler == DEFICIT_ROUND_ROBIN)
+    {
+      m_state.deficit[i] -= item->GetSize ();
+    }
+
+  TimestampTags timestamp;
+  if (item->PeekPacketTag (timestamp))
+    {
+      m_subQueueLatencyTrace (item, i, Simulator::Now () - timestamp.GetTimestamp ());
+    }
+  NS_LOG_LOGIC ("Popped " << item << " from sub-queue " << i);
+  return item;
+}
+
+Ptr<Packet>
+SimpleWirelessMultiQueue::Remove (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (IsEmpty ())
+    {
+      return 0;
+    }
+  SchedulerState state = m_state;
+  return TakeHead (Schedule (state), false);
+}
+
+Ptr<const Packet>
+SimpleWirelessMultiQueue::Peek (void) const
+{
+  NS_LOG_FUNCTION (this);
+  if (IsEmpty ())
+    {
+      return 0;
+    }
+  SchedulerState state = m_state;
+  return *m_subQueues[Schedule (state)].front ();
+}
+
+} // namespace ns3
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SIMPLE_WIRELESS_MULTI_QUEUE_H
+#define SIMPLE_WIRELESS_MULTI_QUEUE_H
+
+#include <deque>
+#include <vector>
+#include "ns3/queue.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup simple-wireless
+ * \brief A transmit queue with one sub-queue per priority
+ *
+ * Used as the TxQueue of a SimpleWirelessNetDevice.  Packets are put in a
+ * sub-queue by the priority of their SocketPriorityTag (0 without one):
+ * with AcMapping, one sub-queue per 802.11 access category, in the order
+ * VO, VI, BE, BK; otherwise one per priority, from 7 down to 0.  Sub-queue
+ * 0 has the highest priority.  The packets share the MaxSize of the queue.
+ *
+ * The Scheduler picks the sub-queue of the next packet:
+ * - StrictPriority: the first sub-queue that is not empty
+ * - WeightedRoundRobin: up to weight packets of each sub-queue in turn
+ * - DeficitRoundRobin: up to Quantum times weight bytes of each sub-queue
+ *   in turn, the unused bytes carried to its next turn while it has
+ *   packets
+ *
+ * Peek returns the packet that Dequeue would return.
+ */
+class SimpleWirelessMultiQueue : public Queue<Packet>
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  SimpleWirelessMultiQueue ();
+  virtual ~SimpleWirelessMultiQueue ();
+
+  /**
+   * Sub-queue scheduling disciplines
+   */
+  enum Scheduler
+  {
+    STRICT_PRIORITY,
+    WEIGHTED_ROUND_ROBIN,
+    DEFICIT_ROUND_ROBIN
+  };
+
+  /**
+   * Set the weights of the sub-queues for the round robin schedulers;
+   * the sub-queues without a weight get 1.
+   *
+   * \param weights the weight of each sub-queue, at least 1, in sub-queue order
+   */
+  void SetWeights (const std::vector<uint32_t> &weights);
+
+  /**
+   * \return the number of sub-queues, 4 with AcMapping and 8 otherwise
+   */
+  uint32_t GetNSubQueues (void) const;
+
+  /**
+   * \param priority a socket priority
+   * \return the sub-queue of the packets with this priority
+   */
+  uint32_t GetSubQueue (uint8_t priority) const;
+
+  /**
+   * \param i the index of a sub-queue
+   * \return the number of packets in the sub-queue
+   */
+  uint32_t GetSubQueueNPackets (uint32_t i) const;
+
+  /**
+   * \param i the index of a sub-queue
+   * \return the number of bytes in the sub-queue
+   */
+  uint32_t GetSubQueueNBytes (uint32_t i) const;
+
+  virtual bool Enqueue (Ptr<Packet> item);
+  virtual Ptr<Packet> Dequeue (void);
+  virtual Ptr<Packet> Remove (void);
+  virtual Ptr<const Packet> Peek (void) const;
+
+  /**
+   * TracedCallback signature for sub-queue latency reports
+   *
+   * \param [in] p the packet
+   * \param [in] subQueue the index of the sub-queue the packet left
+   * \param [in] latency the time the packet spent in the queue
+   */
+  typedef void (*SubQueueLatencyTracedCallback)(Ptr<const Packet> p, uint32_t subQueue, Time latency);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  static const uint32_t MAX_SUB_QUEUES = 8;
+
+  /**
+   * The scheduler position, kept apart so that Peek can work on a copy
+   */
+  struct SchedulerState
+  {
+    uint32_t current;                  //!< sub-queue having its turn
+    bool fresh;                        //!< the turn of current has just begun
+    uint32_t credit;                   //!< packets left in the turn, for WRR
+    uint32_t deficit[MAX_SUB_QUEUES];  //!< bytes available to each sub-queue, for DRR
+  };
+
+  /**
+   * \param state the scheduler position, moved to the sub-queue chosen
+   * \return the sub-queue of the next packet; the queue must not be empty
+   */
+  uint32_t Schedule (SchedulerState &state) const;
+
+  /**
+   * Take the head packet of a sub-queue out of the queue
+   */
+  Ptr<Packet> TakeHead (uint32_t i, bool dequeue);
+
+  Scheduler m_scheduler;   //!< sub-queue scheduling discipline
+  bool m_acMapping;        //!< one sub-queue per access category instead of per priority
+  uint32_t m_quantum;      //!< DRR bytes per weight and turn
+  uint32_t m_weights[MAX_SUB_QUEUES];
+  std::deque<ConstIterator> m_subQueues[MAX_SUB_QUEUES]; //!< packets of each sub-queue, in order
+  uint32_t m_subQueueBytes[MAX_SUB_QUEUES];
+  SchedulerState m_state;
+
+  /**
+   * The trace source fired when a packet leaves a sub-queue, with the time
+   * since it was queued by the device
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, uint32_t, Time> m_subQueueLatencyTrace;
+};
+
+} // namespace ns3
+
+#endif /* SIMPLE_WIRELESS_MULTI_QUEUE_H */
@@ -17,19 +17,24 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  */
+#include <algorithm>
+#include <cmath>
 #include "ns3/node.h"
 #include "ns3/packet.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
+#include "ns3/uinteger.h"
 #include "ns3/error-model.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/socket.h"
+#include "ns3/queue-item.h"
 #include "simple-wireless-net-device.h"
 #include "simple-wireless-channel.h"
+#include "simple-wireless-multi-queue.h"
+#include "simple-wireless-rate-manager.h"
 #include "snr-per-error-model.h"
 
-#include <netinet/in.h>  // needed for noth for protocol # in sniffer
-
 NS_LOG_COMPONENT_DEFINE ("SimpleWirelessNetDevice");
 
 namespace ns3 {
@@ -154,6 +159,297 @@ void DestinationIdTag::Print (std::ostream &os) const
 
 //********************************************************
 
+//********************************************************
+//  AggregateTag marks a frame made of several packets
+//  sent together, each preceded by a SubframeHeader
+//********************************************************
+TypeId AggregateTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("AggregateTag")
+    .SetParent<Tag> ()
+    .AddConstructor<AggregateTag> ()
+  ;
+  return tid;
+}
+
+TypeId AggregateTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+AggregateTag::AggregateTag ()
+  : m_nSubframes (0)
+{
+}
+
+uint32_t AggregateTag::GetSerializedSize (void) const
+{
+  return 4;
+}
+
+void AggregateTag::Serialize (TagBuffer i) const
+{
+  i.WriteU32 (m_nSubframes);
+}
+
+void AggregateTag::Deserialize (TagBuffer i)
+{
+  m_nSubframes = i.ReadU32 ();
+}
+
+void AggregateTag::SetNSubframes (uint32_t n)
+{
+  m_nSubframes = n;
+}
+
+uint32_t AggregateTag::GetNSubframes (void) const
+{
+  return m_nSubframes;
+}
+
+void AggregateTag::Print (std::ostream &os) const
+{
+  os << "n=" << m_nSubframes;
+}
+
+//********************************************************
+
+//********************************************************
+//  SubframeHeader gives the length and protocol of a
+//  packet in an aggregate frame
+//********************************************************
+TypeId SubframeHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("SubframeHeader")
+    .SetParent<Header> ()
+    .AddConstructor<SubframeHeader> ()
+  ;
+  return tid;
+}
+
+TypeId SubframeHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+SubframeHeader::SubframeHeader ()
+  : m_length (0),
+    m_protocol (0)
+{
+}
+
+uint32_t SubframeHeader::GetSerializedSize (void) const
+{
+  return 6;
+}
+
+void SubframeHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU32 (m_length);
+  start.WriteHtonU16 (m_protocol);
+}
+
+uint32_t SubframeHeader::Deserialize (Buffer::Iterator start)
+{
+  m_length = start.ReadNtohU32 ();
+  m_protocol = start.ReadNtohU16 ();
+  return 6;
+}
+
+void SubframeHeader::SetLength (uint32_t length)
+{
+  m_length = length;
+}
+
+uint32_t SubframeHeader::GetLength (void) const
+{
+  return m_length;
+}
+
+void SubframeHeader::SetProtocol (uint16_t protocol)
+{
+  m_protocol = protocol;
+}
+
+uint16_t SubframeHeader::GetProtocol (void) const
+{
+  return m_protocol;
+}
+
+void SubframeHeader::Print (std::ostream &os) const
+{
+  os << "length=" << m_length << " protocol=" << m_protocol;
+}
+
+//********************************************************
+
+//********************************************************
+//  ArqTag marks a frame sent with link-layer ARQ, which
+//  starts with an ArqHeader
+//********************************************************
+TypeId ArqTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ArqTag")
+    .SetParent<Tag> ()
+    .AddConstructor<ArqTag> ()
+  ;
+  return tid;
+}
+
+TypeId ArqTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+ArqTag::ArqTag ()
+{
+}
+
+uint32_t ArqTag::GetSerializedSize (void) const
+{
+  return 0;
+}
+
+void ArqTag::Serialize (TagBuffer i) const
+{
+}
+
+void ArqTag::Deserialize (TagBuffer i)
+{
+}
+
+void ArqTag::Print (std::ostream &os) const
+{
+  os << "arq";
+}
+
+//********************************************************
+
+//********************************************************
+//  ArqHeader gives the type (data or ACK) and sequence
+//  number of a link-layer ARQ frame
+//********************************************************
+TypeId ArqHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ArqHeader")
+    .SetParent<Header> ()
+    .AddConstructor<ArqHeader> ()
+  ;
+  return tid;
+}
+
+TypeId ArqHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+ArqHeader::ArqHeader ()
+  : m_type (DATA),
+    m_seq (0)
+{
+}
+
+uint32_t ArqHeader::GetSerializedSize (void) const
+{
+  return 3;
+}
+
+void ArqHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_type);
+  start.WriteHtonU16 (m_seq);
+}
+
+uint32_t ArqHeader::Deserialize (Buffer::Iterator start)
+{
+  m_type = start.ReadU8 ();
+  m_seq = start.ReadNtohU16 ();
+  return 3;
+}
+
+void ArqHeader::SetType (FrameType type)
+{
+  m_type = type;
+}
+
+ArqHeader::FrameType ArqHeader::GetType (void) const
+{
+  return static_cast<FrameType> (m_type);
+}
+
+void ArqHeader::SetSequence (uint16_t seq)
+{
+  m_seq = seq;
+}
+
+uint16_t ArqHeader::GetSequence (void) const
+{
+  return m_seq;
+}
+
+void ArqHeader::Print (std::ostream &os) const
+{
+  os << (m_type == ACK ? "ACK" : "DATA") << " seq=" << m_seq;
+}
+
+//********************************************************
+
+//********************************************************
+//  McsTag gives the index, in the MCS table of the
+//  SimpleWirelessRateManager, of the rate a frame is
+//  sent at
+//********************************************************
+TypeId McsTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("McsTag")
+    .SetParent<Tag> ()
+    .AddConstructor<McsTag> ()
+  ;
+  return tid;
+}
+
+TypeId McsTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+McsTag::McsTag ()
+  : m_mcs (0)
+{
+}
+
+uint32_t McsTag::GetSerializedSize (void) const
+{
+  return 1;
+}
+
+void McsTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_mcs);
+}
+
+void McsTag::Deserialize (TagBuffer i)
+{
+  m_mcs = i.ReadU8 ();
+}
+
+void McsTag::SetMcs (uint8_t mcs)
+{
+  m_mcs = mcs;
+}
+
+uint8_t McsTag::GetMcs (void) const
+{
+  return m_mcs;
+}
+
+void McsTag::Print (std::ostream &os) const
+{
+  os << "mcs=" << +m_mcs;
+}
+
+//********************************************************
+
 TypeId
 SimpleWirelessNetDevice::GetTypeId (void)
 {
@@ -165,6 +461,11 @@ SimpleWirelessNetDevice::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&SimpleWirelessNetDevice::m_receiveErrorModel),
                    MakePointerChecker<ErrorModel> ())
+    .AddAttribute ("RateManager",
+                   "Chooses the rate of each unicast frame by destination, instead of DataRate",
+                   PointerValue (),
+                   MakePointerAccessor (&SimpleWirelessNetDevice::m_rateManager),
+                   MakePointerChecker<SimpleWirelessRateManager> ())
     .AddAttribute ("DataRate",
                    "The default data rate for point to point links",
                    DataRateValue (DataRate ("1000000b/s")),
@@ -185,13 +486,144 @@ SimpleWirelessNetDevice::GetTypeId (void)
     .AddAttribute ("TxQueue",
                    "A queue to use as the transmit queue in the device.",
                    PointerValue (),
-                   MakePointerAccessor (&SimpleWirelessNetDevice::m_queue),
+                   MakePointerAccessor (&SimpleWirelessNetDevice::SetQueue,
+                                        &SimpleWirelessNetDevice::GetQueue),
                    MakePointerChecker<Queue<Packet> > ())
+    .AddAttribute ("TxDescriptorQueue",
+                   "Queue packets in a ring of descriptors holding their addresses, protocol, destination "
+                   "and enqueue time, instead of adding an Ethernet header and tags. TxQueue is not used.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessNetDevice::m_txDescriptorQueue),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TxDescriptorQueueSize",
+                   "Maximum number of packets waiting in the descriptor queue",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::SetTxDescriptorQueueSize,
+                                         &SimpleWirelessNetDevice::GetTxDescriptorQueueSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TxQueueHighWatermark",
+                   "Fill of the transmit queue (TxQueue or the descriptor queue), as a fraction of its max "
+                   "size, at which the transmit queues of the NetDeviceQueueInterface are stopped",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&SimpleWirelessNetDevice::m_txHighWatermark),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("TxQueueLowWatermark",
+                   "Fill of the transmit queue, as a fraction of its max size, below which the stopped "
+                   "transmit queues of the NetDeviceQueueInterface are woken",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&SimpleWirelessNetDevice::m_txLowWatermark),
+                   MakeDoubleChecker<double> (0.0, 1.0))
     .AddAttribute ("SlottedAloha",
-                   "Whether to enable slotted aloha behavior",
+                   "Whether to enable slotted aloha behavior. Queued frames are sent at the start of the "
+                   "slots of the channel (see SimpleWirelessChannel::SlotDuration) and a receiver loses "
+                   "all the frames that arrive together, unless SlottedAlohaCapture is enabled.",
                    BooleanValue (false),
                    MakeBooleanAccessor (&SimpleWirelessNetDevice::m_slottedAloha),
                    MakeBooleanChecker ())
+    .AddAttribute ("SlottedAlohaCapture",
+                   "With slotted aloha, decode the strongest of the frames that arrive together if its "
+                   "SINR against the others and the noise is at least CaptureThreshold, instead of losing "
+                   "them all.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessNetDevice::m_slottedAlohaCapture),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CaptureThreshold",
+                   "SINR (dB) needed to capture a frame out of a slotted aloha collision",
+                   DoubleValue (10),
+                   MakeDoubleAccessor (&SimpleWirelessNetDevice::m_captureThreshold),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("AggregationMaxPackets",
+                   "Most packets sent in one frame. When more than 1, the packets that follow the next one "
+                   "in TxQueue with the same destination are sent with it as one aggregate frame, up to "
+                   "AggregationMaxBytes; the receiver draws errors for each of them.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_aggregationMaxPackets),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("AggregationMaxBytes",
+                   "Most bytes sent in one aggregate frame, including a 6 byte subframe header per packet",
+                   UintegerValue (65535),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_aggregationMaxBytes),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Dcf",
+                   "Whether to access the medium with a lightweight CSMA/CA (DCF) MAC: queued frames are "
+                   "sent after DIFS and a random backoff, unicast frames are acknowledged and retried. "
+                   "All the devices on the channel should use it.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessNetDevice::m_dcf),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DcfSlot",
+                   "DCF slot time",
+                   TimeValue (MicroSeconds (9)),
+                   MakeTimeAccessor (&SimpleWirelessNetDevice::m_dcfSlot),
+                   MakeTimeChecker (TimeStep (1)))
+    .AddAttribute ("DcfSifs",
+                   "DCF short interframe space, before an ACK",
+                   TimeValue (MicroSeconds (16)),
+                   MakeTimeAccessor (&SimpleWirelessNetDevice::m_dcfSifs),
+                   MakeTimeChecker ())
+    .AddAttribute ("DcfDifs",
+                   "DCF interframe space before the backoff",
+                   TimeValue (MicroSeconds (34)),
+                   MakeTimeAccessor (&SimpleWirelessNetDevice::m_dcfDifs),
+                   MakeTimeChecker ())
+    .AddAttribute ("DcfAckDuration",
+                   "Duration of an ACK",
+                   TimeValue (MicroSeconds (44)),
+                   MakeTimeAccessor (&SimpleWirelessNetDevice::m_dcfAckDuration),
+                   MakeTimeChecker ())
+    .AddAttribute ("DcfPhyHeader",
+                   "Duration of the preamble and PHY header added to each DCF frame",
+                   TimeValue (MicroSeconds (20)),
+                   MakeTimeAccessor (&SimpleWirelessNetDevice::m_dcfPhyHeader),
+                   MakeTimeChecker ())
+    .AddAttribute ("DcfCwMin",
+                   "Minimum DCF contention window; the backoff is drawn in [0, CW] slots",
+                   UintegerValue (15),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_dcfCwMin),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DcfCwMax",
+                   "Maximum DCF contention window",
+                   UintegerValue (1023),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_dcfCwMax),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DcfRetryLimit",
+                   "Number of retransmissions of an unacknowledged frame before it is dropped",
+                   UintegerValue (7),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_dcfRetryLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Arq",
+                   "Whether to retransmit unicast frames until the receiver acknowledges them with an ACK "
+                   "frame sent over the channel (selective repeat ARQ). Needs a TxQueue; not used with Dcf, "
+                   "SlottedAloha or TxDescriptorQueue. All the devices on the channel should use it.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SimpleWirelessNetDevice::m_arq),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ArqWindowSize",
+                   "Most unacknowledged ARQ frames to a destination; 1 for stop-and-wait",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_arqWindowSize),
+                   MakeUintegerChecker<uint32_t> (1, 16384))
+    .AddAttribute ("ArqRetryLimit",
+                   "Number of retransmissions of an unacknowledged ARQ frame before it is dropped",
+                   UintegerValue (7),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_arqRetryLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ArqAckTimeout",
+                   "Time from the end of an ARQ frame after which it is retransmitted if no ACK came",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&SimpleWirelessNetDevice::m_arqAckTimeout),
+                   MakeTimeChecker (TimeStep (1)))
+    .AddAttribute ("ArqAckSize",
+                   "Size of an ARQ ACK frame, including its 3 byte ARQ header",
+                   UintegerValue (14),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_arqAckSize),
+                   MakeUintegerChecker<uint32_t> (3))
+    .AddAttribute ("PcapSnapLen",
+                   "Maximum number of bytes of each packet written by EnablePcapAll. The default "
+                   "fits the largest packet plus its 14 byte Ethernet header.",
+                   UintegerValue (0xffff + 14),
+                   MakeUintegerAccessor (&SimpleWirelessNetDevice::m_pcapSnapLen),
+                   MakeUintegerChecker<uint32_t> (1))
     .AddAttribute ("FixedNeighborListEnabled",
                    "Enabled or Disabled",
                    BooleanValue (false),
@@ -231,6 +663,26 @@ SimpleWirelessNetDevice::GetTypeId (void)
                      "queueing for transmission.",
                      MakeTraceSourceAccessor (&SimpleWirelessNetDevice::m_macTxTrace),
                      "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacTxDrop",
+                     "A packet has been dropped by the device because the transmit queue was full, or "
+                     "because the DCF or ARQ retry limit was reached.",
+                     MakeTraceSourceAccessor (&SimpleWirelessNetDevice::m_macTxDropTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("DcfAccessDelay",
+                     "A DCF frame has been acknowledged, or sent if broadcast. Reports the time since the "
+                     "frame reached the head of the queue.",
+                     MakeTraceSourceAccessor (&SimpleWirelessNetDevice::m_dcfAccessDelayTrace),
+                     "ns3::SimpleWirelessNetDevice::QueueLatencyTracedCallback")
+    .AddTraceSource ("ArqRetries",
+                     "An ARQ frame has been acknowledged, or dropped at the retry limit. Reports its number "
+                     "of retransmissions.",
+                     MakeTraceSourceAccessor (&SimpleWirelessNetDevice::m_arqRetriesTrace),
+                     "ns3::SimpleWirelessNetDevice::ArqRetriesTracedCallback")
+    .AddTraceSource ("ArqAccessDelay",
+                     "An ARQ frame has been acknowledged. Reports the time since its first transmission "
+                     "began.",
+                     MakeTraceSourceAccessor (&SimpleWirelessNetDevice::m_arqAccessDelayTrace),
+                     "ns3::SimpleWirelessNetDevice::QueueLatencyTracedCallback")
     .AddTraceSource ("MacRx",
                      "A packet has been received by this device, has been passed up from the physical layer "
                      "and is being forwarded up the local protocol stack.  This is a non-promiscuous trace,",
@@ -252,14 +704,53 @@ SimpleWirelessNetDevice::SimpleWirelessNetDevice ()
   m_ifIndex (0),
   m_txMachineState (READY),
   m_queue (NULL),
+  m_txDescriptorQueue (false),
+  m_txRingHead (0),
+  m_txRingCount (0),
+  m_txRingBytes (0),
+  m_txRingSize (100),
+  m_txCurrentNext (0),
+  m_txHighWatermark (1.0),
+  m_txLowWatermark (1.0),
+  m_txQueueStopped (false),
   m_pktRcvTotal (0),
   m_pktRcvDrop (0),
   m_pcapEnabled (false),
+  m_pcapSnapLen (0xffff + 14),
   m_fixedNbrListEnabled (false),
   m_nbrCount (0),
   m_snrPerErrorModel (0),
+  m_rateManager (0),
+  m_txMcs (0),
   m_slottedAlohaReceptions (0),
-  m_receiverProcessingDelay (MicroSeconds (1))
+  m_slottedAlohaCapture (false),
+  m_captureThreshold (10),
+  m_slotInterference (0),
+  m_slotRequested (false),
+  m_aggregationMaxPackets (1),
+  m_aggregationMaxBytes (65535),
+  m_receiverProcessingDelay (MicroSeconds (1)),
+  m_dcf (false),
+  m_dcfSlot (MicroSeconds (9)),
+  m_dcfSifs (MicroSeconds (16)),
+  m_dcfDifs (MicroSeconds (34)),
+  m_dcfAckDuration (MicroSeconds (44)),
+  m_dcfPhyHeader (MicroSeconds (20)),
+  m_dcfCwMin (15),
+  m_dcfCwMax (1023),
+  m_dcfRetryLimit (7),
+  m_dcfCw (15),
+  m_dcfBackoff (0),
+  m_dcfRetries (0),
+  m_dcfRetry (false),
+  m_arq (false),
+  m_arqWindowSize (1),
+  m_arqRetryLimit (7),
+  m_arqAckTimeout (MilliSeconds (1)),
+  m_arqAckSize (14),
+  m_arqCurrent (false),
+  m_arqCurrentKey (0),
+  m_arqCurrentSeq (0)
 {
   NS_LOG_FUNCTION (this);
   m_uniformRv = CreateObject<UniformRandomVariable> ();
@@ -269,6 +760,28 @@ void
 SimpleWirelessNetDevice::DoInitialize (void)
 {
   NS_LOG_FUNCTION (this);
+  // The traffic control layer looks for the queue interface of the
+  // devices when the node is initialized, after its devices
+  if (!m_queueInterface)
+    {
+      CreateQueueInterface (1);
+    }
+  if (m_dcf)
+    {
+      if (m_channel)
+        {
+          m_channel->EnableCarrierSense ();
+        }
+      // Stations do not all start with the same backoff
+      m_dcfCw = m_dcfCwMin;
+      m_dcfBackoff = m_uniformRv->GetInteger (0, m_dcfCw);
+    }
+  NS_ABORT_MSG_IF (m_dcf && !m_queue && !m_txDescriptorQueue, "Dcf needs a TxQueue or TxDescriptorQueue");
+  // An aggregate frame would be acknowledged as a whole as soon as one of
+  // its subframes is received, so lost subframes would not be retransmitted
+  NS_ABORT_MSG_IF (m_arq && (!m_queue || m_txDescriptorQueue || m_dcf || m_slottedAloha || m_aggregationMaxPackets > 1),
+                   "ARQ needs a TxQueue and is not used with Dcf, SlottedAloha, TxDescriptorQueue or AggregationMaxPackets > 1");
+  NS_ABORT_MSG_IF (m_rateManager && m_rateManager->GetNMcs () == 0, "The RateManager has no MCS");
 }
 
 void
@@ -276,25 +789,40 @@ SimpleWirelessNetDevice::Receive (Ptr<Packet> packet, double rxPower, uint16_t p
                                   Mac48Address to, Mac48Address from)
 {
   NS_LOG_FUNCTION (packet << rxPower << protocol << to << from);
-  if (m_slottedAloha)
+  if (m_dcf)
+    {
+      DcfReceive (packet, rxPower, protocol, to, from);
+    }
+  else if (m_slottedAloha)
     {
       if (m_slottedAlohaReceptions == 0)
         {
           m_receiveEvent = Simulator::Schedule (m_receiverProcessingDelay, &SimpleWirelessNetDevice::HandleReceive, this);
         }
-      struct ReceivedPacket receivedPkt;
-      receivedPkt.packet = packet;
-      receivedPkt.rxPower = rxPower;
-      receivedPkt.protocol = protocol;
-      receivedPkt.to = to;
-      receivedPkt.from = from;
       NS_LOG_DEBUG ("Deferring reception of packet with rxPower " << rxPower);
-      m_receiveList.push_back (receivedPkt);
+      // Only the strongest frame of the slot can be decoded, so it is the
+      // only one kept; the others just add to its interference
+      if (rxPower > m_slotCandidate.rxPower)
+        {
+          if (m_slottedAlohaReceptions > 0)
+            {
+              m_slotInterference += std::pow (10.0, m_slotCandidate.rxPower / 10.0);
+            }
+          m_slotCandidate.packet = packet;
+          m_slotCandidate.rxPower = rxPower;
+          m_slotCandidate.protocol = protocol;
+          m_slotCandidate.to = to;
+          m_slotCandidate.from = from;
+        }
+      else
+        {
+          m_slotInterference += std::pow (10.0, rxPower / 10.0);
+        }
       m_slottedAlohaReceptions++;
     }
   else
     {
-      DoReceive (packet, rxPower, protocol, to, from);
+      ReceiveFrame (packet, rxPower, protocol, to, from, rxPower - m_noisePower, false);
     }
 }
 
@@ -302,28 +830,89 @@ void
 SimpleWirelessNetDevice::HandleReceive (void)
 {
   NS_LOG_FUNCTION (this);
-  struct ReceivedPacket bestPkt;
   NS_LOG_DEBUG ("Handling " << m_slottedAlohaReceptions << " candidate packets in slot");
-  auto it = m_receiveList.begin ();
-  if (m_slottedAlohaReceptions == 1)
+  // Take the candidate out first, as DoReceive may call back into the device
+  struct ReceivedPacket bestPkt = m_slotCandidate;
+  double interference = m_slotInterference;
+  uint32_t receptions = m_slottedAlohaReceptions;
+  m_slotCandidate = ReceivedPacket ();
+  m_slotInterference = 0;
+  m_slottedAlohaReceptions = 0;
+
+  if (receptions == 1)
     {
-      bestPkt = (*it);
       NS_LOG_DEBUG ("Receiving packet with rxPower = " << bestPkt.rxPower);
-      DoReceive (bestPkt.packet, bestPkt.rxPower, bestPkt.protocol, bestPkt.to, bestPkt.from);
+      ReceiveFrame (bestPkt.packet, bestPkt.rxPower, bestPkt.protocol, bestPkt.to, bestPkt.from,
+                    bestPkt.rxPower - m_noisePower, false);
     }
-  else if (m_slottedAlohaReceptions > 1)
+  else if (receptions > 1)
     {
-      NS_LOG_DEBUG ("MAC collision model; " << m_slottedAlohaReceptions << " receptions received");
+      if (!m_slottedAlohaCapture)
+        {
+          NS_LOG_DEBUG ("MAC collision model; " << receptions << " receptions received");
+          return;
+        }
+      double sinr = bestPkt.rxPower - 10 * std::log10 (interference + std::pow (10.0, m_noisePower / 10.0));
+      if (sinr < m_captureThreshold)
+        {
+          NS_LOG_DEBUG ("MAC collision model; " << receptions << " receptions received, SINR "
+                        << sinr << " dB of the strongest below the capture threshold");
+          return;
+        }
+      NS_LOG_DEBUG ("Capturing packet with rxPower = " << bestPkt.rxPower << " SINR " << sinr
+                    << " out of " << receptions << " receptions");
+      ReceiveFrame (bestPkt.packet, bestPkt.rxPower, bestPkt.protocol, bestPkt.to, bestPkt.from, sinr, false);
     }
-  m_slottedAlohaReceptions = 0;
-  m_receiveList.clear ();
 }
 
-void
+bool
+SimpleWirelessNetDevice::ReceiveFrame (Ptr<Packet> packet, double rxPower, uint16_t protocol,
+                                       Mac48Address to, Mac48Address from, double sinr, bool duplicate)
+{
+  if (m_rateManager)
+    {
+      m_rateManager->NotifyRxSnr (from, sinr);
+    }
+
+  ArqTag arqTag;
+  if (packet->PeekPacketTag (arqTag))
+    {
+      return ArqReceive (packet, rxPower, protocol, to, from, sinr);
+    }
+
+  Ptr<SnrPerErrorModel> perModel = GetRxPerModel (packet);
+  AggregateTag aggregateTag;
+  if (!packet->PeekPacketTag (aggregateTag))
+    {
+      return DoReceive (packet, rxPower, protocol, to, from, sinr, perModel, duplicate);
+    }
+
+  // The subframes are received one after the other, each with its own
+  // error draw; the frame counts as received if any of them is
+  NS_LOG_DEBUG ("Receiving aggregate of " << aggregateTag.GetNSubframes () << " packets");
+  Ptr<Packet> frame = packet->Copy ();
+  frame->RemovePacketTag (aggregateTag);
+  bool received = false;
+  SubframeHeader subframeHeader;
+  while (frame->GetSize () > 0)
+    {
+      frame->RemoveHeader (subframeHeader);
+      Ptr<Packet> subframe = frame->CreateFragment (0, subframeHeader.GetLength ());
+      frame->RemoveAtStart (subframeHeader.GetLength ());
+      if (DoReceive (subframe, rxPower, subframeHeader.GetProtocol (), to, from, sinr, perModel, duplicate))
+        {
+          received = true;
+        }
+    }
+  return received;
+}
+
+bool
 SimpleWirelessNetDevice::DoReceive (Ptr<Packet> packet, double rxPower, uint16_t protocol,
-                                  Mac48Address to, Mac48Address from)
+                                  Mac48Address to, Mac48Address from, double sinr,
+                                  Ptr<SnrPerErrorModel> perModel, bool duplicate)
 {
-  NS_LOG_FUNCTION (packet << rxPower << protocol << to << from);
+  NS_LOG_FUNCTION (packet << rxPower << protocol << to << from << sinr << perModel << duplicate);
   NetDevice::PacketType packetType;
   
   m_phyRxBeginTrace (packet, rxPower, from);
@@ -335,30 +924,14 @@ SimpleWirelessNetDevice::DoReceive (Ptr<Packet> packet, double rxPower, uint16_t
     {
       m_phyRxDropTrace (packet, rxPower, from);
       m_pktRcvDrop++;
-      return;
+      return false;
     }
 
   if (m_pcapEnabled)
     {
-      // Add the ethernet header to the packet for sniffer
-      // For some reason the Ethernet header is STRIPPED from the packet
-      // by the time we get here so we need to reconstruct it for the
-      // sniffer.
-      // allocate buffer for packet and mac addresses
-      uint8_t buffer[8192];
-      uint8_t macBuffer[6];
-      // get the dest and src addresses and copy into the buffer
-      to.CopyTo (macBuffer);
-      memcpy (&buffer[0], macBuffer, 6);
-      from.CopyTo (macBuffer);
-      memcpy (&buffer[6], macBuffer, 6);
-      //copy the protocol and the actual packet data in the the buffer
-      uint16_t tempProt = ntohs (protocol);
-      memcpy (&buffer[12], &tempProt, 2);
-      packet->CopyData (&buffer[14], packet->GetSize ());
-      // Now make a new temp packet to write to the sniffer
-      Ptr<Packet> tempPacket = Create<Packet> (buffer, packet->GetSize () + 14);
-      m_promiscSnifferTrace (tempPacket);
+      // The Ethernet header is not sent over the air, so it is rebuilt
+      // for the sniffer
+      Sniff (packet, to, from, protocol);
     }
 
   if (to == m_address)
@@ -380,16 +953,16 @@ SimpleWirelessNetDevice::DoReceive (Ptr<Packet> packet, double rxPower, uint16_t
 
   m_phyRxEndTrace (packet, rxPower, from);
 
-  if (m_snrPerErrorModel)
+  if (perModel)
     {
-      double per = m_snrPerErrorModel->Receive (rxPower - m_noisePower, packet->GetSize ());
-      NS_LOG_DEBUG ("PER " << per << " SNR " << rxPower - m_noisePower << " size " << packet->GetSize ());
+      double per = perModel->Receive (sinr, packet->GetSize ());
+      NS_LOG_DEBUG ("PER " << per << " SINR " << sinr << " size " << packet->GetSize ());
       if (per > m_uniformRv->GetValue ())
         {
           NS_LOG_DEBUG ("Dropping packet based on random variable");
           m_phyRxDropTrace (packet, rxPower, from);
           m_pktRcvDrop++;
-          return;
+          return false;
         }
     }
 
@@ -399,9 +972,17 @@ SimpleWirelessNetDevice::DoReceive (Ptr<Packet> packet, double rxPower, uint16_t
     {
       m_macRxDropTrace (packet);
       m_pktRcvDrop++;
-      return;
+      return false;
     }
 
+  // A retransmission of a frame already passed up, whose ACK was lost
+  if (duplicate)
+    {
+      NS_LOG_DEBUG ("Dropping duplicate packet from " << from);
+      m_macRxDropTrace (packet);
+      m_pktRcvDrop++;
+      return true;
+    }
 
   if (packetType != NetDevice::PACKET_OTHERHOST)
     {
@@ -416,6 +997,7 @@ SimpleWirelessNetDevice::DoReceive (Ptr<Packet> packet, double rxPower, uint16_t
     }
 
   NS_LOG_DEBUG ("Total Rcvd: " << m_pktRcvTotal << " Total Dropped: " << m_pktRcvDrop);
+  return true;
 }
 
 void
@@ -431,6 +1013,12 @@ SimpleWirelessNetDevice::SetReceiveErrorModel (Ptr<ErrorModel> em)
   m_receiveErrorModel = em;
 }
 
+Ptr<ErrorModel>
+SimpleWirelessNetDevice::GetReceiveErrorModel (void) const
+{
+  return m_receiveErrorModel;
+}
+
 void
 SimpleWirelessNetDevice::SetSnrPerErrorModel (Ptr<SnrPerErrorModel> em)
 {
@@ -443,6 +1031,31 @@ SimpleWirelessNetDevice::GetSnrPerErrorModel (void) const
   return m_snrPerErrorModel;
 }
 
+void
+SimpleWirelessNetDevice::SetRateManager (Ptr<SimpleWirelessRateManager> manager)
+{
+  m_rateManager = manager;
+}
+
+Ptr<SimpleWirelessRateManager>
+SimpleWirelessNetDevice::GetRateManager (void) const
+{
+  return m_rateManager;
+}
+
+Ptr<SnrPerErrorModel>
+SimpleWirelessNetDevice::GetRxPerModel (Ptr<const Packet> packet) const
+{
+  McsTag mcsTag;
+  if (m_rateManager && packet->PeekPacketTag (mcsTag))
+    {
+      NS_ABORT_MSG_IF (mcsTag.GetMcs () >= m_rateManager->GetNMcs (),
+                       "Frame sent at MCS " << +mcsTag.GetMcs () << ", not in the MCS table");
+      return m_rateManager->GetPerModel (mcsTag.GetMcs ());
+    }
+  return m_snrPerErrorModel;
+}
+
 void
 SimpleWirelessNetDevice::SetIfIndex (const uint32_t index)
 {
@@ -542,7 +1155,10 @@ bool SimpleWirelessNetDevice::AddDirectionalNeighbors (std::map<uint32_t, Mac48A
 
   for ( std::map<uint32_t, Mac48Address> ::iterator it = nodesToAdd.begin (); it != nodesToAdd.end (); ++it)
     {
-      mDirectionalNbrs.insert (std::pair<uint32_t, Mac48Address> (it->first, it->second));
+      if (mDirectionalNbrs.insert (std::pair<uint32_t, Mac48Address> (it->first, it->second)).second)
+        {
+          IndexDirectionalNeighbor (it->first, it->second);
+        }
       NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " added directional neighbor " << it->first << " mac Address " << it->second);
     }
   return true;
@@ -557,7 +1173,10 @@ bool SimpleWirelessNetDevice::AddDirectionalNeighbor (uint32_t nodeid, Mac48Addr
       return false;
     }
 
-  mDirectionalNbrs.insert (std::pair<uint32_t, Mac48Address> (nodeid, macAddr));
+  if (mDirectionalNbrs.insert (std::pair<uint32_t, Mac48Address> (nodeid, macAddr)).second)
+    {
+      IndexDirectionalNeighbor (nodeid, macAddr);
+    }
   NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " added directional neighbor " << nodeid << " mac Address " << macAddr);
   return true;
 }
@@ -570,7 +1189,9 @@ void SimpleWirelessNetDevice::DeleteDirectionalNeighbors (std::set<uint32_t> nod
       if (it2 != mDirectionalNbrs.end ())
         {
           NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " deleted directional neighbor " << it2->first << " mac Address " << it2->second);
+          Mac48Address macAddr = it2->second;
           mDirectionalNbrs.erase (it2);
+          UnindexDirectionalNeighbor (*it, macAddr);
         }
     }
 }
@@ -581,10 +1202,92 @@ void SimpleWirelessNetDevice::DeleteDirectionalNeighbor (uint32_t nodeid)
   if (it != mDirectionalNbrs.end ())
     {
       NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " deleted directional neighbor " << nodeid << " mac Address " << it->second);
+      Mac48Address macAddr = it->second;
       mDirectionalNbrs.erase (it);
+      UnindexDirectionalNeighbor (nodeid, macAddr);
+    }
+}
+
+bool SimpleWirelessNetDevice::SetDirectionalNeighbors (std::map<uint32_t, Mac48Address> nodes)
+{
+  // is directional neighbor feature enabled?
+  // If not return false so caller knows there is a problem
+  if (!m_fixedNbrListEnabled)
+    {
+      return false;
+    }
+
+  // Build the new index aside and swap both in, so that the list and
+  // the index are never out of step. Nodes are visited in ascending
+  // order, so an address shared by several nodes maps to the lowest id.
+  std::unordered_map<uint64_t, uint32_t> index;
+  for (std::map<uint32_t, Mac48Address>::const_iterator it = nodes.begin (); it != nodes.end (); ++it)
+    {
+      index.insert (std::make_pair (GetMacKey (it->second), it->first));
+    }
+  mDirectionalNbrs.swap (nodes);
+  m_directionalNbrIndex.swap (index);
+  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " replaced its " << nodes.size () << " directional neighbors with " << mDirectionalNbrs.size ());
+  return true;
+}
+
+uint64_t
+SimpleWirelessNetDevice::GetMacKey (Mac48Address macAddr)
+{
+  uint8_t buffer[6];
+  macAddr.CopyTo (buffer);
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      key = (key << 8) | buffer[i];
+    }
+  return key;
+}
+
+void
+SimpleWirelessNetDevice::IndexDirectionalNeighbor (uint32_t nodeid, Mac48Address macAddr)
+{
+  // A unicast goes to the lowest node id with the destination address
+  std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> result =
+    m_directionalNbrIndex.insert (std::make_pair (GetMacKey (macAddr), nodeid));
+  if (!result.second && nodeid < result.first->second)
+    {
+      result.first->second = nodeid;
+    }
+}
+
+void
+SimpleWirelessNetDevice::UnindexDirectionalNeighbor (uint32_t nodeid, Mac48Address macAddr)
+{
+  std::unordered_map<uint64_t, uint32_t>::iterator it = m_directionalNbrIndex.find (GetMacKey (macAddr));
+  if (it == m_directionalNbrIndex.end () || it->second != nodeid)
+    {
+      return;
+    }
+  m_directionalNbrIndex.erase (it);
+  // Another neighbor may have the same address
+  for (std::map<uint32_t, Mac48Address>::const_iterator it2 = mDirectionalNbrs.begin (); it2 != mDirectionalNbrs.end (); ++it2)
+    {
+      if (it2->second == macAddr)
+        {
+          IndexDirectionalNeighbor (it2->first, macAddr);
+          break;
+        }
     }
 }
 
+bool
+SimpleWirelessNetDevice::FindDirectionalNeighbor (Mac48Address macAddr, uint32_t &nodeid) const
+{
+  std::unordered_map<uint64_t, uint32_t>::const_iterator it = m_directionalNbrIndex.find (GetMacKey (macAddr));
+  if (it == m_directionalNbrIndex.end ())
+    {
+      return false;
+    }
+  nodeid = it->second;
+  return true;
+}
+
 //********************************************************************
 // Fixed Contention functions
 void SimpleWirelessNetDevice::ClearNbrCount (void)
@@ -604,6 +1307,15 @@ int SimpleWirelessNetDevice::GetNbrCount (void)
   return m_nbrCount;
 }
 
+void SimpleWirelessNetDevice::UpdateNbrCount (void)
+{
+  uint32_t count = m_channel->GetContentionCount (this);
+  if (count)
+    {
+      m_nbrCount = count;
+    }
+}
+
 
 //********************************************************************
 
@@ -621,7 +1333,7 @@ SimpleWirelessNetDevice::TransmitStart (Ptr<Packet> p)
 
   if (m_pcapEnabled)
     {
-      m_promiscSnifferTrace (p);
+      Sniff (p);
     }
 
   // Remove the timestamp tag. calculate queue latency and peg trace
@@ -646,7 +1358,125 @@ SimpleWirelessNetDevice::TransmitStart (Ptr<Packet> p)
   p->RemovePacketTag (destIdTag);
   uint32_t destId = destIdTag.GetDestinationId ();
 
-  Time txTime = m_bps.CalculateBytesTxTime (p->GetSize ());
+  // A slotted aloha frame must fit in a slot
+  if (m_aggregationMaxPackets > 1 && !m_slottedAloha)
+    {
+      p = Aggregate (p, from, to, protocol, destId);
+      m_currentPkt = p;
+    }
+
+  if (m_arq && !to.IsGroup ())
+    {
+      p = ArqAddFrame (p, from, to, protocol, destId);
+      m_currentPkt = p;
+    }
+
+  TransmitToChannel (p, from, to, protocol, destId);
+}
+
+Ptr<Packet>
+SimpleWirelessNetDevice::Aggregate (Ptr<Packet> p, Mac48Address from, Mac48Address to,
+                                    uint16_t protocol, uint32_t destId)
+{
+  NS_LOG_FUNCTION (this << p);
+  SubframeHeader subframeHeader;
+  uint32_t bytes = p->GetSize () + subframeHeader.GetSerializedSize ();
+  Ptr<Packet> frame;
+  uint32_t n = 1;
+  while (n < m_aggregationMaxPackets && !m_queue->IsEmpty ())
+    {
+      Ptr<const Packet> next = m_queue->Peek ();
+      EthernetHeader ethHeader;
+      next->PeekHeader (ethHeader);
+      DestinationIdTag destIdTag;
+      next->PeekPacketTag (destIdTag);
+      uint32_t nextBytes = next->GetSize () - ethHeader.GetSerializedSize () + subframeHeader.GetSerializedSize ();
+      if (ethHeader.GetDestination () != to || ethHeader.GetSource () != from
+          || destIdTag.GetDestinationId () != destId || bytes + nextBytes > m_aggregationMaxBytes)
+        {
+          break;
+        }
+
+      if (!frame)
+        {
+          frame = Create<Packet> ();
+          subframeHeader.SetLength (p->GetSize ());
+          subframeHeader.SetProtocol (protocol);
+          p->AddHeader (subframeHeader);
+          frame->AddAtEnd (p);
+        }
+
+      // Same as TransmitStart for the first packet
+      Ptr<Packet> subframe = m_queue->Dequeue ();
+      if (m_pcapEnabled)
+        {
+          Sniff (subframe);
+        }
+      TimestampTags timeEnqueued;
+      subframe->RemovePacketTag (timeEnqueued);
+      m_QueueLatencyTrace (subframe, Simulator::Now () - timeEnqueued.GetTimestamp ());
+      subframe->RemoveHeader (ethHeader);
+      subframe->RemovePacketTag (destIdTag);
+
+      subframeHeader.SetLength (subframe->GetSize ());
+      subframeHeader.SetProtocol (ethHeader.GetLengthType ());
+      subframe->AddHeader (subframeHeader);
+      frame->AddAtEnd (subframe);
+      bytes += nextBytes;
+      n++;
+    }
+  if (!frame)
+    {
+      return p;
+    }
+  NS_LOG_DEBUG ("Aggregated " << n << " packets, " << bytes << " bytes");
+  AggregateTag aggregateTag;
+  aggregateTag.SetNSubframes (n);
+  frame->AddPacketTag (aggregateTag);
+  return frame;
+}
+
+void
+SimpleWirelessNetDevice::TransmitDescriptor (void)
+{
+  const TxDescriptor &desc = m_txCurrent;
+  NS_LOG_FUNCTION (this << desc.packet);
+
+  // Same as TransmitStart with the fields taken from the descriptor
+  // instead of the packet. A fan-out descriptor is sent to each of its
+  // destinations in turn, with the same packet.
+  NS_ASSERT_MSG (m_txMachineState == READY, "Must be READY to transmit");
+  m_txMachineState = BUSY;
+  m_currentPkt = desc.packet;
+
+  uint32_t destId = desc.destId;
+  if (!desc.destIds.empty ())
+    {
+      NS_ASSERT (m_txCurrentNext < desc.destIds.size ());
+      destId = desc.destIds[m_txCurrentNext];
+    }
+  m_txCurrentNext++;
+
+  if (m_pcapEnabled)
+    {
+      Sniff (desc.packet, desc.to, desc.from, desc.protocol);
+    }
+
+  Time latency = Simulator::Now () - desc.enqueueTime;
+  m_QueueLatencyTrace (desc.packet, latency);
+  NS_LOG_DEBUG (Simulator::Now () << " Getting packet with timestamp: " << desc.enqueueTime);
+
+  // The rate manager tags the frame with its MCS, so it sends a copy: the
+  // packet of the descriptor still belongs to the upper layer
+  Ptr<Packet> packet = m_rateManager ? desc.packet->Copy () : desc.packet;
+  TransmitToChannel (packet, desc.from, desc.to, desc.protocol, destId);
+}
+
+void
+SimpleWirelessNetDevice::TransmitToChannel (Ptr<Packet> p, Mac48Address from, Mac48Address to,
+                                            uint16_t protocol, uint32_t destId)
+{
+  Time txTime = SelectTxRate (p, to).CalculateBytesTxTime (p->GetSize ());
 
   // If we have a non-zero neighbor count then that means we are using contention and
   // the data rate changes. Note that when using contention, we will always have at least
@@ -656,15 +1486,9 @@ SimpleWirelessNetDevice::TransmitStart (Ptr<Packet> p)
   // data rate by # neighbors)
   // If this device is directional then the data rate is rate/2. Thus multiply the tx time by 2.
 
-  // IMPORTANT NOTE: If we are using contention, the first packet we send may not "know"
-  // that there is contention. This is a chicken and egg situation.
-  // The device keeps the neighbor count (which is init'd to 0) but the channel is
-  // the one that has contention. When contention is enabled on the channel, there may not be
-  // any devices to initial with the contention (i.e., set nbr count to 1). The function in the
-  // channel that sets contention enabled also notifies all the devices on the channel but if
-  // there are not devices yet when the function is called then the first packet sent on the
-  // channel by the device is what will cause the device to get init'd for contention. That is
-  // after the device set the txTime so that first packet will be sent at full data rate.
+  // The channel keeps the neighbor count of each device up to date when it uses
+  // contention, so it is read for every packet, including the first one.
+  UpdateNbrCount ();
   if (m_nbrCount)
     {
       if (m_fixedNbrListEnabled)
@@ -678,6 +1502,25 @@ SimpleWirelessNetDevice::TransmitStart (Ptr<Packet> p)
           NS_LOG_DEBUG ("Node " << m_node->GetId () << " txTime was increased to " << txTime << " because we have " << m_nbrCount << " neighbors. packet size is " << p->GetSize ());
         }
     }
+  if (m_dcf)
+    {
+      txTime += m_dcfPhyHeader;
+      // Keep the frame for retransmissions
+      m_dcfFrame.packet = p;
+      m_dcfFrame.from = from;
+      m_dcfFrame.to = to;
+      m_dcfFrame.protocol = protocol;
+      m_dcfFrame.destId = destId;
+      m_dcfTxEnd = Simulator::Now () + txTime;
+      // The frames arriving while this device transmits are lost
+      for (std::size_t i = 0; i < m_dcfRxFrames.size (); ++i)
+        {
+          if (m_dcfRxFrames[i].end > Simulator::Now ())
+            {
+              m_dcfRxFrames[i].collided = true;
+            }
+        }
+    }
   // TO DO: do we need interframe gap??
   //Time txCompleteTime = txTime + m_tInterframeGap;
   Time txCompleteTime = txTime;
@@ -690,6 +1533,23 @@ SimpleWirelessNetDevice::TransmitStart (Ptr<Packet> p)
   m_channel->Send (p, m_txPower, protocol, to, from, this, txTime, destId);
 }
 
+DataRate
+SimpleWirelessNetDevice::SelectTxRate (Ptr<Packet> p, Mac48Address to)
+{
+  if (!m_rateManager)
+    {
+      return m_bps;
+    }
+  // Group frames are not acknowledged, so they go at the most robust rate
+  m_txMcs = to.IsGroup () ? 0 : m_rateManager->SelectMcs (to, p->GetSize ());
+  // A retransmission already has the tag of its last transmission
+  McsTag mcsTag;
+  p->RemovePacketTag (mcsTag);
+  mcsTag.SetMcs (m_txMcs);
+  p->AddPacketTag (mcsTag);
+  return m_rateManager->GetRate (m_txMcs);
+}
+
 void
 SimpleWirelessNetDevice::TransmitComplete (void)
 {
@@ -700,173 +1560,878 @@ SimpleWirelessNetDevice::TransmitComplete (void)
   // is empty, we are done, otherwise we need to start transmitting the
   // next packet.
   NS_ASSERT_MSG (m_txMachineState == BUSY, "Must be BUSY if transmitting");
+  // With DCF the device stays busy until the frame is acknowledged
+  if (m_dcf)
+    {
+      DcfEndOfFrame ();
+      return;
+    }
   m_txMachineState = READY;
 
   NS_ASSERT_MSG(m_currentPkt != nullptr, "SimpleWirelessNetDevice::TransmitComplete(): m_currentPkt zero");
 
   m_currentPkt = nullptr;
 
-  NS_LOG_DEBUG (Simulator::Now () << " Tx complete. Packets in queue: " <<  m_queue->GetNPackets () << " Bytes in queue: " << m_queue->GetNBytes ());
+  // The ACK timeout runs from the end of the frame. The frame may have
+  // been acknowledged already, from an earlier transmission.
+  if (m_arqCurrent)
+    {
+      m_arqCurrent = false;
+      ArqTxState &state = m_arqTx[m_arqCurrentKey];
+      std::map<uint32_t, ArqTxFrame>::iterator it = state.frames.find (m_arqCurrentSeq);
+      if (it != state.frames.end ())
+        {
+          it->second.mcs = m_txMcs;
+          it->second.ackTimeoutEvent = Simulator::Schedule (m_arqAckTimeout, &SimpleWirelessNetDevice::ArqAckTimeout,
+                                                            this, m_arqCurrentKey, m_arqCurrentSeq);
+        }
+    }
 
-  Ptr<Packet> p = m_queue->Dequeue ();
-  if (p == nullptr)
+  // With slotted aloha the next frame waits for the start of a slot
+  if (m_slottedAloha)
     {
-      // No packet was on the queue, so we just exit.
-      return;
+      if (HasFrameToSend ())
+        {
+          RequestSlot ();
+        }
+    }
+  else
+    {
+      TransmitNext ();
     }
 
-  // Got another packet off of the queue, so start the transmit process agin.
-  TransmitStart (p);
+  // Only now may the upper layers hand the device more packets
+  UpdateTxQueueState ();
 }
 
-
-bool
-SimpleWirelessNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+void
+SimpleWirelessNetDevice::TransmitNext (void)
 {
-  NS_LOG_FUNCTION (packet << dest << protocolNumber);
-  Mac48Address to = Mac48Address::ConvertFrom (dest);
-
-  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " sending packet " << packet->GetUid () << "  to " << to );
-
-  // For some reason the Ethernet header is STRIPPED from the packet
-  // by the time we get here so we need to reconstruct it for for two reasons.
-  // If queuing, add ethernet header to the packet in the queue so we can
-  // retrieve the to, from and protocol. Also Ethernet header is
-  // needed so we can apply a pcap filter in priority queues
-  EthernetHeader ethHeader;
-  ethHeader.SetSource (m_address);
-  ethHeader.SetDestination (to);
-  ethHeader.SetLengthType (protocolNumber);
-  packet->AddHeader (ethHeader);
-
-  m_macTxTrace (packet);
+  NS_LOG_FUNCTION_NOARGS ();
 
-  // If directional networking is enabled, then we have to make a copy
-  // of this packet and enqueue it for each destination.
-  if (m_fixedNbrListEnabled)
+  if (m_txDescriptorQueue)
     {
-      std::map<uint32_t, Mac48Address>::iterator  it;
-
-      // Look up the dest address in the eth header of the packet.
-      // This is necessary because in directional networks, the dest
-      // could have been changed by the trace
-      packet->PeekHeader (ethHeader);
-      to = ethHeader.GetDestination ();
-
-      if (to.IsBroadcast ())
+      NS_LOG_DEBUG (Simulator::Now () << " Tx complete. Descriptors in queue: " << m_txRingCount);
+      if (m_txCurrentNext < m_txCurrent.destIds.size ())
         {
-          NS_LOG_INFO ("Address " << to << " is broadcast");
-          // broadcast packet. Enqueue for all of our directional neighbors
-          for ( it = mDirectionalNbrs.begin (); it != mDirectionalNbrs.end (); ++it)
-            {
-              EnqueuePacket (packet->Copy (),m_address,to,protocolNumber,it->first);
-              NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet to directional neighbor to node " << it->first);
-            }
+          // next destination of a fan-out
+          TransmitDescriptor ();
+          return;
         }
-      else
+      m_txCurrent.packet = 0;
+      if (m_txRingCount == 0)
         {
-          NS_LOG_INFO ("Address " << to << " is NOT broadcast");
-          // unicast packet. Find the directional neighbor with matching MAC address. (There might not be one)
-          for ( it = mDirectionalNbrs.begin (); it != mDirectionalNbrs.end (); ++it)
-            {
-              if (it->second == to)
-                {
-                  EnqueuePacket (packet->Copy (),m_address,to,protocolNumber, it->first);
-                  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " found node " << it->first << " with matching Mac Address " << to);
-                  break;
-                }
-            }
+          UpdateTxQueueState ();
+          return;
         }
+      // Swap rather than copy so the destination lists keep their storage
+      std::swap (m_txCurrent, m_txRing[m_txRingHead]);
+      m_txRingHead = (m_txRingHead + 1) % m_txRing.size ();
+      m_txRingCount--;
+      m_txRingBytes -= m_txCurrent.packet->GetSize ();
+      NotifyTxDequeued (0, m_txCurrent.packet->GetSize ());
+      m_txCurrentNext = 0;
+      TransmitDescriptor ();
+      return;
     }
-  else
+
+  NS_LOG_DEBUG (Simulator::Now () << " Tx complete. Packets in queue: " <<  m_queue->GetNPackets () << " Bytes in queue: " << m_queue->GetNBytes ());
+
+  if (m_arq && ArqTransmitNext ())
     {
-      EnqueuePacket (packet,m_address,to,protocolNumber, NO_DIRECTIONAL_NBR);
-      NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet");
+      return;
     }
 
-  return true;
+  Ptr<Packet> p = m_queue->Dequeue ();
+  if (p == nullptr)
+    {
+      // No packet was on the queue, so we just exit. The queue may have
+      // dropped packets at dequeue, which count as sent.
+      UpdateTxQueueState ();
+      return;
+    }
 
+  // Got another packet off of the queue, so start the transmit process agin.
+  TransmitStart (p);
 }
 
-
 bool
-SimpleWirelessNetDevice::SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber)
+SimpleWirelessNetDevice::HasFrameToSend (void) const
 {
-  NS_LOG_FUNCTION (packet << dest << protocolNumber);
-  Mac48Address to = Mac48Address::ConvertFrom (dest);
-  Mac48Address from = Mac48Address::ConvertFrom (source);
-
-  // For some reason the Ethernet header is STRIPPED from the packet
-  // by the time we get here so we need to reconstruct it for for two reasons.
-  // If queuing, add ethernet header to the packet in the queue so we can
-  // retrieve the to, from and protocol. Also Ethernet header is
-  // needed so we can apply a pcap filter in priority queues
-  EthernetHeader ethHeader;
-  ethHeader.SetSource (from);
-  ethHeader.SetDestination (to);
-  ethHeader.SetLengthType (protocolNumber);
-  packet->AddHeader (ethHeader);
-
-  m_macTxTrace (packet);
-
+  if (m_txDescriptorQueue)
+    {
+      return m_txCurrentNext < m_txCurrent.destIds.size () || m_txRingCount > 0;
+    }
+  return m_queue && !m_queue->IsEmpty ();
+}
 
-  // If directional networking is enabled, then we have to make a copy
-  // of this packet and enqueue it for each destination.
-  if (m_fixedNbrListEnabled)
+void
+SimpleWirelessNetDevice::RequestSlot (void)
+{
+  if (!m_slotRequested)
     {
-      std::map<uint32_t, Mac48Address>::iterator  it;
+      m_slotRequested = true;
+      m_channel->RequestSlot (this);
+    }
+}
 
-      // Look up the dest address in the eth header of the packet.
-      // This is necessary because in directional networks, the dest
-      // could have been changed by the trace
-      packet->PeekHeader (ethHeader);
-      to = ethHeader.GetDestination ();
+void
+SimpleWirelessNetDevice::HandleStartOfFrame (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_slotRequested = false;
+  // A busy device asks again when its transmission completes
+  if (m_txMachineState == READY)
+    {
+      TransmitNext ();
+    }
+}
 
-      if (to.IsBroadcast ())
+void
+SimpleWirelessNetDevice::NotifyMediumBusy (Ptr<SimpleWirelessNetDevice> sender, uint64_t uid, Time propDelay,
+                                           Time duration, Mac48Address to)
+{
+  NS_LOG_FUNCTION (this << sender << uid << propDelay << duration << to);
+  if (!m_dcf)
+    {
+      return;
+    }
+  Time now = Simulator::Now ();
+  Time start = now + propDelay;
+  Time end = start + duration;
+
+  // A frame that overlaps another one at this device, or this device's
+  // own transmission, is lost. Frames that ended without being delivered
+  // (dropped by the channel error model) are forgotten.
+  DcfRxFrame frame;
+  frame.uid = uid;
+  frame.end = end;
+  frame.sender = sender;
+  frame.collided = (start < m_dcfTxEnd);
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < m_dcfRxFrames.size (); ++i)
+    {
+      if (m_dcfRxFrames[i].end < now)
         {
-          NS_LOG_INFO ("Address " << to << " is broadcast");
-          // broadcast packet. Enqueue for all of our directional neighbors
-          for ( it = mDirectionalNbrs.begin (); it != mDirectionalNbrs.end (); ++it)
-            {
-              // Note that we do not alter the to (mac address) here but instead specify
-              // the node id as the destination. This gets carried with the packet
-              // as a destination tag and passed to the channel. At the channel it still
-              // appears as a broadcast packet but the channel only uses the dest id so it
-              // will know how to handle it from the perspective of directional networking.
-              EnqueuePacket (packet->Copy (),from,to,protocolNumber,it->first);
-              NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet to directional neighbor to node " << it->first);
-            }
+          continue;
         }
-      else
+      if (m_dcfRxFrames[i].end > start)
         {
-          NS_LOG_INFO ("Address " << to << " is NOT broadcast");
-          // unicast packet. Find the directional neighbor with matching MAC address. (There might not be one)
-          for ( it = mDirectionalNbrs.begin (); it != mDirectionalNbrs.end (); ++it)
-            {
-              if (it->second == to)
-                {
-                  EnqueuePacket (packet->Copy (),from,to,protocolNumber, it->first);
-                  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " found node " << it->first << " with matching Mac Address " << to);
-                  break;
-                }
-            }
+          m_dcfRxFrames[i].collided = true;
+          frame.collided = true;
         }
+      m_dcfRxFrames[n++] = m_dcfRxFrames[i];
     }
-  else
+  m_dcfRxFrames.resize (n);
+  m_dcfRxFrames.push_back (frame);
+
+  // The duration of a unicast frame covers its ACK (NAV). After a
+  // collision this gives the same wait as EIFS.
+  Time busyEnd = end;
+  if (!to.IsGroup ())
     {
-      EnqueuePacket (packet,from,to,protocolNumber, NO_DIRECTIONAL_NBR);
-      NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet");
+      busyEnd += m_dcfSifs + m_dcfAckDuration;
     }
 
-  return true;
-
+  if (m_dcfAccessEvent.IsRunning () && start >= m_dcfAccessTime)
+    {
+      // This device starts sending before it can sense the frame
+      m_dcfBusyUntil = Max (m_dcfBusyUntil, busyEnd);
+      return;
+    }
+  DcfConsumeBackoff (start);
+  m_dcfBusyUntil = Max (m_dcfBusyUntil, busyEnd);
+  if (m_dcfAccessEvent.IsRunning ())
+    {
+      m_dcfAccessEvent.Cancel ();
+      DcfScheduleAccess ();
+    }
+}
+
+void
+SimpleWirelessNetDevice::NotifyAck (double snrDb)
+{
+  NS_LOG_FUNCTION (this << snrDb);
+  if (m_dcfAckTimeoutEvent.IsRunning ())
+    {
+      m_dcfAckTimeoutEvent.Cancel ();
+      if (m_rateManager)
+        {
+          m_rateManager->NotifyRxSnr (m_dcfFrame.to, snrDb);
+        }
+      DcfTxDone (true);
+    }
+}
+
+void
+SimpleWirelessNetDevice::DcfRequestAccess (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_txMachineState != READY || m_dcfAccessEvent.IsRunning ())
+    {
+      return;
+    }
+  if (!m_dcfRetry)
+    {
+      if (!HasFrameToSend ())
+        {
+          return;
+        }
+      m_dcfHolTime = Simulator::Now ();
+    }
+  DcfScheduleAccess ();
+}
+
+void
+SimpleWirelessNetDevice::DcfScheduleAccess (void)
+{
+  Time now = Simulator::Now ();
+  Time access = m_dcfBusyUntil + m_dcfDifs + m_dcfSlot * m_dcfBackoff;
+  if (access < now)
+    {
+      // The backoff ran out while the medium was idle
+      access = now;
+    }
+  NS_LOG_DEBUG ("Access in " << access - now << " with " << m_dcfBackoff << " backoff slots, CW " << m_dcfCw);
+  m_dcfAccessTime = access;
+  m_dcfAccessEvent = Simulator::Schedule (access - now, &SimpleWirelessNetDevice::DcfAccess, this);
+}
+
+void
+SimpleWirelessNetDevice::DcfConsumeBackoff (Time until)
+{
+  // Only whole idle slots count
+  Time idleStart = m_dcfBusyUntil + m_dcfDifs;
+  if (until > idleStart)
+    {
+      int64_t slots = (until - idleStart).GetTimeStep () / m_dcfSlot.GetTimeStep ();
+      m_dcfBackoff -= static_cast<uint32_t> (std::min<int64_t> (slots, m_dcfBackoff));
+    }
+}
+
+void
+SimpleWirelessNetDevice::DcfAccess (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_dcfBackoff = 0;
+  if (m_dcfRetry)
+    {
+      NS_LOG_DEBUG ("Retransmission " << m_dcfRetries << " of packet " << m_dcfFrame.packet->GetUid ());
+      m_txMachineState = BUSY;
+      m_currentPkt = m_dcfFrame.packet;
+      TransmitToChannel (m_dcfFrame.packet, m_dcfFrame.from, m_dcfFrame.to, m_dcfFrame.protocol, m_dcfFrame.destId);
+      return;
+    }
+  TransmitNext ();
+}
+
+void
+SimpleWirelessNetDevice::DcfEndOfFrame (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_dcfFrame.to.IsGroup ())
+    {
+      // Not acknowledged
+      DcfTxDone (true);
+      return;
+    }
+  // The ACK comes SIFS + DcfAckDuration after the end of the frame (see
+  // DcfReceive); the slot leaves room for frames that arrive later
+  m_dcfAckTimeoutEvent = Simulator::Schedule (m_dcfSifs + m_dcfAckDuration + m_dcfSlot,
+                                              &SimpleWirelessNetDevice::DcfAckTimeout, this);
+}
+
+void
+SimpleWirelessNetDevice::DcfAckTimeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  DcfTxDone (false);
+}
+
+void
+SimpleWirelessNetDevice::DcfTxDone (bool success)
+{
+  NS_LOG_FUNCTION (this << success);
+
+  // The medium is idle for this device once the ACK is over, whether or
+  // not it came, like for the other devices
+  Time idle = m_dcfTxEnd;
+  if (!m_dcfFrame.to.IsGroup ())
+    {
+      idle += m_dcfSifs + m_dcfAckDuration;
+    }
+  m_dcfBusyUntil = Max (m_dcfBusyUntil, idle);
+
+  if (m_rateManager && !m_dcfFrame.to.IsGroup ())
+    {
+      m_rateManager->NotifyTxResult (m_dcfFrame.to, m_txMcs, success);
+    }
+  if (success)
+    {
+      m_dcfAccessDelayTrace (m_dcfFrame.packet, Simulator::Now () - m_dcfHolTime);
+      m_dcfRetry = false;
+    }
+  else if (m_dcfRetries >= m_dcfRetryLimit)
+    {
+      NS_LOG_DEBUG ("Retry limit reached. Dropping packet " << m_dcfFrame.packet->GetUid ());
+      m_macTxDropTrace (m_dcfFrame.packet);
+      m_dcfRetry = false;
+    }
+  else
+    {
+      m_dcfRetries++;
+      m_dcfRetry = true;
+      m_dcfCw = std::min (2 * m_dcfCw + 1, m_dcfCwMax);
+    }
+  if (!m_dcfRetry)
+    {
+      m_dcfRetries = 0;
+      m_dcfCw = m_dcfCwMin;
+      m_dcfFrame.packet = 0;
+    }
+  // Backoff after every exchange, even if there is nothing left to send
+  m_dcfBackoff = m_uniformRv->GetInteger (0, m_dcfCw);
+
+  m_txMachineState = READY;
+  m_currentPkt = nullptr;
+  DcfRequestAccess ();
+  UpdateTxQueueState ();
+}
+
+void
+SimpleWirelessNetDevice::DcfReceive (Ptr<Packet> packet, double rxPower, uint16_t protocol,
+                                     Mac48Address to, Mac48Address from)
+{
+  NS_LOG_FUNCTION (this << packet << rxPower << protocol << to << from);
+  Time now = Simulator::Now ();
+  Ptr<SimpleWirelessNetDevice> sender;
+  bool collided = false;
+  for (std::size_t i = 0; i < m_dcfRxFrames.size (); ++i)
+    {
+      if (m_dcfRxFrames[i].uid == packet->GetUid () && m_dcfRxFrames[i].end == now)
+        {
+          sender = m_dcfRxFrames[i].sender;
+          collided = m_dcfRxFrames[i].collided;
+          m_dcfRxFrames[i] = m_dcfRxFrames.back ();
+          m_dcfRxFrames.pop_back ();
+          break;
+        }
+    }
+  if (collided)
+    {
+      NS_LOG_DEBUG ("DCF collision. Dropping packet " << packet->GetUid () << " from " << from);
+      m_pktRcvTotal++;
+      m_pktRcvDrop++;
+      m_phyRxDropTrace (packet, rxPower, from);
+      return;
+    }
+  double sinr = rxPower - m_noisePower;
+  if (ReceiveFrame (packet, rxPower, protocol, to, from, sinr, false) && sender && to == m_address)
+    {
+      // The sender gets the ACK SIFS + DcfAckDuration after the end of its
+      // frame, whatever the propagation delay (or its rounding by
+      // BatchDeliveryResolution). A frame that arrives after the ACK
+      // timeout of its sender, which may be sending another frame by then,
+      // is not acknowledged.
+      Time sinceEnd = now - sender->m_dcfTxEnd;
+      if (!sinceEnd.IsNegative () && sinceEnd < m_dcfSifs + m_dcfAckDuration + m_dcfSlot)
+        {
+          Simulator::ScheduleWithContext (sender->GetNode ()->GetId (), Max (m_dcfSifs + m_dcfAckDuration - sinceEnd, Seconds (0)),
+                                          &SimpleWirelessNetDevice::NotifyAck, sender, sinr);
+        }
+    }
+}
+
+bool
+SimpleWirelessNetDevice::ArqTransmitNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  // Retransmissions go first. A frame acknowledged after its ACK timeout
+  // is no longer kept and is skipped.
+  while (!m_arqRetxQueue.empty ())
+    {
+      uint64_t key = m_arqRetxQueue.front ().first;
+      uint32_t seq = m_arqRetxQueue.front ().second;
+      m_arqRetxQueue.pop_front ();
+      ArqTxState &state = m_arqTx[key];
+      std::map<uint32_t, ArqTxFrame>::iterator it = state.frames.find (seq);
+      if (it == state.frames.end ())
+        {
+          continue;
+        }
+      const ArqTxFrame &frame = it->second;
+      NS_LOG_DEBUG ("Retransmission " << frame.retries << " of frame " << seq << " to " << frame.to);
+      NS_ASSERT_MSG (m_txMachineState == READY, "Must be READY to transmit");
+      m_txMachineState = BUSY;
+      m_currentPkt = ArqBuildFrame (frame.packet, seq);
+      m_arqCurrent = true;
+      m_arqCurrentKey = key;
+      m_arqCurrentSeq = seq;
+      TransmitToChannel (m_currentPkt, frame.from, frame.to, frame.protocol, frame.destId);
+      return true;
+    }
+
+  // The queue is served in order, so a full window holds back the frames
+  // to the other destinations too
+  Ptr<const Packet> next = m_queue->Peek ();
+  if (next == nullptr)
+    {
+      return false;
+    }
+  EthernetHeader ethHeader;
+  next->PeekHeader (ethHeader);
+  if (!ethHeader.GetDestination ().IsGroup () && !ArqWindowOpen (ethHeader.GetDestination ()))
+    {
+      NS_LOG_DEBUG ("ARQ window to " << ethHeader.GetDestination () << " is full");
+      return true;
+    }
+  return false;
+}
+
+bool
+SimpleWirelessNetDevice::ArqWindowOpen (Mac48Address to) const
+{
+  std::unordered_map<uint64_t, ArqTxState>::const_iterator it = m_arqTx.find (GetMacKey (to));
+  if (it == m_arqTx.end () || it->second.frames.empty ())
+    {
+      return true;
+    }
+  return it->second.nextSeq - it->second.frames.begin ()->first < m_arqWindowSize;
+}
+
+Ptr<Packet>
+SimpleWirelessNetDevice::ArqAddFrame (Ptr<Packet> p, Mac48Address from, Mac48Address to,
+                                      uint16_t protocol, uint32_t destId)
+{
+  NS_LOG_FUNCTION (this << p << to);
+  uint64_t key = GetMacKey (to);
+  ArqTxState &state = m_arqTx[key];
+  uint32_t seq = state.nextSeq++;
+  ArqTxFrame &frame = state.frames[seq];
+  frame.packet = p;
+  frame.from = from;
+  frame.to = to;
+  frame.protocol = protocol;
+  frame.destId = destId;
+  frame.firstTxTime = Simulator::Now ();
+  m_arqCurrent = true;
+  m_arqCurrentKey = key;
+  m_arqCurrentSeq = seq;
+  NS_LOG_DEBUG ("Frame " << seq << " to " << to << ", " << state.frames.size () << " unacknowledged");
+  return ArqBuildFrame (p, seq);
+}
+
+Ptr<Packet>
+SimpleWirelessNetDevice::ArqBuildFrame (Ptr<const Packet> p, uint32_t seq) const
+{
+  Ptr<Packet> frame = p->Copy ();
+  ArqHeader arqHeader;
+  arqHeader.SetType (ArqHeader::DATA);
+  arqHeader.SetSequence (static_cast<uint16_t> (seq));
+  frame->AddHeader (arqHeader);
+  ArqTag arqTag;
+  frame->AddPacketTag (arqTag);
+  return frame;
+}
+
+void
+SimpleWirelessNetDevice::ArqAckTimeout (uint64_t key, uint32_t seq)
+{
+  NS_LOG_FUNCTION (this << key << seq);
+  ArqTxState &state = m_arqTx[key];
+  std::map<uint32_t, ArqTxFrame>::iterator it = state.frames.find (seq);
+  NS_ASSERT (it != state.frames.end ());
+  ArqTxFrame &frame = it->second;
+  if (m_rateManager)
+    {
+      m_rateManager->NotifyTxResult (frame.to, frame.mcs, false);
+    }
+  if (frame.retries >= m_arqRetryLimit)
+    {
+      NS_LOG_DEBUG ("Retry limit reached. Dropping frame " << seq << " to " << frame.to);
+      m_macTxDropTrace (frame.packet);
+      m_arqRetriesTrace (frame.packet, frame.retries);
+      state.frames.erase (it);
+    }
+  else
+    {
+      frame.retries++;
+      m_arqRetxQueue.push_back (std::make_pair (key, seq));
+    }
+  if (m_txMachineState == READY)
+    {
+      TransmitNext ();
+    }
+}
+
+bool
+SimpleWirelessNetDevice::ArqReceive (Ptr<Packet> packet, double rxPower, uint16_t protocol,
+                                     Mac48Address to, Mac48Address from, double sinr)
+{
+  NS_LOG_FUNCTION (this << packet << rxPower << protocol << to << from << sinr);
+  Ptr<Packet> frame = packet->Copy ();
+  ArqTag arqTag;
+  frame->RemovePacketTag (arqTag);
+  ArqHeader arqHeader;
+  frame->RemoveHeader (arqHeader);
+  uint16_t seq = arqHeader.GetSequence ();
+
+  if (arqHeader.GetType () == ArqHeader::ACK)
+    {
+      if (to != m_address)
+        {
+          return false;
+        }
+      // An ACK is lost like any other frame, but is not passed up
+      Ptr<SnrPerErrorModel> perModel = GetRxPerModel (packet);
+      if ((m_receiveErrorModel && m_receiveErrorModel->IsCorrupt (packet))
+          || (perModel && perModel->Receive (sinr, packet->GetSize ()) > m_uniformRv->GetValue ()))
+        {
+          NS_LOG_DEBUG ("Lost ACK " << seq << " from " << from);
+          return false;
+        }
+      std::unordered_map<uint64_t, ArqTxState>::iterator state = m_arqTx.find (GetMacKey (from));
+      if (state == m_arqTx.end () || state->second.frames.empty ())
+        {
+          return true;
+        }
+      // The frames kept span less than 2^16 sequence numbers, so the 16
+      // bits sent are enough to find the frame
+      uint32_t base = state->second.frames.begin ()->first;
+      uint32_t acked = base + static_cast<uint16_t> (seq - static_cast<uint16_t> (base));
+      std::map<uint32_t, ArqTxFrame>::iterator it = state->second.frames.find (acked);
+      if (it == state->second.frames.end ())
+        {
+          NS_LOG_DEBUG ("ACK " << seq << " from " << from << " for a frame no longer kept");
+          return true;
+        }
+      NS_LOG_DEBUG ("ACK " << seq << " from " << from << " after " << it->second.retries << " retransmissions");
+      it->second.ackTimeoutEvent.Cancel ();
+      if (m_rateManager)
+        {
+          m_rateManager->NotifyTxResult (from, it->second.mcs, true);
+        }
+      m_arqRetriesTrace (it->second.packet, it->second.retries);
+      m_arqAccessDelayTrace (it->second.packet, Simulator::Now () - it->second.firstTxTime);
+      state->second.frames.erase (it);
+      // The window may have opened
+      if (m_txMachineState == READY)
+        {
+          TransmitNext ();
+        }
+      return true;
+    }
+
+  if (to != m_address)
+    {
+      return ReceiveFrame (frame, rxPower, protocol, to, from, sinr, false);
+    }
+  std::deque<uint16_t> &received = m_arqRx[GetMacKey (from)];
+  bool duplicate = std::find (received.begin (), received.end (), seq) != received.end ();
+  if (!ReceiveFrame (frame, rxPower, protocol, to, from, sinr, duplicate))
+    {
+      return false;
+    }
+  if (!duplicate)
+    {
+      received.push_back (seq);
+      if (received.size () > 2 * m_arqWindowSize)
+        {
+          received.pop_front ();
+        }
+    }
+  ArqSendAck (from, seq);
+  return true;
+}
+
+void
+SimpleWirelessNetDevice::ArqSendAck (Mac48Address to, uint16_t seq)
+{
+  NS_LOG_FUNCTION (this << to << seq);
+  uint32_t destId = NO_DIRECTIONAL_NBR;
+  if (m_fixedNbrListEnabled && !FindDirectionalNeighbor (to, destId))
+    {
+      NS_LOG_DEBUG ("No directional neighbor to acknowledge " << to);
+      return;
+    }
+  ArqHeader arqHeader;
+  arqHeader.SetType (ArqHeader::ACK);
+  arqHeader.SetSequence (seq);
+  Ptr<Packet> ack = Create<Packet> (m_arqAckSize - arqHeader.GetSerializedSize ());
+  ack->AddHeader (arqHeader);
+  ArqTag arqTag;
+  ack->AddPacketTag (arqTag);
+  // The ACK is sent as soon as the frame is received, whatever the device
+  // is doing, and is not queued. With a rate manager it goes at the lowest
+  // rate, like a group frame.
+  DataRate rate = m_bps;
+  if (m_rateManager)
+    {
+      McsTag mcsTag;
+      ack->AddPacketTag (mcsTag);
+      rate = m_rateManager->GetRate (0);
+    }
+  Time txTime = rate.CalculateBytesTxTime (ack->GetSize ());
+  m_channel->Send (ack, m_txPower, 0, to, m_address, this, txTime, destId);
+}
+
+
+bool
+SimpleWirelessNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << dest << protocolNumber);
+  Mac48Address to = Mac48Address::ConvertFrom (dest);
+
+  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " sending packet " << packet->GetUid () << "  to " << to );
+
+  // For some reason the Ethernet header is STRIPPED from the packet
+  // by the time we get here so we need to reconstruct it for for two reasons.
+  // If queuing, add ethernet header to the packet in the queue so we can
+  // retrieve the to, from and protocol. Also Ethernet header is
+  // needed so we can apply a pcap filter in priority queues.
+  // The descriptor queue keeps these fields next to the packet instead.
+  EthernetHeader ethHeader;
+  if (!m_txDescriptorQueue)
+    {
+      ethHeader.SetSource (m_address);
+      ethHeader.SetDestination (to);
+      ethHeader.SetLengthType (protocolNumber);
+      packet->AddHeader (ethHeader);
+    }
+
+  m_macTxTrace (packet);
+
+  // false if the packet, or a copy of it, was dropped by a full queue
+  bool queued = true;
+
+  // If directional networking is enabled, then we have to make a copy
+  // of this packet and enqueue it for each destination.
+  if (m_fixedNbrListEnabled)
+    {
+      std::map<uint32_t, Mac48Address>::iterator  it;
+
+      // Look up the dest address in the eth header of the packet.
+      // This is necessary because in directional networks, the dest
+      // could have been changed by the trace
+      if (!m_txDescriptorQueue)
+        {
+          packet->PeekHeader (ethHeader);
+          to = ethHeader.GetDestination ();
+        }
+
+      if (to.IsBroadcast ())
+        {
+          NS_LOG_INFO ("Address " << to << " is broadcast");
+          // broadcast packet. Enqueue for all of our directional neighbors.
+          // The descriptor queue sends the one packet to each of them.
+          if (m_txDescriptorQueue)
+            {
+              if (!mDirectionalNbrs.empty ())
+                {
+                  queued = EnqueueDescriptor (packet,m_address,to,protocolNumber,NO_DIRECTIONAL_NBR,true) && queued;
+                  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet to " << mDirectionalNbrs.size () << " directional neighbors");
+                }
+            }
+          else
+            {
+              for ( it = mDirectionalNbrs.begin (); it != mDirectionalNbrs.end (); ++it)
+                {
+                  queued = EnqueuePacket (packet->Copy (),m_address,to,protocolNumber,it->first) && queued;
+                  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet to directional neighbor to node " << it->first);
+                }
+            }
+        }
+      else
+        {
+          NS_LOG_INFO ("Address " << to << " is NOT broadcast");
+          // unicast packet. Find the directional neighbor with matching MAC address. (There might not be one)
+          uint32_t nodeid;
+          if (FindDirectionalNeighbor (to, nodeid))
+            {
+              queued = EnqueuePacket (packet->Copy (),m_address,to,protocolNumber, nodeid) && queued;
+              NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " found node " << nodeid << " with matching Mac Address " << to);
+            }
+        }
+    }
+  else
+    {
+      queued = EnqueuePacket (packet,m_address,to,protocolNumber, NO_DIRECTIONAL_NBR) && queued;
+      NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet");
+    }
+
+  return queued;
+
+}
+
+
+bool
+SimpleWirelessNetDevice::SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (packet << dest << protocolNumber);
+  Mac48Address to = Mac48Address::ConvertFrom (dest);
+  Mac48Address from = Mac48Address::ConvertFrom (source);
+
+  // For some reason the Ethernet header is STRIPPED from the packet
+  // by the time we get here so we need to reconstruct it for for two reasons.
+  // If queuing, add ethernet header to the packet in the queue so we can
+  // retrieve the to, from and protocol. Also Ethernet header is
+  // needed so we can apply a pcap filter in priority queues.
+  // The descriptor queue keeps these fields next to the packet instead.
+  EthernetHeader ethHeader;
+  if (!m_txDescriptorQueue)
+    {
+      ethHeader.SetSource (from);
+      ethHeader.SetDestination (to);
+      ethHeader.SetLengthType (protocolNumber);
+      packet->AddHeader (ethHeader);
+    }
+
+  m_macTxTrace (packet);
+
+  // false if the packet, or a copy of it, was dropped by a full queue
+  bool queued = true;
+
+
+  // If directional networking is enabled, then we have to make a copy
+  // of this packet and enqueue it for each destination.
+  if (m_fixedNbrListEnabled)
+    {
+      std::map<uint32_t, Mac48Address>::iterator  it;
+
+      // Look up the dest address in the eth header of the packet.
+      // This is necessary because in directional networks, the dest
+      // could have been changed by the trace
+      if (!m_txDescriptorQueue)
+        {
+          packet->PeekHeader (ethHeader);
+          to = ethHeader.GetDestination ();
+        }
+
+      if (to.IsBroadcast ())
+        {
+          NS_LOG_INFO ("Address " << to << " is broadcast");
+          // broadcast packet. Enqueue for all of our directional neighbors.
+          // The descriptor queue sends the one packet to each of them.
+          if (m_txDescriptorQueue)
+            {
+              if (!mDirectionalNbrs.empty ())
+                {
+                  queued = EnqueueDescriptor (packet,from,to,protocolNumber,NO_DIRECTIONAL_NBR,true) && queued;
+                  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet to " << mDirectionalNbrs.size () << " directional neighbors");
+                }
+            }
+          else
+            {
+              for ( it = mDirectionalNbrs.begin (); it != mDirectionalNbrs.end (); ++it)
+                {
+                  // Note that we do not alter the to (mac address) here but instead specify
+                  // the node id as the destination. This gets carried with the packet
+                  // as a destination tag and passed to the channel. At the channel it still
+                  // appears as a broadcast packet but the channel only uses the dest id so it
+                  // will know how to handle it from the perspective of directional networking.
+                  queued = EnqueuePacket (packet->Copy (),from,to,protocolNumber,it->first) && queued;
+                  NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet to directional neighbor to node " << it->first);
+                }
+            }
+        }
+      else
+        {
+          NS_LOG_INFO ("Address " << to << " is NOT broadcast");
+          // unicast packet. Find the directional neighbor with matching MAC address. (There might not be one)
+          uint32_t nodeid;
+          if (FindDirectionalNeighbor (to, nodeid))
+            {
+              queued = EnqueuePacket (packet->Copy (),from,to,protocolNumber, nodeid) && queued;
+              NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " found node " << nodeid << " with matching Mac Address " << to);
+            }
+        }
+    }
+  else
+    {
+      queued = EnqueuePacket (packet,from,to,protocolNumber, NO_DIRECTIONAL_NBR) && queued;
+      NS_LOG_INFO ("Node " << this->GetNode ()->GetId () << " queueing packet");
+    }
+
+  return queued;
+
+}
+
+bool
+SimpleWirelessNetDevice::EnqueueDescriptor (Ptr<Packet> packet, Mac48Address from, Mac48Address to,
+                                            uint16_t protocolNumber, uint32_t destId, bool fanOut)
+{
+  NS_LOG_FUNCTION (this << packet << from << to << protocolNumber << destId << fanOut);
+
+  // The addresses, protocol, destination ids and enqueue time are kept
+  // in a descriptor next to the packet, so the packet is not modified
+  bool sendNow = (m_txMachineState == READY && m_txRingCount == 0 && !m_slottedAloha && !m_dcf);
+  TxDescriptor *desc;
+  if (sendNow)
+    {
+      desc = &m_txCurrent;
+    }
+  else
+    {
+      if (m_txRing.empty ())
+        {
+          m_txRing.resize (m_txRingSize);
+        }
+      if (m_txRingCount == m_txRing.size ())
+        {
+          NS_LOG_DEBUG ("Descriptor queue full. Dropping packet for destination " << destId);
+          m_macTxDropTrace (packet);
+          return false;
+        }
+      desc = &m_txRing[(m_txRingHead + m_txRingCount) % m_txRing.size ()];
+    }
+
+  desc->packet = packet;
+  desc->from = from;
+  desc->to = to;
+  desc->protocol = protocolNumber;
+  desc->destId = destId;
+  desc->destIds.clear ();
+  if (fanOut)
+    {
+      for (std::map<uint32_t, Mac48Address>::const_iterator it = mDirectionalNbrs.begin (); it != mDirectionalNbrs.end (); ++it)
+        {
+          desc->destIds.push_back (it->first);
+        }
+    }
+  desc->enqueueTime = Simulator::Now ();
+
+  if (sendNow)
+    {
+      m_txCurrentNext = 0;
+      TransmitDescriptor ();
+    }
+  else
+    {
+      m_txRingCount++;
+      m_txRingBytes += packet->GetSize ();
+      NotifyTxQueued (0, packet->GetSize ());
+      NS_LOG_DEBUG ("Queueing packet for destination " << destId << ". Protocol " <<  protocolNumber << " Descriptors in queue: " << m_txRingCount);
+      if (m_slottedAloha && m_txMachineState == READY)
+        {
+          RequestSlot ();
+        }
+      else if (m_dcf)
+        {
+          DcfRequestAccess ();
+        }
+    }
+  return true;
 }
 
 bool
 SimpleWirelessNetDevice::EnqueuePacket (Ptr<Packet> packet, Mac48Address from, Mac48Address to, uint16_t protocolNumber, uint32_t destId)
 {
   NS_LOG_FUNCTION (this << packet << from << to << protocolNumber << destId);
-  if (m_queue)
+  if (m_txDescriptorQueue)
+    {
+      return EnqueueDescriptor (packet, from, to, protocolNumber, destId, false);
+    }
+  else if (m_queue)
     {
       // We are using queueing.
 
@@ -884,32 +2449,47 @@ SimpleWirelessNetDevice::EnqueuePacket (Ptr<Packet> packet, Mac48Address from, M
       // We should enqueue and dequeue the packet to hit the tracing hooks.
       if (m_queue->Enqueue (packet))
         {
-          // If the channel is ready for transition we send the packet right now
+          // If the channel is ready for transition we send the packet right now,
+          // or at the start of the next slot with slotted aloha, unless the ARQ
+          // window of its destination is full
           if (m_txMachineState == READY)
             {
-              packet = m_queue->Dequeue ();
-              TransmitStart (packet);
+              if (m_slottedAloha)
+                {
+                  RequestSlot ();
+                }
+              else if (m_dcf)
+                {
+                  DcfRequestAccess ();
+                }
+              else if (!m_arq || !ArqTransmitNext ())
+                {
+                  packet = m_queue->Dequeue ();
+                  TransmitStart (packet);
+                }
             }
           return true;
         }
 
-      // TO DO: do we return true or false here??
-      return true;
+      NS_LOG_DEBUG ("Transmit queue full. Dropping packet for destination " << destId);
+      m_macTxDropTrace (packet);
+      return false;
     }
   else
     {
       // No queuing is being used. Just send the packet.
       if (m_pcapEnabled)
         {
-          m_promiscSnifferTrace (packet);
+          Sniff (packet);
         }
       EthernetHeader ethHeader;
       packet->RemoveHeader (ethHeader);
 
+      Time txTime = SelectTxRate (packet, to).CalculateBytesTxTime (packet->GetSize ());
       m_TxBeginTrace (packet, m_address, to, protocolNumber);
-      Time txTime = m_bps.CalculateBytesTxTime (packet->GetSize ());
       // If we have a non-zero neighbor count then that means we are using contention and
       // the data rate changes.
+      UpdateNbrCount ();
       if (m_nbrCount)
         {
           if (m_fixedNbrListEnabled)
@@ -959,7 +2539,30 @@ SimpleWirelessNetDevice::DoDispose (void)
   m_channel = 0;
   m_node = 0;
   m_receiveErrorModel = 0;
+  m_rateManager = 0;
+  m_pcapFile = 0;
+  m_txRing.clear ();
+  m_txRingCount = 0;
+  m_txRingBytes = 0;
+  m_txCurrent.packet = 0;
+  m_queueInterface = 0;
+  m_multiQueue = 0;
   m_receiveEvent.Cancel ();
+  m_slotCandidate = ReceivedPacket ();
+  m_dcfAccessEvent.Cancel ();
+  m_dcfAckTimeoutEvent.Cancel ();
+  m_dcfFrame.packet = 0;
+  m_dcfRxFrames.clear ();
+  for (std::unordered_map<uint64_t, ArqTxState>::iterator it = m_arqTx.begin (); it != m_arqTx.end (); ++it)
+    {
+      for (std::map<uint32_t, ArqTxFrame>::iterator f = it->second.frames.begin (); f != it->second.frames.end (); ++f)
+        {
+          f->second.ackTimeoutEvent.Cancel ();
+        }
+    }
+  m_arqTx.clear ();
+  m_arqRetxQueue.clear ();
+  m_arqRx.clear ();
   NetDevice::DoDispose ();
 }
 
@@ -983,6 +2586,36 @@ SimpleWirelessNetDevice::SetDataRate (DataRate bps)
   m_bps = bps;
 }
 
+DataRate
+SimpleWirelessNetDevice::GetDataRate (void) const
+{
+  return m_bps;
+}
+
+uint32_t
+SimpleWirelessNetDevice::GetTxBacklog (void) const
+{
+  uint32_t bytes = 0;
+  if (m_currentPkt)
+    {
+      bytes = m_currentPkt->GetSize ();
+    }
+  else if (m_dcfRetry)
+    {
+      // between two attempts
+      bytes = m_dcfFrame.packet->GetSize ();
+    }
+  if (m_txDescriptorQueue)
+    {
+      return bytes + m_txRingBytes;
+    }
+  if (m_queue)
+    {
+      bytes += m_queue->GetNBytes ();
+    }
+  return bytes;
+}
+
 void
 SimpleWirelessNetDevice::SetNoisePower (double noisePower)
 {
@@ -994,7 +2627,31 @@ void
 SimpleWirelessNetDevice::SetQueue (Ptr<Queue<Packet> > q)
 {
   NS_LOG_FUNCTION (this << q);
+  if (m_queue)
+    {
+      m_queue->TraceDisconnectWithoutContext ("Enqueue", MakeCallback (&SimpleWirelessNetDevice::QueueEnqueued, this));
+      m_queue->TraceDisconnectWithoutContext ("Dequeue", MakeCallback (&SimpleWirelessNetDevice::QueueDequeued, this));
+    }
   m_queue = q;
+  m_multiQueue = DynamicCast<SimpleWirelessMultiQueue> (q);
+  // The queue traces cover the packets the queue drops at dequeue, as an
+  // AQM does, as well as those the device takes out
+  if (m_queue)
+    {
+      m_queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&SimpleWirelessNetDevice::QueueEnqueued, this));
+      m_queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&SimpleWirelessNetDevice::QueueDequeued, this));
+
+      // Each sub-queue of a SimpleWirelessMultiQueue is a transmit queue of
+      // the queue interface, so that an mq queue disc can have a child
+      // queue disc per sub-queue
+      std::size_t nTxQueues = m_multiQueue ? m_multiQueue->GetNSubQueues () : 1;
+      if (!m_queueInterface)
+        {
+          CreateQueueInterface (nTxQueues);
+        }
+      NS_ABORT_MSG_IF (m_queueInterface->GetNTxQueues () != nTxQueues,
+                       "The number of transmit queues is set by the first TxQueue of the device");
+    }
 }
 
 Ptr<Queue<Packet> >
@@ -1004,21 +2661,211 @@ SimpleWirelessNetDevice::GetQueue (void) const
   return m_queue;
 }
 
+void
+SimpleWirelessNetDevice::SetTxDescriptorQueueSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  NS_ABORT_MSG_IF (size < m_txRingCount, "TxDescriptorQueueSize " << size << " is below the "
+                   << m_txRingCount << " descriptors queued");
+  m_txRingSize = size;
+  if (!m_txRing.empty ())
+    {
+      // Move the queued descriptors to the start of a ring of the new size
+      std::vector<TxDescriptor> ring (size);
+      for (uint32_t i = 0; i < m_txRingCount; i++)
+        {
+          std::swap (ring[i], m_txRing[(m_txRingHead + i) % m_txRing.size ()]);
+        }
+      m_txRing.swap (ring);
+      m_txRingHead = 0;
+    }
+}
+
+uint32_t
+SimpleWirelessNetDevice::GetTxDescriptorQueueSize (void) const
+{
+  return m_txRingSize;
+}
+
+double
+SimpleWirelessNetDevice::GetTxQueueFill (void) const
+{
+  if (m_txDescriptorQueue)
+    {
+      return static_cast<double> (m_txRingCount) / m_txRingSize;
+    }
+  if (!m_queue)
+    {
+      return 0;
+    }
+  QueueSize maxSize = m_queue->GetMaxSize ();
+  if (maxSize.GetValue () == 0)
+    {
+      return 0;
+    }
+  uint32_t size = maxSize.GetUnit () == QueueSizeUnit::PACKETS ? m_queue->GetNPackets () : m_queue->GetNBytes ();
+  return static_cast<double> (size) / maxSize.GetValue ();
+}
+
+void
+SimpleWirelessNetDevice::CreateQueueInterface (std::size_t nTxQueues)
+{
+  NS_LOG_FUNCTION (this << nTxQueues);
+  m_queueInterface = CreateObjectWithAttributes<NetDeviceQueueInterface> ("NTxQueues", UintegerValue (nTxQueues));
+  if (nTxQueues > 1)
+    {
+      m_queueInterface->SetSelectQueueCallback ([this] (Ptr<QueueItem> item) { return SelectTxQueue (item); });
+    }
+  m_txDequeuedBytes.assign (nTxQueues, 0);
+  AggregateObject (m_queueInterface);
+}
+
+uint32_t
+SimpleWirelessNetDevice::GetTxQueueIndex (Ptr<const Packet> p) const
+{
+  if (!m_multiQueue)
+    {
+      return 0;
+    }
+  SocketPriorityTag priorityTag;
+  uint8_t priority = 0;
+  if (p->PeekPacketTag (priorityTag))
+    {
+      priority = priorityTag.GetPriority ();
+    }
+  return m_multiQueue->GetSubQueue (priority);
+}
+
+std::size_t
+SimpleWirelessNetDevice::SelectTxQueue (Ptr<QueueItem> item) const
+{
+  return GetTxQueueIndex (item->GetPacket ());
+}
+
+void
+SimpleWirelessNetDevice::NotifyTxQueued (uint32_t txQueue, uint32_t bytes)
+{
+  NS_LOG_FUNCTION (this << txQueue << bytes);
+  if (!m_queueInterface)
+    {
+      return;
+    }
+  m_queueInterface->GetTxQueue (txQueue)->NotifyQueuedBytes (bytes);
+  // The transmit queues share the device queue, so they stop together
+  if (!m_txQueueStopped && GetTxQueueFill () >= m_txHighWatermark)
+    {
+      NS_LOG_DEBUG ("Device queue at the high watermark, stopping the transmit queues");
+      m_txQueueStopped = true;
+      for (std::size_t i = 0; i < m_queueInterface->GetNTxQueues (); i++)
+        {
+          m_queueInterface->GetTxQueue (i)->Stop ();
+        }
+    }
+}
+
+void
+SimpleWirelessNetDevice::NotifyTxDequeued (uint32_t txQueue, uint32_t bytes)
+{
+  NS_LOG_FUNCTION (this << txQueue << bytes);
+  if (m_queueInterface)
+    {
+      m_txDequeuedBytes[txQueue] += bytes;
+    }
+}
+
+void
+SimpleWirelessNetDevice::UpdateTxQueueState (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_queueInterface)
+    {
+      return;
+    }
+  for (std::size_t i = 0; i < m_txDequeuedBytes.size (); i++)
+    {
+      if (m_txDequeuedBytes[i] > 0)
+        {
+          uint32_t bytes = m_txDequeuedBytes[i];
+          m_txDequeuedBytes[i] = 0;
+          m_queueInterface->GetTxQueue (i)->NotifyTransmittedBytes (bytes);
+        }
+    }
+  if (m_txQueueStopped && GetTxQueueFill () < m_txLowWatermark)
+    {
+      NS_LOG_DEBUG ("Device queue below the low watermark, waking the transmit queues");
+      m_txQueueStopped = false;
+      // A woken queue disc may fill the device queue up again
+      for (std::size_t i = 0; i < m_queueInterface->GetNTxQueues () && !m_txQueueStopped; i++)
+        {
+          m_queueInterface->GetTxQueue (i)->Wake ();
+        }
+    }
+}
+
+void
+SimpleWirelessNetDevice::QueueEnqueued (Ptr<const Packet> p)
+{
+  NotifyTxQueued (GetTxQueueIndex (p), p->GetSize ());
+}
+
+void
+SimpleWirelessNetDevice::QueueDequeued (Ptr<const Packet> p)
+{
+  NotifyTxDequeued (GetTxQueueIndex (p), p->GetSize ());
+}
+
 
 void SimpleWirelessNetDevice::EnablePcapAll (std::string filename)
 {
+  // The device writes to the file itself instead of going through the
+  // PromiscSniffer trace, so received packets need not be rebuilt
   PcapHelper pcapHelper;
-  Ptr<PcapFileWrapper> file = pcapHelper.CreateFile (filename, std::ios::out, PcapHelper::DLT_EN10MB);
-  pcapHelper.HookDefaultSink<SimpleWirelessNetDevice> (this, "PromiscSniffer", file);
+  m_pcapFile = pcapHelper.CreateFile (filename, std::ios::out, PcapHelper::DLT_EN10MB, m_pcapSnapLen);
   m_pcapEnabled = true;
 }
 
+void
+SimpleWirelessNetDevice::Sniff (Ptr<const Packet> packet)
+{
+  if (m_pcapFile)
+    {
+      m_pcapFile->Write (Simulator::Now (), packet);
+    }
+  m_promiscSnifferTrace (packet);
+}
+
+void
+SimpleWirelessNetDevice::Sniff (Ptr<const Packet> packet, Mac48Address to, Mac48Address from, uint16_t protocol)
+{
+  // The capture file gets the header written in front of the packet
+  // bytes; a new packet is only made for other trace sinks.
+  EthernetHeader ethHeader;
+  ethHeader.SetDestination (to);
+  ethHeader.SetSource (from);
+  ethHeader.SetLengthType (protocol);
+  if (m_pcapFile)
+    {
+      m_pcapFile->Write (Simulator::Now (), ethHeader, packet);
+    }
+  if (!m_promiscSnifferTrace.IsEmpty ())
+    {
+      Ptr<Packet> sniffed = packet->Copy ();
+      sniffed->AddHeader (ethHeader);
+      m_promiscSnifferTrace (sniffed);
+    }
+}
+
 int64_t
 SimpleWirelessNetDevice::AssignStreams (int64_t stream)
 {
   NS_LOG_FUNCTION (this << stream);
-  m_uniformRv->SetStream (stream++);
-  return 1;
+  int64_t currentStream = stream;
+  m_uniformRv->SetStream (currentStream++);
+  if (m_rateManager)
+    {
+      currentStream += m_rateManager->AssignStreams (currentStream);
+    }
+  return currentStream - stream;
 }
 
 } // namespace ns3
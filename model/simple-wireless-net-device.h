@@ -21,13 +21,18 @@
 #define SIMPLE_WIRELESS_NET_DEVICE_H
 
 #include <stdint.h>
+#include <deque>
+#include <map>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include "ns3/traced-callback.h"
 #include "ns3/net-device.h"
 #include "ns3/mac48-address.h"
 #include "ns3/trace-helper.h"
 #include "ns3/data-rate.h"
 #include "ns3/queue.h"
+#include "ns3/net-device-queue-interface.h"
 #include "ns3/ethernet-header.h"
 #include "ns3/double.h"
 #include "ns3/boolean.h"
@@ -35,6 +40,8 @@
 namespace ns3 {
 
 class SimpleWirelessChannel;
+class SimpleWirelessMultiQueue;
+class SimpleWirelessRateManager;
 class SnrPerErrorModel;
 class Node;
 class ErrorModel;
@@ -106,6 +113,150 @@ private:
 };
 
 
+//********************************************************
+//  AggregateTag marks a frame made of several packets
+//  sent together, each preceded by a SubframeHeader
+//********************************************************
+class AggregateTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  AggregateTag ();
+
+  // these are our accessors to our tag structure
+  void SetNSubframes (uint32_t n);
+  uint32_t GetNSubframes (void) const;
+
+  void Print (std::ostream &os) const;
+
+private:
+  uint32_t m_nSubframes;
+
+  // end class AggregateTag
+};
+
+
+//********************************************************
+//  SubframeHeader gives the length and protocol of a
+//  packet in an aggregate frame
+//********************************************************
+class SubframeHeader : public Header
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  SubframeHeader ();
+
+  void SetLength (uint32_t length);
+  uint32_t GetLength (void) const;
+  void SetProtocol (uint16_t protocol);
+  uint16_t GetProtocol (void) const;
+
+  void Print (std::ostream &os) const;
+
+private:
+  uint32_t m_length;
+  uint16_t m_protocol;
+
+  // end class SubframeHeader
+};
+
+
+//********************************************************
+//  ArqTag marks a frame sent with link-layer ARQ, which
+//  starts with an ArqHeader
+//********************************************************
+class ArqTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  ArqTag ();
+
+  void Print (std::ostream &os) const;
+
+  // end class ArqTag
+};
+
+
+//********************************************************
+//  ArqHeader gives the type (data or ACK) and sequence
+//  number of a link-layer ARQ frame
+//********************************************************
+class ArqHeader : public Header
+{
+public:
+  enum FrameType
+  {
+    DATA = 0,
+    ACK = 1
+  };
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  ArqHeader ();
+
+  void SetType (FrameType type);
+  FrameType GetType (void) const;
+  void SetSequence (uint16_t seq);
+  uint16_t GetSequence (void) const;
+
+  void Print (std::ostream &os) const;
+
+private:
+  uint8_t m_type;
+  uint16_t m_seq;
+
+  // end class ArqHeader
+};
+
+
+//********************************************************
+//  McsTag gives the index, in the MCS table of the
+//  SimpleWirelessRateManager, of the rate a frame is
+//  sent at
+//********************************************************
+class McsTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  McsTag ();
+
+  // these are our accessors to our tag structure
+  void SetMcs (uint8_t mcs);
+  uint8_t GetMcs (void) const;
+
+  void Print (std::ostream &os) const;
+
+private:
+  uint8_t m_mcs;
+
+  // end class McsTag
+};
+
+
 
 /**
  * \ingroup netdevice
@@ -137,6 +288,13 @@ public:
    */
   void SetReceiveErrorModel (Ptr<ErrorModel> em);
 
+  /**
+   * Get pointer to the receive ErrorModel
+   *
+   * \return Ptr to the ErrorModel, or 0 if there is none.
+   */
+  Ptr<ErrorModel> GetReceiveErrorModel (void) const;
+
   /**
    * Attach a receive SnrPerErrorModel to the SimpleWirelessNetDevice.
    *
@@ -154,6 +312,24 @@ public:
    */
   Ptr<SnrPerErrorModel> GetSnrPerErrorModel (void) const;
 
+  /**
+   * Attach a SimpleWirelessRateManager, which chooses the rate of each
+   * unicast frame by destination from its MCS table instead of DataRate.
+   * Group frames go at the lowest rate of the table.  The receiver of a
+   * frame applies the SnrPerErrorModel of its MCS in place of the one set
+   * with SetSnrPerErrorModel.
+   *
+   * \param manager Ptr to the SimpleWirelessRateManager, or 0 for none.
+   */
+  void SetRateManager (Ptr<SimpleWirelessRateManager> manager);
+
+  /**
+   * Get pointer to the SimpleWirelessRateManager
+   *
+   * \return Ptr to the SimpleWirelessRateManager, or 0 if there is none.
+   */
+  Ptr<SimpleWirelessRateManager> GetRateManager (void) const;
+
   /**
    * Set the Data Rate used for transmission of packets.  The data rate is
    * set in the Attach () method from the corresponding field in the channel
@@ -164,6 +340,17 @@ public:
    */
   void SetDataRate (DataRate bps);
 
+  /**
+   * \return the data rate used for transmission of packets
+   */
+  DataRate GetDataRate (void) const;
+
+  /**
+   * \return the number of bytes waiting to be sent: the queued packets
+   * and the packet being sent, if any
+   */
+  uint32_t GetTxBacklog (void) const;
+
   /**
    * set noise power
    */
@@ -190,26 +377,84 @@ public:
    */
   Ptr<Queue<Packet> > GetQueue (void) const;
 
+  /**
+   * Set the capacity of the descriptor queue (TxDescriptorQueueSize).
+   * Descriptors already queued are kept, in order.
+   *
+   * \param size the maximum number of packets in the descriptor queue, at
+   * least the number queued
+   */
+  void SetTxDescriptorQueueSize (uint32_t size);
+
+  /**
+   * \return the maximum number of packets in the descriptor queue
+   */
+  uint32_t GetTxDescriptorQueueSize (void) const;
+
   //******************************************
   // Directional Neighbor functions
   bool AddDirectionalNeighbors (std::map<uint32_t, Mac48Address> nodesToAdd);
   bool AddDirectionalNeighbor (uint32_t nodeid, Mac48Address macAddr);
   void DeleteDirectionalNeighbors (std::set<uint32_t> nodeids);
   void DeleteDirectionalNeighbor (uint32_t nodeid);
+  /**
+   * Replace all the directional neighbors at once. Packets already queued
+   * keep the destinations they were queued with.
+   *
+   * \param nodes the new neighbors, node id to MAC address
+   * \return false if directional networking is not enabled
+   */
+  bool SetDirectionalNeighbors (std::map<uint32_t, Mac48Address> nodes);
 
   //******************************************
   // Fixed Contention functions
   void ClearNbrCount (void);
   void IncrementNbrCount (void);
   int GetNbrCount (void);
+  /**
+   * Read the neighbor count from the channel if it uses fixed contention
+   */
+  void UpdateNbrCount (void);
+
+  /**
+   * For use with slotted aloha. Called by the channel at the start of a
+   * slot requested by the device; sends the next queued frame if the
+   * device is idle.
+   */
+  void HandleStartOfFrame (void);
+
+  /**
+   * For use with the DCF MAC. Called by the channel, when a transmission
+   * starts, for every device in range of the sender, so that the device
+   * knows when the medium is busy and which frames overlap.
+   *
+   * \param sender the transmitting device
+   * \param uid the uid of the transmitted packet
+   * \param propDelay the propagation delay to this device
+   * \param duration the duration of the transmission
+   * \param to the destination address; a unicast frame also keeps the
+   * medium busy for its ACK
+   */
+  void NotifyMediumBusy (Ptr<SimpleWirelessNetDevice> sender, uint64_t uid, Time propDelay,
+                         Time duration, Mac48Address to);
+
+  /**
+   * For use with the DCF MAC. Called, at the end of the ACK, by the
+   * device that received the unicast frame being sent.
+   *
+   * \param snrDb the SNR (dB) of the frame at its receiver, taken for the
+   * SNR of the ACK
+   */
+  void NotifyAck (double snrDb);
 
 
   void EnablePcapAll (std::string filename);
 
   /**
    * Assign a fixed random variable stream number to the random variables
-   * used by this model. Return the number of streams (possibly zero) that
-   * have been assigned.
+   * used by this model, including those of the RateManager, which must be
+   * set first. Return the number of streams (possibly zero) that have been
+   * assigned.
    *
    * \param stream first stream index to use
    * \return the number of stream indices assigned by this model
@@ -272,6 +517,14 @@ public:
    */
   typedef void (*QueueLatencyTracedCallback)(Ptr<const Packet> p, Time latency);
 
+  /**
+   * TracedCallback signature for ARQ retry counts
+   *
+   * \param [in] p Packet pointer
+   * \param [in] retries The number of retransmissions of the packet
+   */
+  typedef void (*ArqRetriesTracedCallback)(Ptr<const Packet> p, uint32_t retries);
+
 protected:
   virtual void DoDispose (void);
   virtual void DoInitialize (void);
@@ -300,6 +553,117 @@ private:
  */
   void TransmitStart (Ptr<Packet>);
 
+  /**
+   * Take the packets that follow p in the queue, up to the aggregation
+   * limits and as long as they go to the same destination, and build one
+   * frame of them all. The Ethernet header and tags of p have been
+   * removed.
+   *
+   * \return p itself if no packet follows it, else the aggregate frame
+   */
+  Ptr<Packet> Aggregate (Ptr<Packet> p, Mac48Address from, Mac48Address to,
+                         uint16_t protocol, uint32_t destId);
+
+  /**
+   * A packet waiting in the descriptor queue, with the fields that are
+   * otherwise carried in its Ethernet header and tags. A fan-out
+   * descriptor lists several directional destinations, to which the
+   * packet is sent one after the other.
+   */
+  struct TxDescriptor
+  {
+    Ptr<Packet> packet;
+    Mac48Address from;
+    Mac48Address to;
+    uint16_t protocol {0};
+    uint32_t destId {NO_DIRECTIONAL_NBR}; //!< destination if destIds is empty
+    std::vector<uint32_t> destIds;         //!< fan-out destinations
+    Time enqueueTime;
+  };
+
+  /**
+   * Queue a packet in the descriptor queue, or start sending it if the
+   * device is idle.
+   *
+   * \param fanOut if true, send the packet to every directional neighbor
+   * instead of destId
+   * \return false if the queue is full and the packet was dropped
+   */
+  bool EnqueueDescriptor (Ptr<Packet> packet, Mac48Address from, Mac48Address to,
+                          uint16_t protocolNumber, uint32_t destId, bool fanOut);
+
+  /**
+   * \return how full the transmit queue (TxQueue or the descriptor queue)
+   * is, as a fraction of its max size
+   */
+  double GetTxQueueFill (void) const;
+
+  /**
+   * Create the queue interface and aggregate it to the device
+   *
+   * \param nTxQueues the number of transmit queues of the interface
+   */
+  void CreateQueueInterface (std::size_t nTxQueues);
+
+  /**
+   * \return the transmit queue of the queue interface that a packet
+   * belongs to: the sub-queue of a SimpleWirelessMultiQueue, else 0
+   */
+  uint32_t GetTxQueueIndex (Ptr<const Packet> p) const;
+
+  /**
+   * The SelectQueueCallback of the queue interface
+   */
+  std::size_t SelectTxQueue (Ptr<QueueItem> item) const;
+
+  /**
+   * Note that bytes have entered the device queue, for the queue limits of
+   * a transmit queue, and stop the transmit queues at the high watermark
+   */
+  void NotifyTxQueued (uint32_t txQueue, uint32_t bytes);
+
+  /**
+   * Note that bytes have left the device queue.  They are passed on when
+   * the transmission ends, since waking a transmit queue may hand the
+   * device a packet while it is taking one out of the queue.
+   */
+  void NotifyTxDequeued (uint32_t txQueue, uint32_t bytes);
+
+  /**
+   * Pass the bytes that have left the device queue to the queue limits
+   * and wake the transmit queues below the low watermark
+   */
+  void UpdateTxQueueState (void);
+
+  /**
+   * Trace sinks of the Enqueue and Dequeue traces of m_queue
+   */
+  void QueueEnqueued (Ptr<const Packet> p);
+  void QueueDequeued (Ptr<const Packet> p);
+
+  /**
+   * Start sending m_txCurrent to its next destination
+   */
+  void TransmitDescriptor (void);
+
+  /**
+   * Compute the transmission time of a packet whose Ethernet header and
+   * tags have been removed, schedule the end of the transmission and hand
+   * the packet to the channel.
+   */
+  void TransmitToChannel (Ptr<Packet> p, Mac48Address from, Mac48Address to,
+                          uint16_t protocol, uint32_t destId);
+
+  /**
+   * Choose the rate of a frame: DataRate without a rate manager, else the
+   * rate of the MCS the manager selects, which is kept in m_txMcs and
+   * added to the frame in a McsTag. The frame must be the device's own
+   * copy, not a packet of the upper layer.
+   *
+   * \return the data rate the frame is sent at
+   */
+  DataRate SelectTxRate (Ptr<Packet> p, Mac48Address to);
+
   /**
    * Stop Sending a Packet Down the Wire and Begin the Interframe Gap.
    *
@@ -309,9 +673,65 @@ private:
   void TransmitComplete (void);
 
   /**
-   * For use with slotted aloha, possibly schedule transmission
+   * Take the next frame from the queue, if any, and start sending it
    */
-  void HandleStartOfFrame (void);
+  void TransmitNext (void);
+
+  /**
+   * \return true if a frame is waiting in the queue
+   */
+  bool HasFrameToSend (void) const;
+
+  /**
+   * With slotted aloha, ask the channel for the next slot if not done yet
+   */
+  void RequestSlot (void);
+
+  /**
+   * With the DCF MAC, schedule the access to the medium for the frame
+   * being retried or the next queued frame, if any and not done yet
+   */
+  void DcfRequestAccess (void);
+
+  /**
+   * Schedule DcfAccess at the end of DIFS and the remaining backoff
+   */
+  void DcfScheduleAccess (void);
+
+  /**
+   * Count down the backoff for the idle slots between the end of DIFS
+   * and the given time
+   */
+  void DcfConsumeBackoff (Time until);
+
+  /**
+   * The backoff is over: send the frame being retried or the next frame
+   */
+  void DcfAccess (void);
+
+  /**
+   * The transmission of a DCF frame is over; wait for its ACK if unicast
+   */
+  void DcfEndOfFrame (void);
+
+  /**
+   * No ACK came for the frame
+   */
+  void DcfAckTimeout (void);
+
+  /**
+   * Finish the frame exchange: update the contention window and retry
+   * count, draw the next backoff and move on to the next frame
+   *
+   * \param success whether the frame was acknowledged (or broadcast)
+   */
+  void DcfTxDone (bool success);
+
+  /**
+   * Receive a frame with the DCF MAC: drop it if it overlapped another
+   * frame, else pass it to DoReceive and acknowledge it if it is for us
+   */
+  void DcfReceive (Ptr<Packet> packet, double rxPower, uint16_t protocol, Mac48Address to, Mac48Address from);
 
   struct ReceivedPacket {
     Ptr<Packet> packet {0};
@@ -323,10 +743,104 @@ private:
     Mac48Address from {Mac48Address ()};
   };
 
+  /**
+   * With ARQ, send the next frame to retransmit, if any, or hold back the
+   * head of the queue if its destination has no room in its window
+   *
+   * \return true if a retransmission was started or the queue is held back
+   */
+  bool ArqTransmitNext (void);
+
+  /**
+   * With ARQ, give a new unicast frame the next sequence number of its
+   * destination and keep it until it is acknowledged
+   *
+   * \return the frame to send, with its ArqHeader and ArqTag
+   */
+  Ptr<Packet> ArqAddFrame (Ptr<Packet> p, Mac48Address from, Mac48Address to,
+                           uint16_t protocol, uint32_t destId);
+
+  /**
+   * \return a copy of the kept frame with its ArqHeader and ArqTag
+   */
+  Ptr<Packet> ArqBuildFrame (Ptr<const Packet> p, uint32_t seq) const;
+
+  /**
+   * \return true if another frame may be sent to the destination
+   */
+  bool ArqWindowOpen (Mac48Address to) const;
+
+  /**
+   * No ACK came in time for a frame: retransmit it, or drop it at the
+   * retry limit
+   */
+  void ArqAckTimeout (uint64_t key, uint32_t seq);
+
+  /**
+   * Receive a frame with an ArqTag: pass a data frame on to ReceiveFrame,
+   * without its ArqHeader, and acknowledge it if it is for us; handle an
+   * ACK for us.
+   *
+   * \return false if the frame was dropped by an error model
+   */
+  bool ArqReceive (Ptr<Packet> packet, double rxPower, uint16_t protocol, Mac48Address to, Mac48Address from,
+                   double sinr);
+
+  /**
+   * Send an ACK frame for the sequence number to the sender of a frame
+   */
+  void ArqSendAck (Mac48Address to, uint16_t seq);
+
   /**
    * For modeling receiver processing delay
+   * \param sinr the SINR (dB) given to the SnrPerErrorModel
+   * \param perModel the SnrPerErrorModel of the rate of the frame, or 0
+   * \param duplicate if true, the packet is not passed up (MacDrop trace)
+   * \return false if the packet was dropped by an error model
+   */
+  bool DoReceive (Ptr<Packet> packet, double rxPower, uint16_t protocol, Mac48Address to, Mac48Address from,
+                  double sinr, Ptr<SnrPerErrorModel> perModel, bool duplicate);
+
+  /**
+   * \return the SnrPerErrorModel of the MCS in the McsTag of a frame, if
+   * there is a rate manager, else the one set with SetSnrPerErrorModel
+   */
+  Ptr<SnrPerErrorModel> GetRxPerModel (Ptr<const Packet> packet) const;
+
+  /**
+   * Pass a frame to DoReceive, one subframe at a time if it is an
+   * aggregate
+   *
+   * \return false if every packet of the frame was dropped
    */
-  void DoReceive (Ptr<Packet> packet, double rxPower, uint16_t protocol, Mac48Address to, Mac48Address from);
+  bool ReceiveFrame (Ptr<Packet> packet, double rxPower, uint16_t protocol, Mac48Address to, Mac48Address from,
+                     double sinr, bool duplicate);
+  /**
+   * Write a packet, with its Ethernet header, to the pcap file and the
+   * PromiscSniffer trace
+   * \param packet the packet
+   */
+  void Sniff (Ptr<const Packet> packet);
+
+  static uint64_t GetMacKey (Mac48Address macAddr);
+  void IndexDirectionalNeighbor (uint32_t nodeid, Mac48Address macAddr);
+  void UnindexDirectionalNeighbor (uint32_t nodeid, Mac48Address macAddr);
+  /**
+   * \param macAddr a MAC address
+   * \param nodeid set to the node id of the directional neighbor with
+   * this address, if there is one
+   * \return true if there is a directional neighbor with this address
+   */
+  bool FindDirectionalNeighbor (Mac48Address macAddr, uint32_t &nodeid) const;
+  /**
+   * Write a packet without its Ethernet header to the pcap file and the
+   * PromiscSniffer trace, with the header rebuilt from the given fields
+   * \param packet the packet
+   * \param to the destination address
+   * \param from the source address
+   * \param protocol the protocol number
+   */
+  void Sniff (Ptr<const Packet> packet, Mac48Address to, Mac48Address from, uint16_t protocol);
 
   /**
    * In slotted aloha, handle the received frames.
@@ -364,6 +878,25 @@ private:
  */
   Ptr<Queue<Packet> > m_queue;
 
+  bool m_txDescriptorQueue;            //!< queue descriptors instead of using m_queue
+  std::vector<TxDescriptor> m_txRing;  //!< descriptor queue, used as a circular buffer
+  uint32_t m_txRingHead;               //!< index of the oldest descriptor in m_txRing
+  uint32_t m_txRingCount;              //!< number of descriptors in m_txRing
+  uint32_t m_txRingBytes;              //!< bytes of the packets in m_txRing
+  uint32_t m_txRingSize;               //!< capacity of m_txRing
+  TxDescriptor m_txCurrent;            //!< descriptor being sent
+  std::size_t m_txCurrentNext;         //!< index in m_txCurrent.destIds of the next destination
+
+  // Flow control towards the upper layers: the transmit queues of the
+  // queue interface are stopped when the device queue fills up to the high
+  // watermark, and woken once it has drained below the low watermark
+  Ptr<NetDeviceQueueInterface> m_queueInterface;
+  Ptr<SimpleWirelessMultiQueue> m_multiQueue; //!< m_queue, if its sub-queues are the transmit queues
+  double m_txHighWatermark;            //!< fill of the device queue at which the transmit queues are stopped
+  double m_txLowWatermark;             //!< fill below which they are woken
+  bool m_txQueueStopped;               //!< stopped at the high watermark
+  std::vector<uint32_t> m_txDequeuedBytes; //!< per transmit queue, bytes dequeued and not yet passed to the queue limits
+
   /**
    * The trace source fired when a packet begins the reception process from
    * the medium.
@@ -425,6 +958,37 @@ private:
    * \see class CallBackTraceSource
    */
   TracedCallback<Ptr<const Packet> > m_macTxTrace;
+  /**
+   * The trace source fired when a packet is dropped because the descriptor
+   * queue is full.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+
+  /**
+   * The trace source fired when a DCF frame is acknowledged (or sent, if
+   * broadcast), with the time since it reached the head of the queue.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, Time> m_dcfAccessDelayTrace;
+
+  /**
+   * The trace source fired when an ARQ frame is acknowledged or dropped
+   * at the retry limit, with its number of retransmissions
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, uint32_t> m_arqRetriesTrace;
+
+  /**
+   * The trace source fired when an ARQ frame is acknowledged, with the
+   * time since its first transmission began
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, Time> m_arqAccessDelayTrace;
 
   /**
    * The trace source fired for packets successfully received by the device
@@ -446,9 +1010,14 @@ private:
   uint32_t  m_pktRcvTotal;
   uint32_t  m_pktRcvDrop;
   bool      m_pcapEnabled;
+  uint32_t  m_pcapSnapLen;
+  Ptr<PcapFileWrapper> m_pcapFile; //!< file written by EnablePcapAll
 
   bool   m_fixedNbrListEnabled;
   std::map<uint32_t, Mac48Address> mDirectionalNbrs;
+  // MAC address (as GetMacKey) to the lowest node id in mDirectionalNbrs
+  // with that address, for directional unicasts
+  std::unordered_map<uint64_t, uint32_t> m_directionalNbrIndex;
 
   int  m_nbrCount;
   double m_noisePower;
@@ -456,12 +1025,111 @@ private:
   Ptr<UniformRandomVariable> m_uniformRv; //!< Provides uniform random variates
 
   Ptr<SnrPerErrorModel> m_snrPerErrorModel; 
+  Ptr<SimpleWirelessRateManager> m_rateManager;
+  uint32_t m_txMcs;       //!< MCS of the last frame sent with a rate manager
   
   bool m_slottedAloha;    //!< Whether to enable slotted aloha
   uint32_t m_slottedAlohaReceptions; //!< For detecting MAC collisions
+  bool m_slottedAlohaCapture; //!< Whether the strongest frame of a collision may be decoded
+  double m_captureThreshold; //!< SINR (dB) needed for capture
+  struct ReceivedPacket m_slotCandidate; //!< strongest frame received in the slot
+  double m_slotInterference; //!< total power (mW) of the other frames of the slot
+  bool m_slotRequested;   //!< Waiting for a slot from the channel
   EventId m_receiveEvent; //!< Event for delayed reception handling
+  uint32_t m_aggregationMaxPackets; //!< most packets sent in one frame
+  uint32_t m_aggregationMaxBytes;   //!< most bytes sent in one frame
   Time m_receiverProcessingDelay; //!< delay in receiver processing
-  std::list<struct ReceivedPacket> m_receiveList; //!< accumulate received packets
+
+  // DCF MAC. The backoff counts the idle slots from m_dcfBusyUntil plus
+  // DIFS; it is only brought up to date when the medium becomes busy or
+  // the access is scheduled.
+  bool m_dcf;             //!< Whether to use the DCF MAC
+  Time m_dcfSlot;
+  Time m_dcfSifs;
+  Time m_dcfDifs;
+  Time m_dcfAckDuration;
+  Time m_dcfPhyHeader;    //!< added to the transmission time of each frame
+  uint32_t m_dcfCwMin;
+  uint32_t m_dcfCwMax;
+  uint32_t m_dcfRetryLimit;
+  uint32_t m_dcfCw;       //!< current contention window
+  uint32_t m_dcfBackoff;  //!< backoff slots left after m_dcfBusyUntil plus DIFS
+  uint32_t m_dcfRetries;  //!< retransmissions of the current frame so far
+  bool m_dcfRetry;        //!< m_dcfFrame waits for a retransmission
+  Time m_dcfBusyUntil;    //!< end of the last busy period (including NAV)
+  Time m_dcfTxEnd;        //!< end of the last transmission of this device
+  Time m_dcfHolTime;      //!< time the current frame reached the head of the queue
+  Time m_dcfAccessTime;   //!< time at which m_dcfAccessEvent runs
+  EventId m_dcfAccessEvent;
+  EventId m_dcfAckTimeoutEvent;
+
+  /**
+   * The frame of the current exchange, kept for retransmissions
+   */
+  struct DcfFrame
+  {
+    Ptr<Packet> packet;
+    Mac48Address from;
+    Mac48Address to;
+    uint16_t protocol {0};
+    uint32_t destId {NO_DIRECTIONAL_NBR};
+  };
+  DcfFrame m_dcfFrame;
+
+  /**
+   * A frame on its way to this device, for detecting collisions
+   */
+  struct DcfRxFrame
+  {
+    uint64_t uid;
+    Time end;
+    Ptr<SimpleWirelessNetDevice> sender;
+    bool collided;
+  };
+  std::vector<DcfRxFrame> m_dcfRxFrames;
+
+  // Link-layer ARQ (selective repeat). Frames are numbered per destination
+  // and kept until acknowledged; the sequence numbers are 32 bits here and
+  // sent as their low 16 bits.
+  bool m_arq;             //!< Whether to use link-layer ARQ
+  uint32_t m_arqWindowSize; //!< most unacknowledged frames per destination
+  uint32_t m_arqRetryLimit;
+  Time m_arqAckTimeout;   //!< from the end of a frame
+  uint32_t m_arqAckSize;  //!< bytes of an ACK frame
+
+  /**
+   * A frame waiting for its ACK, without its ArqHeader
+   */
+  struct ArqTxFrame
+  {
+    Ptr<Packet> packet;
+    Mac48Address from;
+    Mac48Address to;
+    uint16_t protocol {0};
+    uint32_t destId {NO_DIRECTIONAL_NBR};
+    uint32_t retries {0};   //!< retransmissions so far
+    uint32_t mcs {0};       //!< MCS of the last transmission, with a rate manager
+    Time firstTxTime;       //!< start of the first transmission
+    EventId ackTimeoutEvent;
+  };
+
+  /**
+   * The frames sent to one destination
+   */
+  struct ArqTxState
+  {
+    uint32_t nextSeq {0};
+    std::map<uint32_t, ArqTxFrame> frames; //!< unacknowledged frames, by sequence number
+  };
+
+  std::unordered_map<uint64_t, ArqTxState> m_arqTx; //!< by GetMacKey of the destination
+  std::deque<std::pair<uint64_t, uint32_t> > m_arqRetxQueue; //!< frames to retransmit, by key and sequence number
+  bool m_arqCurrent;          //!< the frame being sent is an ARQ frame
+  uint64_t m_arqCurrentKey;   //!< its destination key
+  uint32_t m_arqCurrentSeq;   //!< its sequence number
+  // Sequence numbers recently received from each source (by GetMacKey),
+  // for discarding the retransmissions of frames whose ACK was lost
+  std::unordered_map<uint64_t, std::deque<uint16_t> > m_arqRx;
 };
 
 } // namespace ns3
@@ -0,0 +1,440 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include "simple-wireless-rate-manager.h"
+#include "snr-per-error-model.h"
+
+#include "ns3/assert.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SimpleWirelessRateManager");
+
+NS_OBJECT_ENSURE_REGISTERED (SimpleWirelessRateManager);
+
+TypeId SimpleWirelessRateManager::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SimpleWirelessRateManager")
+    .SetParent<Object> ()
+    .SetGroupName ("SimpleWireless")
+  ;
+  return tid;
+}
+
+SimpleWirelessRateManager::SimpleWirelessRateManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SimpleWirelessRateManager::~SimpleWirelessRateManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SimpleWirelessRateManager::DoDispose (void)
+{
+  m_mcs.clear ();
+  m_snr.clear ();
+  Object::DoDispose ();
+}
+
+void
+SimpleWirelessRateManager::AddMcs (DataRate rate, Ptr<SnrPerErrorModel> perModel)
+{
+  NS_LOG_FUNCTION (this << rate << perModel);
+  NS_ASSERT_MSG (perModel, "An MCS needs an SnrPerErrorModel");
+  NS_ASSERT_MSG (m_mcs.empty () || m_mcs.back ().rate < rate, "MCS must be added in increasing order of rate");
+  Mcs mcs;
+  mcs.rate = rate;
+  mcs.perModel = perModel;
+  m_mcs.push_back (mcs);
+}
+
+uint32_t
+SimpleWirelessRateManager::GetNMcs (void) const
+{
+  return m_mcs.size ();
+}
+
+DataRate
+SimpleWirelessRateManager::GetRate (uint32_t mcs) const
+{
+  NS_ASSERT (mcs < m_mcs.size ());
+  return m_mcs[mcs].rate;
+}
+
+Ptr<SnrPerErrorModel>
+SimpleWirelessRateManager::GetPerModel (uint32_t mcs) const
+{
+  NS_ASSERT (mcs < m_mcs.size ());
+  return m_mcs[mcs].perModel;
+}
+
+uint32_t
+SimpleWirelessRateManager::SelectMcs (Mac48Address to, uint32_t bytes)
+{
+  NS_LOG_FUNCTION (this << to << bytes);
+  NS_ASSERT_MSG (!m_mcs.empty (), "No MCS to select");
+  uint32_t mcs = DoSelectMcs (to, bytes);
+  NS_ASSERT (mcs < m_mcs.size ());
+  NS_LOG_DEBUG ("MCS " << mcs << " (" << m_mcs[mcs].rate << ") to " << to);
+  return mcs;
+}
+
+void
+SimpleWirelessRateManager::NotifyTxResult (Mac48Address to, uint32_t mcs, bool success)
+{
+  NS_LOG_FUNCTION (this << to << mcs << success);
+  NS_ASSERT (mcs < m_mcs.size ());
+  DoNotifyTxResult (to, mcs, success);
+}
+
+void
+SimpleWirelessRateManager::NotifyRxSnr (Mac48Address from, double snrDb)
+{
+  NS_LOG_FUNCTION (this << from << snrDb);
+  m_snr[from] = snrDb;
+}
+
+bool
+SimpleWirelessRateManager::GetSnr (Mac48Address station, double &snrDb) const
+{
+  std::map<Mac48Address, double>::const_iterator it = m_snr.find (station);
+  if (it == m_snr.end ())
+    {
+      return false;
+    }
+  snrDb = it->second;
+  return true;
+}
+
+int64_t
+SimpleWirelessRateManager::AssignStreams (int64_t stream)
+{
+  return 0;
+}
+
+void
+SimpleWirelessRateManager::DoNotifyTxResult (Mac48Address to, uint32_t mcs, bool success)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (OracleRateManager);
+
+TypeId OracleRateManager::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OracleRateManager")
+    .SetParent<SimpleWirelessRateManager> ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<OracleRateManager> ()
+    .AddAttribute ("TargetPer",
+                   "Highest packet error rate of the rate chosen",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&OracleRateManager::m_targetPer),
+                   MakeDoubleChecker<double> (0, 1))
+  ;
+  return tid;
+}
+
+OracleRateManager::OracleRateManager ()
+  : m_targetPer (0.1)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OracleRateManager::~OracleRateManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+OracleRateManager::DoSelectMcs (Mac48Address to, uint32_t bytes)
+{
+  double snr;
+  if (!GetSnr (to, snr))
+    {
+      return 0;
+    }
+  for (uint32_t mcs = GetNMcs () - 1; mcs > 0; mcs--)
+    {
+      double per = GetPerModel (mcs)->Receive (snr, bytes);
+      if (per <= m_targetPer)
+        {
+          NS_LOG_LOGIC ("PER " << per << " at MCS " << mcs << ", SNR " << snr);
+          return mcs;
+        }
+    }
+  return 0;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (ArfRateManager);
+
+TypeId ArfRateManager::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ArfRateManager")
+    .SetParent<SimpleWirelessRateManager> ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<ArfRateManager> ()
+    .AddAttribute ("SuccessThreshold",
+                   "Frames acknowledged in a row before moving up a rate",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&ArfRateManager::m_successThreshold),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TimerThreshold",
+                   "Frames sent at a rate before moving up, whatever their outcome",
+                   UintegerValue (15),
+                   MakeUintegerAccessor (&ArfRateManager::m_timerThreshold),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Adaptive",
+                   "Double the thresholds of a destination when the first frame after moving up "
+                   "is lost (AARF)",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ArfRateManager::m_adaptive),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxSuccessThreshold",
+                   "Largest success threshold reached by doubling, with Adaptive",
+                   UintegerValue (60),
+                   MakeUintegerAccessor (&ArfRateManager::m_maxSuccessThreshold),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+ArfRateManager::ArfRateManager ()
+  : m_successThreshold (10),
+    m_timerThreshold (15),
+    m_adaptive (false),
+    m_maxSuccessThreshold (60)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+ArfRateManager::~ArfRateManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+ArfRateManager::GetSuccessThreshold (Mac48Address station) const
+{
+  std::map<Mac48Address, Station>::const_iterator it = m_stations.find (station);
+  return m_successThreshold * (it == m_stations.end () ? 1 : it->second.scale);
+}
+
+uint32_t
+ArfRateManager::DoSelectMcs (Mac48Address to, uint32_t bytes)
+{
+  return m_stations[to].mcs;
+}
+
+void
+ArfRateManager::DoNotifyTxResult (Mac48Address to, uint32_t mcs, bool success)
+{
+  Station &station = m_stations[to];
+  station.timer++;
+  if (success)
+    {
+      station.success++;
+      station.failed = 0;
+      station.recovery = false;
+      if ((station.success >= m_successThreshold * station.scale
+           || station.timer >= m_timerThreshold * station.scale)
+          && station.mcs + 1 < GetNMcs ())
+        {
+          station.mcs++;
+          station.success = 0;
+          station.timer = 0;
+          station.recovery = true;
+          NS_LOG_DEBUG ("Up to MCS " << station.mcs << " for " << to);
+        }
+      return;
+    }
+
+  station.failed++;
+  station.success = 0;
+  if (station.recovery)
+    {
+      // The probe of the higher rate failed
+      if (m_adaptive && m_successThreshold * station.scale * 2 <= m_maxSuccessThreshold)
+        {
+          station.scale *= 2;
+        }
+      if (station.mcs > 0)
+        {
+          station.mcs--;
+        }
+      station.failed = 0;
+      station.timer = 0;
+      station.recovery = false;
+      NS_LOG_DEBUG ("Probe failed, back to MCS " << station.mcs << " for " << to
+                    << ", success threshold " << m_successThreshold * station.scale);
+    }
+  else if (station.failed >= 2)
+    {
+      if (station.mcs > 0)
+        {
+          station.mcs--;
+        }
+      station.failed = 0;
+      station.timer = 0;
+      station.scale = 1;
+      NS_LOG_DEBUG ("Down to MCS " << station.mcs << " for " << to);
+    }
+}
+
+NS_OBJECT_ENSURE_REGISTERED (MinstrelRateManager);
+
+TypeId MinstrelRateManager::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MinstrelRateManager")
+    .SetParent<SimpleWirelessRateManager> ()
+    .SetGroupName ("SimpleWireless")
+    .AddConstructor<MinstrelRateManager> ()
+    .AddAttribute ("UpdateInterval",
+                   "Time between updates of the statistics of a destination",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&MinstrelRateManager::m_updateInterval),
+                   MakeTimeChecker (TimeStep (1)))
+    .AddAttribute ("EwmaLevel",
+                   "Weight of the past in the moving average of the success probability",
+                   DoubleValue (0.75),
+                   MakeDoubleAccessor (&MinstrelRateManager::m_ewmaLevel),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("LookAroundRate",
+                   "Fraction of the frames sent at a rate drawn at random",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&MinstrelRateManager::m_lookAroundRate),
+                   MakeDoubleChecker<double> (0, 1))
+  ;
+  return tid;
+}
+
+MinstrelRateManager::MinstrelRateManager ()
+  : m_ewmaLevel (0.75),
+    m_lookAroundRate (0.1)
+{
+  NS_LOG_FUNCTION (this);
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+MinstrelRateManager::~MinstrelRateManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MinstrelRateManager::DoDispose (void)
+{
+  m_stations.clear ();
+  m_random = 0;
+  SimpleWirelessRateManager::DoDispose ();
+}
+
+int64_t
+MinstrelRateManager::AssignStreams (int64_t stream)
+{
+  m_random->SetStream (stream);
+  return 1;
+}
+
+double
+MinstrelRateManager::GetSuccessProbability (Mac48Address station, uint32_t mcs) const
+{
+  std::map<Mac48Address, Station>::const_iterator it = m_stations.find (station);
+  if (it == m_stations.end () || mcs >= it->second.stats.size ())
+    {
+      return 0;
+    }
+  return it->second.stats[mcs].probability;
+}
+
+MinstrelRateManager::Station &
+MinstrelRateManager::GetStation (Mac48Address to)
+{
+  Station &station = m_stations[to];
+  Time now = Simulator::Now ();
+  if (station.stats.empty ())
+    {
+      station.stats.resize (GetNMcs ());
+      station.nextUpdate = now + m_updateInterval;
+      return station;
+    }
+  if (now < station.nextUpdate)
+    {
+      return station;
+    }
+  station.nextUpdate = now + m_updateInterval;
+  double bestThroughput = 0;
+  for (uint32_t mcs = 0; mcs < station.stats.size (); mcs++)
+    {
+      McsStats &stats = station.stats[mcs];
+      if (stats.attempts > 0)
+        {
+          double p = static_cast<double> (stats.successes) / stats.attempts;
+          stats.probability = stats.sampled ? m_ewmaLevel * stats.probability + (1 - m_ewmaLevel) * p : p;
+          stats.sampled = true;
+          stats.attempts = 0;
+          stats.successes = 0;
+        }
+      // ties go to the lower rate
+      double throughput = stats.probability * GetRate (mcs).GetBitRate ();
+      if (throughput > bestThroughput)
+        {
+          station.best = mcs;
+          bestThroughput = throughput;
+        }
+    }
+  NS_LOG_DEBUG ("Best MCS " << station.best << " for " << to << ", success probability "
+                << station.stats[station.best].probability);
+  return station;
+}
+
+uint32_t
+MinstrelRateManager::DoSelectMcs (Mac48Address to, uint32_t bytes)
+{
+  Station &station = GetStation (to);
+  uint32_t n = station.stats.size ();
+  if (n > 1 && m_random->GetValue () < m_lookAroundRate)
+    {
+      // any rate but the best one
+      uint32_t mcs = m_random->GetInteger (0, n - 2);
+      return mcs >= station.best ? mcs + 1 : mcs;
+    }
+  return station.best;
+}
+
+void
+MinstrelRateManager::DoNotifyTxResult (Mac48Address to, uint32_t mcs, bool success)
+{
+  McsStats &stats = GetStation (to).stats[mcs];
+  stats.attempts++;
+  if (success)
+    {
+      stats.successes++;
+    }
+}
+
+} // namespace ns3
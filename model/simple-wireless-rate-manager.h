@@ -0,0 +1,294 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2024 University of Washington
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SIMPLE_WIRELESS_RATE_MANAGER_H
+#define SIMPLE_WIRELESS_RATE_MANAGER_H
+
+#include <map>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/data-rate.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+class SnrPerErrorModel;
+class UniformRandomVariable;
+
+/**
+ * \ingroup simple-wireless
+ * \brief Chooses the rate at which a SimpleWirelessNetDevice sends each
+ * unicast frame, per destination
+ *
+ * The rates come from a table of modulation and coding schemes (MCS),
+ * each a data rate and the SnrPerErrorModel of a frame sent at that rate,
+ * in increasing order of rate.  The device tells the manager the SNR of
+ * every frame it receives, by sender, and whether each acknowledged frame
+ * got its ACK.  Every device of a channel needs the same table, since the
+ * receiver of a frame applies the SnrPerErrorModel of the MCS it was sent
+ * at.
+ */
+class SimpleWirelessRateManager : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  SimpleWirelessRateManager ();
+  virtual ~SimpleWirelessRateManager ();
+
+  /**
+   * Add an MCS to the end of the table
+   *
+   * \param rate the data rate, above that of the MCS added before
+   * \param perModel the packet error rate of a frame sent at that rate
+   */
+  void AddMcs (DataRate rate, Ptr<SnrPerErrorModel> perModel);
+
+  /**
+   * \return the number of MCS in the table
+   */
+  uint32_t GetNMcs (void) const;
+
+  /**
+   * \param mcs an index in the table
+   * \return the data rate of the MCS
+   */
+  DataRate GetRate (uint32_t mcs) const;
+
+  /**
+   * \param mcs an index in the table
+   * \return the SnrPerErrorModel of the MCS
+   */
+  Ptr<SnrPerErrorModel> GetPerModel (uint32_t mcs) const;
+
+  /**
+   * \param to the destination of the frame
+   * \param bytes the size of the frame
+   * \return the index in the table of the MCS to send the frame at
+   */
+  uint32_t SelectMcs (Mac48Address to, uint32_t bytes);
+
+  /**
+   * Report whether a frame sent at an MCS was acknowledged
+   *
+   * \param to the destination of the frame
+   * \param mcs the MCS the frame was sent at
+   * \param success whether its ACK came
+   */
+  void NotifyTxResult (Mac48Address to, uint32_t mcs, bool success);
+
+  /**
+   * Report the SNR of a frame received from a station, which is also
+   * taken for the SNR at the station of the frames sent to it
+   *
+   * \param from the sender of the frame
+   * \param snrDb the SNR (dB)
+   */
+  void NotifyRxSnr (Mac48Address from, double snrDb);
+
+  /**
+   * \param station a station
+   * \param snrDb set to the SNR (dB) last reported for the station
+   * \return false if no SNR was reported for the station
+   */
+  bool GetSnr (Mac48Address station, double &snrDb) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  virtual int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual uint32_t DoSelectMcs (Mac48Address to, uint32_t bytes) = 0;
+  virtual void DoNotifyTxResult (Mac48Address to, uint32_t mcs, bool success);
+
+  /**
+   * An entry of the MCS table
+   */
+  struct Mcs
+  {
+    DataRate rate;
+    Ptr<SnrPerErrorModel> perModel;
+  };
+  std::vector<Mcs> m_mcs;
+  std::map<Mac48Address, double> m_snr; //!< last SNR (dB) reported per station
+};
+
+/**
+ * Send each frame at the highest rate whose packet error rate, at the SNR
+ * last reported for the destination and for the size of the frame, is at
+ * most TargetPer.  Frames to a destination whose SNR is not known yet go
+ * at the lowest rate.
+ */
+class OracleRateManager : public SimpleWirelessRateManager
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  OracleRateManager ();
+  virtual ~OracleRateManager ();
+
+private:
+  uint32_t DoSelectMcs (Mac48Address to, uint32_t bytes);
+  double m_targetPer;
+};
+
+/**
+ * Automatic Rate Fallback (ARF): move up one rate after SuccessThreshold
+ * frames acknowledged in a row or TimerThreshold frames sent at a rate,
+ * and down one rate after two failures in a row or a failure of the first
+ * frame sent after moving up.  With Adaptive set (AARF), a failure of the
+ * first frame after moving up also doubles the thresholds of the
+ * destination, up to MaxSuccessThreshold successes, and moving down after
+ * two failures resets them.
+ */
+class ArfRateManager : public SimpleWirelessRateManager
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  ArfRateManager ();
+  virtual ~ArfRateManager ();
+
+  /**
+   * \param station a destination
+   * \return the number of frames acknowledged in a row needed to move up
+   * from the current rate of the destination
+   */
+  uint32_t GetSuccessThreshold (Mac48Address station) const;
+
+private:
+  uint32_t DoSelectMcs (Mac48Address to, uint32_t bytes);
+  void DoNotifyTxResult (Mac48Address to, uint32_t mcs, bool success);
+
+  /**
+   * The ARF state of a destination
+   */
+  struct Station
+  {
+    uint32_t mcs {0};
+    uint32_t success {0};   //!< frames acknowledged in a row
+    uint32_t failed {0};    //!< frames lost in a row
+    uint32_t timer {0};     //!< frames sent since the last change of rate
+    bool recovery {false};  //!< no frame has been sent since moving up
+    uint32_t scale {1};     //!< AARF multiplier of the thresholds
+  };
+
+  uint32_t m_successThreshold;
+  uint32_t m_timerThreshold;
+  bool m_adaptive;        //!< AARF
+  uint32_t m_maxSuccessThreshold;
+  std::map<Mac48Address, Station> m_stations;
+};
+
+/**
+ * A Minstrel-like rate manager.  It keeps, per destination and rate, an
+ * exponentially weighted moving average (EWMA) of the fraction of the
+ * frames acknowledged, updated every UpdateInterval from the frames sent
+ * since the last update.  Frames go at the rate with the highest expected
+ * throughput, that fraction times the rate, except for a LookAroundRate
+ * fraction of them, sent at another rate drawn at random so that its
+ * statistics stay current.
+ */
+class MinstrelRateManager : public SimpleWirelessRateManager
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  MinstrelRateManager ();
+  virtual ~MinstrelRateManager ();
+
+  /**
+   * \param station a destination
+   * \param mcs an index in the MCS table
+   * \return the EWMA of the fraction of the frames to the destination at
+   * the MCS that were acknowledged, 0 before the first update
+   */
+  double GetSuccessProbability (Mac48Address station, uint32_t mcs) const;
+
+  virtual int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  uint32_t DoSelectMcs (Mac48Address to, uint32_t bytes);
+  void DoNotifyTxResult (Mac48Address to, uint32_t mcs, bool success);
+
+  /**
+   * The statistics of a rate to a destination
+   */
+  struct McsStats
+  {
+    uint32_t attempts {0};  //!< frames sent since the last update
+    uint32_t successes {0}; //!< frames acknowledged since the last update
+    double probability {0}; //!< EWMA of successes over attempts
+    bool sampled {false};   //!< whether probability holds a sample yet
+  };
+
+  /**
+   * The Minstrel state of a destination
+   */
+  struct Station
+  {
+    std::vector<McsStats> stats;
+    uint32_t best {0};      //!< rate of the highest expected throughput
+    Time nextUpdate;
+  };
+
+  /**
+   * \return the state of a destination, its statistics brought up to date
+   */
+  Station &GetStation (Mac48Address to);
+
+  Time m_updateInterval;
+  double m_ewmaLevel;     //!< weight of the past in the EWMA
+  double m_lookAroundRate;
+  std::map<Mac48Address, Station> m_stations;
+  Ptr<UniformRandomVariable> m_random;
+};
+
+} // namespace ns3
+
+#endif /* SIMPLE_WIRELESS_RATE_MANAGER_H */
@@ -17,11 +17,176 @@
  *
  */
 
+#include <algorithm>
+#include <map>
 #include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/error-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/propagation-loss-model.h"
 #include "ns3/snr-per-error-model.h"
+#include "ns3/simple-wireless-channel.h"
+#include "ns3/simple-wireless-net-device.h"
+#include "ns3/simple-wireless-mld-net-device.h"
+#include "ns3/simple-wireless-link-selector.h"
+#include "ns3/simple-wireless-multi-queue.h"
+#include "ns3/simple-wireless-codel-queue.h"
+#include "ns3/simple-wireless-rate-manager.h"
+#include "ns3/socket.h"
+#include "ns3/enum.h"
+#include "ns3/queue-item.h"
+#include "ns3/pcap-file.h"
 
 using namespace ns3;
 
+/**
+ * \return a node with a ConstantPositionMobilityModel at position
+ */
+static Ptr<Node>
+CreateNode (const Vector &position)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (position);
+  node->AggregateObject (mobility);
+  return node;
+}
+
+/**
+ * \return a SimpleWirelessNetDevice with a new MAC address, added to
+ * the node and to the channel
+ */
+static Ptr<SimpleWirelessNetDevice>
+CreateDevice (Ptr<SimpleWirelessChannel> channel, Ptr<Node> node)
+{
+  Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+  device->SetChannel (channel);
+  device->SetNode (node);
+  device->SetAddress (Mac48Address::Allocate ());
+  node->AddDevice (device);
+  return device;
+}
+
+/**
+ * Create a node at each position, with a device on the channel
+ *
+ * \return the devices, in the order of the positions
+ */
+static std::vector<Ptr<SimpleWirelessNetDevice> >
+CreateDevices (Ptr<SimpleWirelessChannel> channel, const std::vector<Vector> &positions)
+{
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices;
+  for (std::size_t i = 0; i < positions.size (); i++)
+    {
+      devices.push_back (CreateDevice (channel, CreateNode (positions[i])));
+    }
+  return devices;
+}
+
+/**
+ * \return n positions on the x axis, spacing meters apart from the origin
+ */
+static std::vector<Vector>
+LinePositions (uint32_t n, double spacing)
+{
+  std::vector<Vector> positions;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      positions.push_back (Vector (spacing * i, 0, 0));
+    }
+  return positions;
+}
+
+/**
+ * A packet received by a device of a test
+ */
+struct Reception
+{
+  uint32_t device; //!< index of the device in the test
+  uint32_t size;   //!< size of the packet
+  Time time;       //!< time of the reception
+};
+
+static void
+PhyRxBeginSink (std::vector<Reception> *received, uint32_t device, Ptr<const Packet> p, double rxPower, Mac48Address from)
+{
+  received->push_back ({device, p->GetSize (), Simulator::Now ()});
+}
+
+static void
+MacRxSink (std::vector<Reception> *received, uint32_t device, Ptr<const Packet> p)
+{
+  received->push_back ({device, p->GetSize (), Simulator::Now ()});
+}
+
+/**
+ * Add to received the packets that reach a device, from its PhyRxBegin
+ * trace, or from its MacRx trace, which only has the packets passed up,
+ * if mac
+ *
+ * \param index the index of the device recorded with its packets
+ */
+static void
+RecordReceptions (Ptr<NetDevice> device, uint32_t index, std::vector<Reception> *received, bool mac = false)
+{
+  if (mac)
+    {
+      device->TraceConnectWithoutContext ("MacRx", MakeBoundCallback (&MacRxSink, received, index));
+    }
+  else
+    {
+      device->TraceConnectWithoutContext ("PhyRxBegin", MakeBoundCallback (&PhyRxBeginSink, received, index));
+    }
+}
+
+/**
+ * \return the sizes of the packets received, in order
+ */
+static std::vector<uint32_t>
+GetSizes (const std::vector<Reception> &received)
+{
+  std::vector<uint32_t> sizes;
+  for (std::size_t i = 0; i < received.size (); i++)
+    {
+      sizes.push_back (received[i].size);
+    }
+  return sizes;
+}
+
+/**
+ * Add the current time to txTimes, from the PhyTxBegin trace of a device
+ */
+static void
+RecordTransmission (std::vector<Time> *txTimes, Ptr<const Packet> p, Mac48Address from, Mac48Address to, uint16_t proto)
+{
+  txTimes->push_back (Simulator::Now ());
+}
+
+/**
+ * Count the packets of a trace such as MacTxDrop
+ */
+static void
+CountPackets (uint32_t *count, Ptr<const Packet> p)
+{
+  (*count)++;
+}
+
+/**
+ * Send a packet of the given size, for use with Simulator::Schedule
+ */
+static void
+SendPacket (Ptr<NetDevice> device, Address dest, uint32_t size)
+{
+  device->Send (Create<Packet> (size), dest, 1);
+}
+
 class SimpleWirelessSnrPerMethods : public TestCase
 {
 public:
@@ -138,6 +303,2028 @@ SimpleWirelessTableModel::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (valueToCheck, 1, 1e-6, "Numbers are not equal within tolerance");
 }
 
+class SimpleWirelessPerCurve : public TestCase
+{
+public:
+  SimpleWirelessPerCurve ();
+  virtual ~SimpleWirelessPerCurve ();
+
+private:
+  virtual void DoRun (void);
+  static double LinearScan (const std::map<double, double> &curve, double distance);
+  void CheckCurve (Ptr<SimpleWirelessChannel> channel, const std::map<double, double> &curve);
+};
+
+SimpleWirelessPerCurve::SimpleWirelessPerCurve ()
+  : TestCase ("Check that the bucketed PER curve table matches a linear scan of the curve")
+{
+}
+
+SimpleWirelessPerCurve::~SimpleWirelessPerCurve ()
+{
+}
+
+// The lookup of the PER curve before it was bucketed. Distances before the
+// first point get the error rate of the first point.
+double
+SimpleWirelessPerCurve::LinearScan (const std::map<double, double> &curve, double distance)
+{
+  if (curve.empty () || distance > curve.rbegin ()->first)
+    {
+      return 1.0;
+    }
+  std::map<double, double>::const_iterator it = curve.find (distance);
+  if (it != curve.end ())
+    {
+      return it->second;
+    }
+  std::map<double, double>::const_iterator up_iter = curve.upper_bound (distance);
+  if (up_iter == curve.begin ())
+    {
+      return up_iter->second;
+    }
+  std::map<double, double>::const_iterator low_iter = up_iter;
+  --low_iter;
+  return low_iter->second + ( ((distance - low_iter->first) / (up_iter->first - low_iter->first)) * (up_iter->second - low_iter->second));
+}
+
+void
+SimpleWirelessPerCurve::CheckCurve (Ptr<SimpleWirelessChannel> channel, const std::map<double, double> &curve)
+{
+  // The breakpoints, points between them, before the first and beyond
+  // the last
+  std::vector<double> distances;
+  for (std::map<double, double>::const_iterator it = curve.begin (); it != curve.end (); ++it)
+    {
+      distances.push_back (it->first);
+    }
+  distances.push_back (-5);
+  distances.push_back (1e6);
+  for (double d = -10.25; d < 120; d += 0.5)
+    {
+      distances.push_back (d);
+    }
+
+  std::vector<double> rates (distances.size ());
+  channel->GetPerCurveErrorRates (distances.data (), rates.data (), distances.size ());
+  for (std::size_t k = 0; k < distances.size (); k++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (rates[k], LinearScan (curve, distances[k]), "Error rate differs at distance " << distances[k]);
+      double rate;
+      channel->GetPerCurveErrorRates (&distances[k], &rate, 1);
+      NS_TEST_ASSERT_MSG_EQ (rate, rates[k], "Single lookup differs from the batch at distance " << distances[k]);
+    }
+}
+
+void
+SimpleWirelessPerCurve::DoRun (void)
+{
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->setErrorModelType (PER_CURVE);
+  std::map<double, double> curve;
+
+  // One point: its rate up to its distance, 1 beyond
+  curve[20] = 0.05;
+  channel->addToPERmodel (20, 0.05);
+  CheckCurve (channel, curve);
+
+  // Unevenly spaced points, some closer than a bucket
+  double points[][2] = {{0, 0}, {10, 0}, {30, 0.007}, {30.1, 0.05}, {31, 0.1}, {50, 0.4}, {65, 0.7}, {100, 0.9}};
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      curve[points[i][0]] = points[i][1];
+      channel->addToPERmodel (points[i][0], points[i][1]);
+    }
+  CheckCurve (channel, curve);
+
+  // A point added after a lookup rebuilds the table
+  curve[110] = 1;
+  channel->addToPERmodel (110, 1);
+  CheckCurve (channel, curve);
+
+  double rate;
+  double distance = 105;
+  channel->GetPerCurveErrorRates (&distance, &rate, 1);
+  NS_TEST_ASSERT_MSG_EQ_TOL (rate, 0.95, 1e-9, "Error rate between breakpoints");
+  distance = -1;
+  channel->GetPerCurveErrorRates (&distance, &rate, 1);
+  NS_TEST_ASSERT_MSG_EQ (rate, 0, "Error rate before the first point");
+  distance = 110.5;
+  channel->GetPerCurveErrorRates (&distance, &rate, 1);
+  NS_TEST_ASSERT_MSG_EQ (rate, 1, "Error rate beyond the last point");
+}
+
+class SimpleWirelessStochastic : public TestCase
+{
+public:
+  SimpleWirelessStochastic ();
+  virtual ~SimpleWirelessStochastic ();
+
+private:
+  virtual void DoRun (void);
+  std::vector<bool> RunScenario (bool sparse, bool lazy, Time up, Time down, Time interval, uint32_t samples);
+  static void Sample (Ptr<SimpleWirelessChannel> channel, std::vector<uint32_t> ids, std::vector<bool> *drops);
+};
+
+SimpleWirelessStochastic::SimpleWirelessStochastic ()
+  : TestCase ("Check the stochastic link model and that sparse link storage draws the same drops as the table")
+{
+}
+
+SimpleWirelessStochastic::~SimpleWirelessStochastic ()
+{
+}
+
+void
+SimpleWirelessStochastic::Sample (Ptr<SimpleWirelessChannel> channel, std::vector<uint32_t> ids, std::vector<bool> *drops)
+{
+  for (uint32_t src : ids)
+    {
+      for (uint32_t dst : ids)
+        {
+          if (src != dst)
+            {
+              drops->push_back (channel->CheckStochasticError (src, dst));
+            }
+        }
+    }
+}
+
+// Check the state of every link, from time 0 every interval
+std::vector<bool>
+SimpleWirelessStochastic::RunScenario (bool sparse, bool lazy, Time up, Time down, Time interval, uint32_t samples)
+{
+  std::vector<bool> drops;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->setErrorModelType (STOCHASTIC);
+  channel->SetAttribute ("AvgLinkUpDuration", TimeValue (up));
+  channel->SetAttribute ("AvgLinkDownDuration", TimeValue (down));
+  channel->SetAttribute ("StochasticSparseLinks", BooleanValue (sparse));
+  channel->SetAttribute ("StochasticLazyLinks", BooleanValue (lazy));
+  channel->AssignStreams (1);
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (6, 10));
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      ids.push_back (devices[i]->GetNode ()->GetId ());
+    }
+  channel->InitStochasticModel ();
+
+  for (uint32_t i = 0; i < samples; i++)
+    {
+      Simulator::Schedule (i * interval, &SimpleWirelessStochastic::Sample, channel, ids, &drops);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return drops;
+}
+
+void
+SimpleWirelessStochastic::DoRun (void)
+{
+  // 6 nodes, 30 links
+  for (uint32_t lazy = 0; lazy < 2; lazy++)
+    {
+      std::vector<bool> dense = RunScenario (false, lazy, MilliSeconds (1), MicroSeconds (500), MicroSeconds (200), 500);
+      std::vector<bool> sparse = RunScenario (true, lazy, MilliSeconds (1), MicroSeconds (500), MicroSeconds (200), 500);
+      NS_TEST_ASSERT_MSG_EQ (dense.size (), 30 * 500, "Unexpected number of link checks");
+      NS_TEST_ASSERT_MSG_EQ ((dense == sparse), true, "Sparse links changed the drop pattern, lazy " << lazy);
+      // All links start ON; about a third of the later checks fail
+      NS_TEST_ASSERT_MSG_EQ (std::count (dense.begin (), dense.begin () + 30, true), 0, "A link was down at the start");
+      NS_TEST_ASSERT_MSG_GT (std::count (dense.begin (), dense.end (), true), 30 * 500 / 5, "Too few drops");
+      NS_TEST_ASSERT_MSG_LT (std::count (dense.begin (), dense.end (), true), 30 * 500 / 2, "Too many drops");
+
+      // Links that go down after about 10 us and stay down
+      std::vector<bool> down = RunScenario (lazy, lazy, MicroSeconds (10), Seconds (1000), MilliSeconds (1), 2);
+      NS_TEST_ASSERT_MSG_EQ (std::count (down.begin (), down.begin () + 30, true), 0, "A link was down at the start");
+      NS_TEST_ASSERT_MSG_EQ (std::count (down.begin () + 30, down.end (), true), 30, "A link was still up after 1 ms");
+
+      // Links that stay up
+      std::vector<bool> up = RunScenario (lazy, lazy, Seconds (1000000), MicroSeconds (1), Seconds (1), 2);
+      NS_TEST_ASSERT_MSG_EQ (std::count (up.begin (), up.end (), true), 0, "A link went down");
+    }
+}
+
+class SimpleWirelessStochasticCatchUp : public TestCase
+{
+public:
+  SimpleWirelessStochasticCatchUp ();
+  virtual ~SimpleWirelessStochasticCatchUp ();
+
+private:
+  virtual void DoRun (void);
+  double RunScenario (bool catchUp);
+  static void Sample (Ptr<SimpleWirelessChannel> channel, uint32_t src, uint32_t dst, uint32_t *up);
+};
+
+SimpleWirelessStochasticCatchUp::SimpleWirelessStochasticCatchUp ()
+  : TestCase ("Check that StochasticCatchUp gives idle links the same ON probability as replaying every period")
+{
+}
+
+SimpleWirelessStochasticCatchUp::~SimpleWirelessStochasticCatchUp ()
+{
+}
+
+void
+SimpleWirelessStochasticCatchUp::Sample (Ptr<SimpleWirelessChannel> channel, uint32_t src, uint32_t dst, uint32_t *up)
+{
+  if (!channel->CheckStochasticError (src, dst))
+    {
+      (*up)++;
+    }
+}
+
+// Fraction of the checks of two links, each after 25 mean ON/OFF cycles
+// idle, that found the link ON
+double
+SimpleWirelessStochasticCatchUp::RunScenario (bool catchUp)
+{
+  uint32_t up = 0;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->setErrorModelType (STOCHASTIC);
+  channel->SetAttribute ("AvgLinkUpDuration", TimeValue (MicroSeconds (300)));
+  channel->SetAttribute ("AvgLinkDownDuration", TimeValue (MicroSeconds (100)));
+  channel->SetAttribute ("StochasticCatchUp", BooleanValue (catchUp));
+  channel->AssignStreams (1);
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (2, 10));
+  uint32_t a = devices[0]->GetNode ()->GetId ();
+  uint32_t b = devices[1]->GetNode ()->GetId ();
+  channel->InitStochasticModel ();
+
+  for (uint32_t i = 1; i <= 2000; i++)
+    {
+      Simulator::Schedule (i * MilliSeconds (10), &SimpleWirelessStochasticCatchUp::Sample, channel, a, b, &up);
+      Simulator::Schedule (i * MilliSeconds (10), &SimpleWirelessStochasticCatchUp::Sample, channel, b, a, &up);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return up / 4000.0;
+}
+
+void
+SimpleWirelessStochasticCatchUp::DoRun (void)
+{
+  // up / (up + down) = 0.75; the standard deviation of a fraction of 4000
+  // independent checks is about 0.007
+  double replay = RunScenario (false);
+  double catchUp = RunScenario (true);
+  NS_TEST_ASSERT_MSG_EQ_TOL (replay, 0.75, 0.035, "ON fraction of the exact replay");
+  NS_TEST_ASSERT_MSG_EQ_TOL (catchUp, 0.75, 0.035, "ON fraction with StochasticCatchUp");
+  NS_TEST_ASSERT_MSG_EQ_TOL (catchUp, replay, 0.05, "StochasticCatchUp disagrees with the exact replay");
+}
+
+class SimpleWirelessSpatialIndex : public TestCase
+{
+public:
+  SimpleWirelessSpatialIndex ();
+  virtual ~SimpleWirelessSpatialIndex ();
+
+private:
+  virtual void DoRun (void);
+  std::vector<Reception> RunScenario (bool spatialIndex, bool linkCache, bool kernels, bool specialized);
+};
+
+SimpleWirelessSpatialIndex::SimpleWirelessSpatialIndex ()
+  : TestCase ("Check that the channel spatial index, link cache, geometry kernels and specialized send deliver to the same devices as the generic full scan")
+{
+}
+
+SimpleWirelessSpatialIndex::~SimpleWirelessSpatialIndex ()
+{
+}
+
+std::vector<Reception>
+SimpleWirelessSpatialIndex::RunScenario (bool spatialIndex, bool linkCache, bool kernels, bool specialized)
+{
+  std::vector<Reception> received;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  channel->SetAttribute ("EnableSpecializedSend", BooleanValue (specialized));
+  channel->AddPropagationLossModel (CreateObject<FriisPropagationLossModel> ());
+  if (spatialIndex)
+    {
+      channel->EnableSpatialIndex ();
+    }
+  if (linkCache)
+    {
+      channel->EnableLinkCache ();
+    }
+  if (kernels)
+    {
+      channel->EnableGeometryKernels ();
+    }
+
+  // 20 nodes on a line, 30 m apart; node 0 reaches nodes 1 to 3
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (20, 30));
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      RecordReceptions (devices[i], i, &received);
+    }
+
+  Simulator::Schedule (Seconds (1), &SendPacket, devices[0], devices[0]->GetBroadcast (), 100);
+  // Move the last node next to node 0; the index and the link cache must
+  // follow the course change
+  Ptr<MobilityModel> last = devices[19]->GetNode ()->GetObject<MobilityModel> ();
+  Simulator::Schedule (Seconds (2), &MobilityModel::SetPosition, last, Vector (50, 0, 0));
+  Simulator::Schedule (Seconds (3), &SendPacket, devices[0], devices[0]->GetBroadcast (), 100);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return received;
+}
+
+void
+SimpleWirelessSpatialIndex::DoRun (void)
+{
+  std::vector<Reception> linear = RunScenario (false, false, false, false);
+  NS_TEST_ASSERT_MSG_EQ (linear.size (), 7, "Unexpected number of receptions with the full scan");
+  for (uint32_t mode = 1; mode < 16; mode++)
+    {
+      std::vector<Reception> other = RunScenario (mode & 1, mode & 2, mode & 4, mode & 8);
+      NS_TEST_ASSERT_MSG_EQ (other.size (), linear.size (), "Number of receptions changed in mode " << mode);
+      for (std::size_t i = 0; i < linear.size () && i < other.size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (other[i].device, linear[i].device, "Receivers or their order changed in mode " << mode);
+        }
+    }
+}
+
+class SimpleWirelessNodeDevices : public TestCase
+{
+public:
+  SimpleWirelessNodeDevices ();
+  virtual ~SimpleWirelessNodeDevices ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enable the fixed neighbor list and a queue on a device, and record
+   * its receptions with the given index
+   */
+  static void Configure (Ptr<SimpleWirelessNetDevice> device, uint32_t index, std::vector<Reception> *received);
+  /**
+   * Add a node at 30 m, after the first send, and make it a directional
+   * neighbor of the sender
+   */
+  static void AddNeighbor (Ptr<SimpleWirelessChannel> channel, std::vector<Ptr<SimpleWirelessNetDevice> > *devices, std::vector<Reception> *received);
+  static void SendTo (std::vector<Ptr<SimpleWirelessNetDevice> > *devices, uint32_t i);
+};
+
+SimpleWirelessNodeDevices::SimpleWirelessNodeDevices ()
+  : TestCase ("Check that a directional unicast only reaches the device of its destination node, including a device added later")
+{
+}
+
+SimpleWirelessNodeDevices::~SimpleWirelessNodeDevices ()
+{
+}
+
+void
+SimpleWirelessNodeDevices::Configure (Ptr<SimpleWirelessNetDevice> device, uint32_t index, std::vector<Reception> *received)
+{
+  device->SetAttribute ("FixedNeighborListEnabled", BooleanValue (true));
+  device->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+  RecordReceptions (device, index, received);
+}
+
+void
+SimpleWirelessNodeDevices::AddNeighbor (Ptr<SimpleWirelessChannel> channel, std::vector<Ptr<SimpleWirelessNetDevice> > *devices, std::vector<Reception> *received)
+{
+  Ptr<SimpleWirelessNetDevice> device = CreateDevice (channel, CreateNode (Vector (30, 0, 0)));
+  Configure (device, devices->size (), received);
+  devices->push_back (device);
+  (*devices)[0]->AddDirectionalNeighbor (device->GetNode ()->GetId (), Mac48Address::ConvertFrom (device->GetAddress ()));
+}
+
+void
+SimpleWirelessNodeDevices::SendTo (std::vector<Ptr<SimpleWirelessNetDevice> > *devices, uint32_t i)
+{
+  SendPacket ((*devices)[0], (*devices)[i]->GetAddress (), 100);
+}
+
+void
+SimpleWirelessNodeDevices::DoRun (void)
+{
+  std::vector<Reception> received;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  channel->EnableSpatialIndex ();
+
+  // Node 0 with directional neighbors 1 to 3, all within range
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (4, 20));
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Configure (devices[i], i, &received);
+    }
+  for (uint32_t i = 1; i < 4; i++)
+    {
+      devices[0]->AddDirectionalNeighbor (devices[i]->GetNode ()->GetId (), Mac48Address::ConvertFrom (devices[i]->GetAddress ()));
+    }
+
+  // The channel builds its node to device index on the first send, and
+  // must rebuild it once node 4 is added
+  Simulator::Schedule (Seconds (1), &SimpleWirelessNodeDevices::SendTo, &devices, 2);
+  Simulator::Schedule (Seconds (2), &SimpleWirelessNodeDevices::AddNeighbor, channel, &devices, &received);
+  Simulator::Schedule (Seconds (3), &SimpleWirelessNodeDevices::SendTo, &devices, 4);
+  Simulator::Schedule (Seconds (4), &SimpleWirelessNodeDevices::SendTo, &devices, 1);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (devices.size (), 5, "Node 4 not added");
+  NS_TEST_ASSERT_MSG_EQ (received.size (), 3, "Unexpected number of directional unicast receptions");
+  uint32_t expected[] = {2, 4, 1};
+  for (std::size_t i = 0; i < received.size () && i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (received[i].device, expected[i], "Unicast not received by exactly its destination");
+    }
+}
+
+class SimpleWirelessBatchDelivery : public TestCase
+{
+public:
+  SimpleWirelessBatchDelivery ();
+  virtual ~SimpleWirelessBatchDelivery ();
+
+private:
+  virtual void DoRun (void);
+  std::vector<Reception> RunScenario (bool batch, Time resolution);
+  static void CheckContext (uint32_t *wrongContext, uint32_t nodeId, Ptr<const Packet> p, double rxPower, Mac48Address from);
+
+  uint32_t m_wrongContext;
+};
+
+SimpleWirelessBatchDelivery::SimpleWirelessBatchDelivery ()
+  : TestCase ("Check that batched delivery keeps the receivers, their order and arrival times")
+{
+}
+
+SimpleWirelessBatchDelivery::~SimpleWirelessBatchDelivery ()
+{
+}
+
+void
+SimpleWirelessBatchDelivery::CheckContext (uint32_t *wrongContext, uint32_t nodeId, Ptr<const Packet> p, double rxPower, Mac48Address from)
+{
+  if (Simulator::GetContext () != nodeId)
+    {
+      (*wrongContext)++;
+    }
+}
+
+std::vector<Reception>
+SimpleWirelessBatchDelivery::RunScenario (bool batch, Time resolution)
+{
+  std::vector<Reception> received;
+  m_wrongContext = 0;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  channel->SetAttribute ("BatchDeliveryResolution", TimeValue (resolution));
+  if (batch)
+    {
+      channel->EnableBatchDelivery ();
+    }
+
+  // Sender at the origin with pairs of receivers at the same distance
+  double x[] = { 0, 30, -30, 60, -60 };
+  std::vector<Vector> positions;
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      positions.push_back (Vector (x[i], 0, 0));
+    }
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, positions);
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      RecordReceptions (devices[i], i, &received);
+      devices[i]->TraceConnectWithoutContext ("PhyRxBegin", MakeBoundCallback (&SimpleWirelessBatchDelivery::CheckContext, &m_wrongContext, devices[i]->GetNode ()->GetId ()));
+    }
+
+  Simulator::Schedule (Seconds (1), &SendPacket, devices[0], devices[0]->GetBroadcast (), 100);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return received;
+}
+
+void
+SimpleWirelessBatchDelivery::DoRun (void)
+{
+  std::vector<Reception> single = RunScenario (false, Seconds (0));
+  std::vector<Reception> batched = RunScenario (true, Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ (single.size (), 4, "Unexpected number of receptions");
+  NS_TEST_ASSERT_MSG_EQ (batched.size (), single.size (), "Number of receptions changed with batched delivery");
+  for (std::size_t i = 0; i < single.size () && i < batched.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (batched[i].device, single[i].device, "Receiver order changed with batched delivery");
+      NS_TEST_ASSERT_MSG_EQ (batched[i].time, single[i].time, "Arrival time changed with batched delivery");
+    }
+
+  // With a 1 us resolution the propagation delays round to 0, so all
+  // receivers get the packet at the end of the transmission
+  std::vector<Reception> rounded = RunScenario (true, MicroSeconds (1));
+  NS_TEST_ASSERT_MSG_EQ (rounded.size (), single.size (), "Number of receptions changed with rounded delays");
+  for (std::size_t i = 0; i < rounded.size () && i < single.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (rounded[i].device, single[i].device, "Receiver order changed with rounded delays");
+      NS_TEST_ASSERT_MSG_EQ (rounded[i].time, rounded[0].time, "Rounded arrival times differ");
+    }
+  // Even when they share an arrival time, each receiver gets the packet
+  // in the context of its own node
+  NS_TEST_ASSERT_MSG_EQ (m_wrongContext, 0, "Packet received in the context of another node");
+}
+
+class SimpleWirelessDescriptorQueue : public TestCase
+{
+public:
+  SimpleWirelessDescriptorQueue ();
+  virtual ~SimpleWirelessDescriptorQueue ();
+
+private:
+  virtual void DoRun (void);
+  std::vector<Reception> RunScenario (bool descriptors, uint32_t ringSize, uint32_t *drops);
+  std::vector<Reception> RunDirectional (bool descriptors);
+  static void SendBurst (Ptr<SimpleWirelessNetDevice> device, Address dest);
+  static void SendBurstAndResize (Ptr<SimpleWirelessNetDevice> device, Address dest);
+};
+
+SimpleWirelessDescriptorQueue::SimpleWirelessDescriptorQueue ()
+  : TestCase ("Check that the descriptor queue sends the same packets at the same times as a packet queue")
+{
+}
+
+SimpleWirelessDescriptorQueue::~SimpleWirelessDescriptorQueue ()
+{
+}
+
+void
+SimpleWirelessDescriptorQueue::SendBurst (Ptr<SimpleWirelessNetDevice> device, Address dest)
+{
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      SendPacket (device, dest, 100 + i);
+    }
+}
+
+// Queue two packets behind the one sent, then shrink the queue to them:
+// the next packet is dropped. Grow it by one: the next is queued.
+void
+SimpleWirelessDescriptorQueue::SendBurstAndResize (Ptr<SimpleWirelessNetDevice> device, Address dest)
+{
+  SendBurst (device, dest);
+  device->SetAttribute ("TxDescriptorQueueSize", UintegerValue (2));
+  SendPacket (device, dest, 200);
+  device->SetAttribute ("TxDescriptorQueueSize", UintegerValue (3));
+  SendPacket (device, dest, 201);
+}
+
+std::vector<Reception>
+SimpleWirelessDescriptorQueue::RunScenario (bool descriptors, uint32_t ringSize, uint32_t *drops)
+{
+  std::vector<Reception> received;
+  *drops = 0;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (2, 30));
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      if (descriptors)
+        {
+          devices[i]->SetAttribute ("TxDescriptorQueue", BooleanValue (true));
+          if (ringSize > 0)
+            {
+              devices[i]->SetAttribute ("TxDescriptorQueueSize", UintegerValue (ringSize));
+            }
+        }
+      else
+        {
+          devices[i]->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+        }
+    }
+  RecordReceptions (devices[1], 1, &received);
+  devices[0]->TraceConnectWithoutContext ("MacTxDrop", MakeBoundCallback (&CountPackets, drops));
+
+  if (ringSize == 0 && descriptors)
+    {
+      Simulator::Schedule (Seconds (1), &SimpleWirelessDescriptorQueue::SendBurstAndResize, devices[0], devices[1]->GetAddress ());
+    }
+  else
+    {
+      Simulator::Schedule (Seconds (1), &SimpleWirelessDescriptorQueue::SendBurst, devices[0], devices[1]->GetAddress ());
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return received;
+}
+
+std::vector<Reception>
+SimpleWirelessDescriptorQueue::RunDirectional (bool descriptors)
+{
+  std::vector<Reception> received;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  // Node 0 with directional neighbors 1 to 3, all within range
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (4, 20));
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      devices[i]->SetAttribute ("FixedNeighborListEnabled", BooleanValue (true));
+      if (descriptors)
+        {
+          devices[i]->SetAttribute ("TxDescriptorQueue", BooleanValue (true));
+        }
+      else
+        {
+          devices[i]->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+        }
+      RecordReceptions (devices[i], i, &received);
+    }
+  for (uint32_t i = 1; i < 4; i++)
+    {
+      devices[0]->AddDirectionalNeighbor (devices[i]->GetNode ()->GetId (), Mac48Address::ConvertFrom (devices[i]->GetAddress ()));
+    }
+
+  Simulator::Schedule (Seconds (1), &SimpleWirelessDescriptorQueue::SendBurst, devices[0], devices[0]->GetBroadcast ());
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return received;
+}
+
+void
+SimpleWirelessDescriptorQueue::DoRun (void)
+{
+  uint32_t drops;
+  std::vector<Reception> queued = RunScenario (false, 0, &drops);
+  NS_TEST_ASSERT_MSG_EQ (queued.size (), 3, "Unexpected number of receptions with a packet queue");
+  std::vector<Reception> described = RunScenario (true, 100, &drops);
+  NS_TEST_ASSERT_MSG_EQ (described.size (), queued.size (), "Number of receptions changed with the descriptor queue");
+  NS_TEST_ASSERT_MSG_EQ (drops, 0, "Unexpected drops from the descriptor queue");
+  for (std::size_t i = 0; i < queued.size () && i < described.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (described[i].size, queued[i].size, "Packet size changed with the descriptor queue");
+      NS_TEST_ASSERT_MSG_EQ (described[i].time, queued[i].time, "Arrival time changed with the descriptor queue");
+    }
+
+  // The first packet is sent right away, the second waits and the third
+  // does not fit
+  std::vector<Reception> full = RunScenario (true, 1, &drops);
+  NS_TEST_ASSERT_MSG_EQ (full.size (), 2, "Unexpected number of receptions with a full descriptor queue");
+  NS_TEST_ASSERT_MSG_EQ (drops, 1, "Unexpected number of drops with a full descriptor queue");
+
+  // TxDescriptorQueueSize changed with packets queued (ring size 0 runs
+  // SendBurstAndResize)
+  std::vector<Reception> resized = RunScenario (true, 0, &drops);
+  NS_TEST_ASSERT_MSG_EQ (resized.size (), 4, "Unexpected number of receptions after resizing the descriptor queue");
+  NS_TEST_ASSERT_MSG_EQ (drops, 1, "Unexpected number of drops after resizing the descriptor queue");
+  uint32_t sizes[] = {100, 101, 102, 201};
+  for (std::size_t i = 0; i < resized.size () && i < 4; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (resized[i].size - resized[0].size, sizes[i] - sizes[0], "Packet order changed by resizing the descriptor queue");
+    }
+
+  // A directional broadcast is sent to each neighbor in turn, whether it
+  // is queued as one copy per neighbor or as one fan-out descriptor
+  std::vector<Reception> copies = RunDirectional (false);
+  std::vector<Reception> fanOut = RunDirectional (true);
+  NS_TEST_ASSERT_MSG_EQ (copies.size (), 9, "Unexpected number of directional receptions");
+  NS_TEST_ASSERT_MSG_EQ (fanOut.size (), copies.size (), "Number of directional receptions changed with fan-out");
+  for (std::size_t i = 0; i < copies.size () && i < fanOut.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (fanOut[i].device, copies[i].device, "Receiver order changed with fan-out");
+      NS_TEST_ASSERT_MSG_EQ (fanOut[i].time, copies[i].time, "Arrival time changed with fan-out");
+    }
+}
+
+class SimpleWirelessDirectionalNeighbors : public TestCase
+{
+public:
+  SimpleWirelessDirectionalNeighbors ();
+  virtual ~SimpleWirelessDirectionalNeighbors ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SimpleWirelessDirectionalNeighbors::SimpleWirelessDirectionalNeighbors ()
+  : TestCase ("Check directional unicast lookup after adding, deleting and replacing neighbors")
+{
+}
+
+SimpleWirelessDirectionalNeighbors::~SimpleWirelessDirectionalNeighbors ()
+{
+}
+
+void
+SimpleWirelessDirectionalNeighbors::DoRun (void)
+{
+  std::vector<Reception> received;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (4, 20));
+  std::vector<Mac48Address> macs;
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      devices[i]->SetAttribute ("FixedNeighborListEnabled", BooleanValue (true));
+      RecordReceptions (devices[i], i, &received);
+      macs.push_back (Mac48Address::ConvertFrom (devices[i]->GetAddress ()));
+      ids.push_back (devices[i]->GetNode ()->GetId ());
+    }
+
+  devices[0]->AddDirectionalNeighbor (ids[1], macs[1]);
+  devices[0]->AddDirectionalNeighbor (ids[2], macs[2]);
+  devices[0]->DeleteDirectionalNeighbor (ids[1]);
+  std::map<uint32_t, Mac48Address> replacement;
+  replacement[ids[3]] = macs[3];
+
+  // node 2 is a neighbor, node 1 was deleted; then the list is replaced
+  // by node 3 alone
+  Simulator::Schedule (Seconds (1), &SendPacket, devices[0], devices[2]->GetAddress (), 100);
+  Simulator::Schedule (Seconds (2), &SendPacket, devices[0], devices[1]->GetAddress (), 100);
+  Simulator::Schedule (Seconds (3), &SimpleWirelessNetDevice::SetDirectionalNeighbors, devices[0], replacement);
+  Simulator::Schedule (Seconds (4), &SendPacket, devices[0], devices[2]->GetAddress (), 100);
+  Simulator::Schedule (Seconds (5), &SendPacket, devices[0], devices[3]->GetAddress (), 100);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (received.size (), 2, "Unexpected number of directional unicast receptions");
+  if (received.size () == 2)
+    {
+      NS_TEST_ASSERT_MSG_EQ (received[0].device, 2, "Unicast to a directional neighbor not received by it");
+      NS_TEST_ASSERT_MSG_EQ (received[1].device, 3, "Unicast to a replacement neighbor not received by it");
+    }
+}
+
+class SimpleWirelessSlottedAloha : public TestCase
+{
+public:
+  SimpleWirelessSlottedAloha ();
+  virtual ~SimpleWirelessSlottedAloha ();
+
+private:
+  virtual void DoRun (void);
+  void RunScenario (const std::vector<std::pair<uint32_t, Time> > &sends, std::vector<Time> *txTimes, uint32_t *receptions,
+                    bool capture = false, double txPower2 = 16);
+};
+
+SimpleWirelessSlottedAloha::SimpleWirelessSlottedAloha ()
+  : TestCase ("Check that slotted aloha frames start at slot boundaries and collide at the receiver")
+{
+}
+
+SimpleWirelessSlottedAloha::~SimpleWirelessSlottedAloha ()
+{
+}
+
+void
+SimpleWirelessSlottedAloha::RunScenario (const std::vector<std::pair<uint32_t, Time> > &sends, std::vector<Time> *txTimes, uint32_t *receptions,
+                                         bool capture, double txPower2)
+{
+  txTimes->clear ();
+  std::vector<Reception> received;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  channel->SetAttribute ("SlotDuration", TimeValue (MilliSeconds (1)));
+
+  // a sink (device 0) and two stations; a frame takes half a slot
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (3, 10));
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      devices[i]->SetDataRate (DataRate ("16Mbps"));
+      devices[i]->SetAttribute ("SlottedAloha", BooleanValue (true));
+      devices[i]->SetAttribute ("SlottedAlohaCapture", BooleanValue (capture));
+      if (i == 2)
+        {
+          devices[i]->SetAttribute ("TxPower", DoubleValue (txPower2));
+        }
+      devices[i]->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+      devices[i]->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&RecordTransmission, txTimes));
+    }
+  RecordReceptions (devices[0], 0, &received);
+
+  for (std::size_t i = 0; i < sends.size (); i++)
+    {
+      Ptr<SimpleWirelessNetDevice> device = devices[sends[i].first];
+      Simulator::Schedule (sends[i].second, &SendPacket, device, device->GetBroadcast (), 1000);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  *receptions = received.size ();
+}
+
+void
+SimpleWirelessSlottedAloha::DoRun (void)
+{
+  std::vector<Time> txTimes;
+  uint32_t receptions;
+
+  // Two frames queued by one station go in two consecutive slots, even
+  // though the first one ends half way through its slot
+  std::vector<std::pair<uint32_t, Time> > sends;
+  sends.push_back (std::make_pair (1, MicroSeconds (1000300)));
+  sends.push_back (std::make_pair (1, MicroSeconds (1000300)));
+  RunScenario (sends, &txTimes, &receptions);
+  NS_TEST_ASSERT_MSG_EQ (txTimes.size (), 2, "Unexpected number of transmissions");
+  if (txTimes.size () == 2)
+    {
+      NS_TEST_ASSERT_MSG_EQ (txTimes[0], MilliSeconds (1001), "First frame not sent at the next slot");
+      NS_TEST_ASSERT_MSG_EQ (txTimes[1], MilliSeconds (1002), "Second frame not sent at the following slot");
+    }
+  NS_TEST_ASSERT_MSG_EQ (receptions, 2, "Frames in separate slots not received");
+
+  // Frames from two stations queued in the same slot collide
+  sends.clear ();
+  sends.push_back (std::make_pair (1, MicroSeconds (1000200)));
+  sends.push_back (std::make_pair (2, MicroSeconds (1000500)));
+  RunScenario (sends, &txTimes, &receptions);
+  NS_TEST_ASSERT_MSG_EQ (txTimes.size (), 2, "Unexpected number of transmissions");
+  if (txTimes.size () == 2)
+    {
+      NS_TEST_ASSERT_MSG_EQ (txTimes[0], txTimes[1], "Frames of the same slot not sent together");
+    }
+  NS_TEST_ASSERT_MSG_EQ (receptions, 0, "Colliding frames received");
+
+  // Without a loss model the frames arrive at their transmit power. A
+  // frame 16 dB above the other is lost without capture, and captured
+  // with the default 10 dB threshold; at 6 dB above it is lost either way
+  RunScenario (sends, &txTimes, &receptions, false, 0);
+  NS_TEST_ASSERT_MSG_EQ (receptions, 0, "Colliding frames received without capture");
+  RunScenario (sends, &txTimes, &receptions, true, 0);
+  NS_TEST_ASSERT_MSG_EQ (receptions, 1, "Strongest frame not captured");
+  RunScenario (sends, &txTimes, &receptions, true, 10);
+  NS_TEST_ASSERT_MSG_EQ (receptions, 0, "Frame captured below the threshold");
+}
+
+class SimpleWirelessDcf : public TestCase
+{
+public:
+  SimpleWirelessDcf ();
+  virtual ~SimpleWirelessDcf ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Run an access point (device 0) and nStations stations, spacing
+   * meters apart on a line, sending 1000 byte unicast frames to it at the
+   * given (station, time) pairs
+   */
+  void RunScenario (uint32_t nStations, const std::vector<std::pair<uint32_t, Time> > &sends,
+                    uint32_t cwMin, uint32_t retryLimit, double spacing = 10);
+
+  std::vector<Time> m_txTimes;
+  std::vector<Reception> m_received;
+  uint32_t m_acked;
+  uint32_t m_dropped;
+};
+
+SimpleWirelessDcf::SimpleWirelessDcf ()
+  : TestCase ("Check the DCF backoff, acknowledgments, collisions and retry limit")
+{
+}
+
+SimpleWirelessDcf::~SimpleWirelessDcf ()
+{
+}
+
+void
+SimpleWirelessDcf::RunScenario (uint32_t nStations, const std::vector<std::pair<uint32_t, Time> > &sends,
+                                uint32_t cwMin, uint32_t retryLimit, double spacing)
+{
+  m_txTimes.clear ();
+  m_received.clear ();
+  m_acked = 0;
+  m_dropped = 0;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (10 * spacing));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (nStations + 1, spacing));
+  for (uint32_t i = 0; i <= nStations; i++)
+    {
+      devices[i]->SetDataRate (DataRate ("16Mbps"));
+      devices[i]->SetAttribute ("Dcf", BooleanValue (true));
+      devices[i]->SetAttribute ("DcfCwMin", UintegerValue (cwMin));
+      devices[i]->SetAttribute ("DcfCwMax", UintegerValue (cwMin));
+      devices[i]->SetAttribute ("DcfRetryLimit", UintegerValue (retryLimit));
+      devices[i]->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+      devices[i]->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&RecordTransmission, &m_txTimes));
+      devices[i]->TraceConnectWithoutContext ("MacTxDrop", MakeBoundCallback (&CountPackets, &m_dropped));
+    }
+  RecordReceptions (devices[0], 0, &m_received);
+  for (uint32_t i = 1; i <= nStations; i++)
+    {
+      devices[i]->TraceConnectWithoutContext ("DcfAccessDelay", MakeBoundCallback (&CountPackets, &m_acked));
+    }
+
+  for (std::size_t i = 0; i < sends.size (); i++)
+    {
+      Simulator::Schedule (sends[i].second, &SendPacket, devices[sends[i].first], devices[0]->GetAddress (), 1000);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+SimpleWirelessDcf::DoRun (void)
+{
+  // A frame is 20 us of PHY header and 500 us of data
+  Time frame = MicroSeconds (520);
+  Time ackEnd = frame + MicroSeconds (16 + 44);
+
+  // The first of two frames goes at once on the idle medium; the second
+  // waits for the ACK, DIFS and a backoff of at most CWmin slots
+  std::vector<std::pair<uint32_t, Time> > sends;
+  sends.push_back (std::make_pair (1, Seconds (1)));
+  sends.push_back (std::make_pair (1, Seconds (1)));
+  RunScenario (1, sends, 15, 7);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 2, "Unexpected number of transmissions");
+  if (m_txTimes.size () == 2)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_txTimes[0], Seconds (1), "First frame not sent at once");
+      Time backoff = m_txTimes[1] - m_txTimes[0] - ackEnd - MicroSeconds (34);
+      NS_TEST_ASSERT_MSG_EQ (backoff.GetNanoSeconds () % 9000, 0, "Backoff not a whole number of slots");
+      NS_TEST_ASSERT_MSG_EQ ((backoff >= Seconds (0) && backoff <= MicroSeconds (15 * 9)), true,
+                             "Backoff out of the contention window");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 2, "Frames not received");
+  NS_TEST_ASSERT_MSG_EQ (m_acked, 2, "Frames not acknowledged");
+
+  // With a contention window of zero, two stations with a frame at the
+  // same time always collide; each frame is sent 1 + 3 times and dropped
+  sends.clear ();
+  sends.push_back (std::make_pair (1, Seconds (1)));
+  sends.push_back (std::make_pair (2, Seconds (1)));
+  RunScenario (2, sends, 0, 3);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 8, "Unexpected number of transmissions");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 0, "Colliding frames received");
+  NS_TEST_ASSERT_MSG_EQ (m_acked, 0, "Colliding frames acknowledged");
+  NS_TEST_ASSERT_MSG_EQ (m_dropped, 2, "Frames not dropped at the retry limit");
+
+  // A station that senses the other one defers to it
+  sends.clear ();
+  sends.push_back (std::make_pair (1, Seconds (1)));
+  sends.push_back (std::make_pair (2, Seconds (1) + MicroSeconds (100)));
+  RunScenario (2, sends, 0, 3);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 2, "Unexpected number of transmissions");
+  if (m_txTimes.size () == 2)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((m_txTimes[1] >= m_txTimes[0] + ackEnd + MicroSeconds (34)), true,
+                             "Second station did not wait for the ACK and DIFS");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 2, "Frames not received");
+  NS_TEST_ASSERT_MSG_EQ (m_acked, 2, "Frames not acknowledged");
+
+  // Stations 5 km and 10 km away, with propagation delays of 16.5 us and
+  // 33 us, longer than a slot, get their ACKs without retries
+  sends.clear ();
+  sends.push_back (std::make_pair (1, Seconds (1)));
+  sends.push_back (std::make_pair (1, Seconds (1)));
+  sends.push_back (std::make_pair (2, Seconds (1) + MilliSeconds (10)));
+  sends.push_back (std::make_pair (2, Seconds (1) + MilliSeconds (10)));
+  RunScenario (2, sends, 15, 7, 5000);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 4, "Frames from far stations retransmitted");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 4, "Frames from far stations not received");
+  NS_TEST_ASSERT_MSG_EQ (m_acked, 4, "Frames from far stations not acknowledged");
+}
+
+class SimpleWirelessMultiQueueTest : public TestCase
+{
+public:
+  SimpleWirelessMultiQueueTest ();
+  virtual ~SimpleWirelessMultiQueueTest ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Queue a packet with the given size and socket priority
+   */
+  static void Enqueue (Ptr<SimpleWirelessMultiQueue> queue, uint32_t size, uint8_t priority);
+  /**
+   * Empty the queue, checking that Peek returns what Dequeue does
+   * \return the sub-queue of each packet, in dequeue order
+   */
+  std::vector<uint32_t> Drain (Ptr<SimpleWirelessMultiQueue> queue);
+  static void Latency (std::vector<uint32_t> *subQueues, Ptr<const Packet> p, uint32_t subQueue, Time latency);
+};
+
+SimpleWirelessMultiQueueTest::SimpleWirelessMultiQueueTest ()
+  : TestCase ("Check the strict priority, WRR and DRR schedulers of the multi-queue")
+{
+}
+
+SimpleWirelessMultiQueueTest::~SimpleWirelessMultiQueueTest ()
+{
+}
+
+void
+SimpleWirelessMultiQueueTest::Enqueue (Ptr<SimpleWirelessMultiQueue> queue, uint32_t size, uint8_t priority)
+{
+  Ptr<Packet> p = Create<Packet> (size);
+  SocketPriorityTag priorityTag;
+  priorityTag.SetPriority (priority);
+  p->AddPacketTag (priorityTag);
+  TimestampTags timestamp;
+  timestamp.SetTimestamp (Simulator::Now ());
+  p->AddPacketTag (timestamp);
+  queue->Enqueue (p);
+}
+
+void
+SimpleWirelessMultiQueueTest::Latency (std::vector<uint32_t> *subQueues, Ptr<const Packet> p, uint32_t subQueue, Time latency)
+{
+  subQueues->push_back (subQueue);
+}
+
+std::vector<uint32_t>
+SimpleWirelessMultiQueueTest::Drain (Ptr<SimpleWirelessMultiQueue> queue)
+{
+  std::vector<uint32_t> subQueues;
+  queue->TraceConnectWithoutContext ("SubQueueLatency", MakeBoundCallback (&SimpleWirelessMultiQueueTest::Latency, &subQueues));
+  while (!queue->IsEmpty ())
+    {
+      Ptr<const Packet> next = queue->Peek ();
+      Ptr<Packet> p = queue->Dequeue ();
+      NS_TEST_EXPECT_MSG_EQ (p, next, "Peek and Dequeue disagree");
+    }
+  return subQueues;
+}
+
+void
+SimpleWirelessMultiQueueTest::DoRun (void)
+{
+  // Access categories in the order VO, VI, BE, BK
+  Ptr<SimpleWirelessMultiQueue> queue = CreateObject<SimpleWirelessMultiQueue> ();
+  Enqueue (queue, 100, 0);
+  Enqueue (queue, 100, 6);
+  Enqueue (queue, 100, 1);
+  Enqueue (queue, 100, 5);
+  NS_TEST_ASSERT_MSG_EQ (queue->GetSubQueueNPackets (2), 1, "Priority 0 not in BE");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetSubQueueNBytes (0), 100, "Priority 6 not in VO");
+  std::vector<uint32_t> order = Drain (queue);
+  uint32_t strict[] = {0, 1, 2, 3};
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<uint32_t> (strict, strict + 4)), true, "Strict priority order");
+
+  // Two VO packets for each VI one
+  queue = CreateObject<SimpleWirelessMultiQueue> ();
+  queue->SetAttribute ("Scheduler", EnumValue (SimpleWirelessMultiQueue::WEIGHTED_ROUND_ROBIN));
+  queue->SetWeights (std::vector<uint32_t> {2, 1});
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Enqueue (queue, 100, 6);
+      Enqueue (queue, 100, 4);
+    }
+  order = Drain (queue);
+  uint32_t wrr[] = {0, 0, 1, 0, 0, 1, 1, 1};
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<uint32_t> (wrr, wrr + 8)), true, "Weighted round robin order");
+
+  // Equal bytes for VO packets of 1500 bytes and VI packets of 500 bytes
+  queue = CreateObject<SimpleWirelessMultiQueue> ();
+  queue->SetAttribute ("Scheduler", EnumValue (SimpleWirelessMultiQueue::DEFICIT_ROUND_ROBIN));
+  queue->SetAttribute ("Quantum", UintegerValue (1000));
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Enqueue (queue, 1500, 6);
+      Enqueue (queue, 500, 4);
+      Enqueue (queue, 500, 4);
+    }
+  order = Drain (queue);
+  uint32_t drr[] = {1, 1, 0, 1, 1, 0};
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<uint32_t> (drr, drr + 6)), true, "Deficit round robin order");
+
+  // One sub-queue per priority
+  queue = CreateObject<SimpleWirelessMultiQueue> ();
+  queue->SetAttribute ("AcMapping", BooleanValue (false));
+  Enqueue (queue, 100, 1);
+  Enqueue (queue, 100, 2);
+  order = Drain (queue);
+  uint32_t tid[] = {5, 6};
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<uint32_t> (tid, tid + 2)), true, "Priority 2 not before priority 1");
+  Simulator::Destroy ();
+}
+
+class SimpleWirelessCoDel : public TestCase
+{
+public:
+  SimpleWirelessCoDel ();
+  virtual ~SimpleWirelessCoDel ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Queue a 1000 byte packet for the given destination, as the device does
+   */
+  static void Enqueue (Ptr<SimpleWirelessCoDelQueue> queue, Mac48Address to);
+  /**
+   * Dequeue a packet, checking that Peek returns the same one
+   */
+  void Dequeue (Ptr<SimpleWirelessCoDelQueue> queue, std::vector<Mac48Address> *destinations);
+};
+
+SimpleWirelessCoDel::SimpleWirelessCoDel ()
+  : TestCase ("Check the drops of the CoDel queue and the flow scheduling of FQ-CoDel")
+{
+}
+
+SimpleWirelessCoDel::~SimpleWirelessCoDel ()
+{
+}
+
+void
+SimpleWirelessCoDel::Enqueue (Ptr<SimpleWirelessCoDelQueue> queue, Mac48Address to)
+{
+  Ptr<Packet> p = Create<Packet> (1000);
+  TimestampTags timestamp;
+  timestamp.SetTimestamp (Simulator::Now ());
+  p->AddPacketTag (timestamp);
+  EthernetHeader ethHeader;
+  ethHeader.SetSource (Mac48Address ("00:00:00:00:00:10"));
+  ethHeader.SetDestination (to);
+  ethHeader.SetLengthType (1);
+  p->AddHeader (ethHeader);
+  queue->Enqueue (p);
+}
+
+void
+SimpleWirelessCoDel::Dequeue (Ptr<SimpleWirelessCoDelQueue> queue, std::vector<Mac48Address> *destinations)
+{
+  Ptr<const Packet> next = queue->Peek ();
+  Ptr<Packet> p = queue->Dequeue ();
+  NS_TEST_EXPECT_MSG_EQ (p, next, "Peek and Dequeue disagree");
+  if (p)
+    {
+      EthernetHeader ethHeader;
+      p->PeekHeader (ethHeader);
+      destinations->push_back (ethHeader.GetDestination ());
+    }
+}
+
+void
+SimpleWirelessCoDel::DoRun (void)
+{
+  Mac48Address a ("00:00:00:00:00:01");
+  Mac48Address b ("00:00:00:00:00:02");
+  std::vector<Mac48Address> destinations;
+
+  // 50 packets queued at once and sent every 10 ms. The sojourn time is
+  // above the 5 ms target from the second packet, at 10 ms, so the first
+  // drop is at 110 ms and the second one 100 ms later
+  Ptr<SimpleWirelessCoDelQueue> queue = CreateObject<SimpleWirelessCoDelQueue> ();
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      Enqueue (queue, a);
+    }
+  for (uint32_t i = 0; i < 22; i++)
+    {
+      Simulator::Schedule (MilliSeconds (10 * i), &SimpleWirelessCoDel::Dequeue, this, queue, &destinations);
+    }
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (destinations.size (), 22, "Packets not dequeued");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetAqmDrops (), 2, "Unexpected number of CoDel drops");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetNPackets (), 26, "Dropped packets still queued");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetMaxSojourn (), MilliSeconds (210), "Wrong largest sojourn time");
+  Simulator::Destroy ();
+
+  // Without a standing queue, nothing is dropped
+  queue = CreateObject<SimpleWirelessCoDelQueue> ();
+  destinations.clear ();
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      Simulator::Schedule (MilliSeconds (10 * i), &SimpleWirelessCoDel::Enqueue, queue, a);
+      Simulator::Schedule (MilliSeconds (10 * i + 1), &SimpleWirelessCoDel::Dequeue, this, queue, &destinations);
+    }
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (destinations.size (), 50, "Packets not dequeued");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetAqmDrops (), 0, "Packets dropped without a standing queue");
+  NS_TEST_ASSERT_MSG_EQ (queue->GetMeanSojourn (), MilliSeconds (1), "Wrong mean sojourn time");
+  Simulator::Destroy ();
+
+  // A packet to a new destination gets ahead of a backlog, once the
+  // backlogged flow has used its quantum, with flow queues only
+  for (uint32_t flows = 1; flows <= 16; flows += 15)
+    {
+      queue = CreateObject<SimpleWirelessCoDelQueue> ();
+      queue->SetAttribute ("Flows", UintegerValue (flows));
+      destinations.clear ();
+      for (uint32_t i = 0; i < 20; i++)
+        {
+          Enqueue (queue, a);
+        }
+      Enqueue (queue, b);
+      for (uint32_t i = 0; i < 21; i++)
+        {
+          Dequeue (queue, &destinations);
+        }
+      std::size_t position = std::find (destinations.begin (), destinations.end (), b) - destinations.begin ();
+      NS_TEST_ASSERT_MSG_EQ (position, (flows == 1 ? 20 : 2), "Packet to the new destination at the wrong position");
+      Simulator::Destroy ();
+    }
+
+  // MinBytes applies to the backlog of each flow: the second packet to b
+  // has waited 300 ms, but is alone in its flow and is not dropped,
+  // however many packets to a are queued
+  queue = CreateObject<SimpleWirelessCoDelQueue> ();
+  queue->SetAttribute ("Flows", UintegerValue (16));
+  destinations.clear ();
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      Enqueue (queue, a);
+    }
+  Enqueue (queue, b);
+  Enqueue (queue, b);
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      Simulator::Schedule (MilliSeconds (100 * i), &SimpleWirelessCoDel::Dequeue, this, queue, &destinations);
+    }
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (std::count (destinations.begin (), destinations.end (), b), 2, "Packet of a short flow dropped");
+  Simulator::Destroy ();
+}
+
+class SimpleWirelessAggregation : public TestCase
+{
+public:
+  SimpleWirelessAggregation ();
+  virtual ~SimpleWirelessAggregation ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send five 1000 byte frames at once from one device to another, or
+   * the last two to a third device if split
+   */
+  void RunScenario (uint32_t maxPackets, uint32_t maxBytes, bool split);
+
+  std::vector<Time> m_txTimes;
+  std::vector<Reception> m_received;
+};
+
+SimpleWirelessAggregation::SimpleWirelessAggregation ()
+  : TestCase ("Check that queued packets are sent in aggregate frames and received one by one")
+{
+}
+
+SimpleWirelessAggregation::~SimpleWirelessAggregation ()
+{
+}
+
+void
+SimpleWirelessAggregation::RunScenario (uint32_t maxPackets, uint32_t maxBytes, bool split)
+{
+  m_txTimes.clear ();
+  m_received.clear ();
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (3, 10));
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      devices[i]->SetDataRate (DataRate ("16Mbps"));
+      devices[i]->SetAttribute ("AggregationMaxPackets", UintegerValue (maxPackets));
+      devices[i]->SetAttribute ("AggregationMaxBytes", UintegerValue (maxBytes));
+      devices[i]->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+      RecordReceptions (devices[i], i, &m_received, true);
+    }
+  devices[0]->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&RecordTransmission, &m_txTimes));
+
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      Address to = devices[split && i >= 3 ? 2 : 1]->GetAddress ();
+      Simulator::Schedule (Seconds (1), &SendPacket, devices[0], to, 1000 + i);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+SimpleWirelessAggregation::DoRun (void)
+{
+  // The first frame goes at once, alone; the other four wait and go together
+  RunScenario (8, 65535, false);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 2, "Queued packets not aggregated");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 5, "Aggregated packets not all received");
+  for (uint32_t i = 0; i < m_received.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_received[i].size, 1000 + i, "Packet received out of order or with the wrong size");
+    }
+
+  // Limited to two packets, by count or by bytes
+  RunScenario (2, 65535, false);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 3, "Aggregate not limited by the packet count");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 5, "Aggregated packets not all received");
+  RunScenario (8, 2 * (1004 + 6), false);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 3, "Aggregate not limited by the bytes");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 5, "Aggregated packets not all received");
+
+  // An aggregate has a single destination
+  RunScenario (8, 65535, true);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 3, "Packets for two destinations aggregated");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 5, "Aggregated packets not all received");
+
+  // Disabled by default
+  RunScenario (1, 65535, false);
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 5, "Packets aggregated with aggregation disabled");
+}
+
+class SimpleWirelessBackpressure : public TestCase
+{
+public:
+  SimpleWirelessBackpressure ();
+  virtual ~SimpleWirelessBackpressure ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send six 1000 byte frames at once through a four packet queue
+   */
+  void RunScenario (double lowWatermark);
+  static void Send (Ptr<SimpleWirelessNetDevice> device, Address to, std::vector<bool> *results);
+  static void Transmit (Ptr<NetDeviceQueue> txQueue, std::vector<bool> *stopped, Ptr<const Packet> p,
+                        Mac48Address from, Mac48Address to, uint16_t proto);
+
+  std::vector<bool> m_sendResults;
+  std::vector<bool> m_stoppedAtTx;
+};
+
+SimpleWirelessBackpressure::SimpleWirelessBackpressure ()
+  : TestCase ("Check that the transmit queue is stopped and woken at the watermarks and that drops are reported")
+{
+}
+
+SimpleWirelessBackpressure::~SimpleWirelessBackpressure ()
+{
+}
+
+void
+SimpleWirelessBackpressure::Send (Ptr<SimpleWirelessNetDevice> device, Address to, std::vector<bool> *results)
+{
+  results->push_back (device->Send (Create<Packet> (1000), to, 1));
+}
+
+void
+SimpleWirelessBackpressure::Transmit (Ptr<NetDeviceQueue> txQueue, std::vector<bool> *stopped, Ptr<const Packet> p,
+                                      Mac48Address from, Mac48Address to, uint16_t proto)
+{
+  stopped->push_back (txQueue->IsStopped ());
+}
+
+void
+SimpleWirelessBackpressure::RunScenario (double lowWatermark)
+{
+  m_sendResults.clear ();
+  m_stoppedAtTx.clear ();
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (2, 10));
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      devices[i]->SetDataRate (DataRate ("16Mbps"));
+      devices[i]->SetAttribute ("TxQueueLowWatermark", DoubleValue (lowWatermark));
+      Ptr<DropTailQueue<Packet> > queue = CreateObject<DropTailQueue<Packet> > ();
+      queue->SetMaxSize (QueueSize ("4p"));
+      devices[i]->SetQueue (queue);
+    }
+  Ptr<NetDeviceQueueInterface> queueInterface = devices[0]->GetObject<NetDeviceQueueInterface> ();
+  NS_TEST_ASSERT_MSG_NE (queueInterface, nullptr, "No queue interface aggregated to the device");
+  devices[0]->TraceConnectWithoutContext ("PhyTxBegin",
+                                          MakeBoundCallback (&SimpleWirelessBackpressure::Transmit,
+                                                             queueInterface->GetTxQueue (0), &m_stoppedAtTx));
+
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      Simulator::Schedule (Seconds (1), &SimpleWirelessBackpressure::Send, devices[0],
+                           devices[1]->GetAddress (), &m_sendResults);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+SimpleWirelessBackpressure::DoRun (void)
+{
+  // The first frame goes at once; the next four fill the queue, which stops
+  // it, and the last one is dropped
+  RunScenario (0.5);
+  std::vector<bool> sent = {true, true, true, true, true, false};
+  NS_TEST_ASSERT_MSG_EQ ((m_sendResults == sent), true, "Dropped packet not reported by Send");
+  // Woken once fewer than two packets are left
+  std::vector<bool> stopped = {false, true, true, true, false};
+  NS_TEST_ASSERT_MSG_EQ ((m_stoppedAtTx == stopped), true, "Transmit queue not stopped or woken at the watermarks");
+
+  // Woken as soon as the queue is not full
+  RunScenario (1.0);
+  NS_TEST_ASSERT_MSG_EQ ((m_sendResults == sent), true, "Dropped packet not reported by Send");
+  stopped = {false, true, false, false, false};
+  NS_TEST_ASSERT_MSG_EQ ((m_stoppedAtTx == stopped), true, "Transmit queue not woken when no longer full");
+}
+
+class SimpleWirelessTxQueues : public TestCase
+{
+public:
+  SimpleWirelessTxQueues ();
+  virtual ~SimpleWirelessTxQueues ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * \return the transmit queue the queue interface selects for a packet
+   * with a socket priority
+   */
+  std::size_t Select (Ptr<NetDeviceQueueInterface> queueInterface, uint8_t priority);
+};
+
+SimpleWirelessTxQueues::SimpleWirelessTxQueues ()
+  : TestCase ("Check that the queue interface has a transmit queue per sub-queue of a multi-queue")
+{
+}
+
+SimpleWirelessTxQueues::~SimpleWirelessTxQueues ()
+{
+}
+
+std::size_t
+SimpleWirelessTxQueues::Select (Ptr<NetDeviceQueueInterface> queueInterface, uint8_t priority)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  SocketPriorityTag priorityTag;
+  priorityTag.SetPriority (priority);
+  p->AddPacketTag (priorityTag);
+  return queueInterface->GetSelectQueueCallback () (Create<QueueItem> (p));
+}
+
+void
+SimpleWirelessTxQueues::DoRun (void)
+{
+  Ptr<SimpleWirelessNetDevice> device = CreateObject<SimpleWirelessNetDevice> ();
+  device->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+  Ptr<NetDeviceQueueInterface> queueInterface = device->GetObject<NetDeviceQueueInterface> ();
+  NS_TEST_ASSERT_MSG_NE (queueInterface, nullptr, "No queue interface aggregated to the device");
+  NS_TEST_ASSERT_MSG_EQ (queueInterface->GetNTxQueues (), 1, "One transmit queue expected with a drop tail queue");
+
+  // One transmit queue per access category, in the sub-queue order
+  device = CreateObject<SimpleWirelessNetDevice> ();
+  device->SetQueue (CreateObject<SimpleWirelessMultiQueue> ());
+  queueInterface = device->GetObject<NetDeviceQueueInterface> ();
+  NS_TEST_ASSERT_MSG_NE (queueInterface, nullptr, "No queue interface aggregated to the device");
+  NS_TEST_ASSERT_MSG_EQ (queueInterface->GetNTxQueues (), 4, "One transmit queue per access category expected");
+  NS_TEST_ASSERT_MSG_EQ (Select (queueInterface, 6), 0, "Priority 6 not in the VO transmit queue");
+  NS_TEST_ASSERT_MSG_EQ (Select (queueInterface, 5), 1, "Priority 5 not in the VI transmit queue");
+  NS_TEST_ASSERT_MSG_EQ (Select (queueInterface, 0), 2, "Priority 0 not in the BE transmit queue");
+  NS_TEST_ASSERT_MSG_EQ (Select (queueInterface, 1), 3, "Priority 1 not in the BK transmit queue");
+
+  // Without a TxQueue, the interface is aggregated when the device is initialized
+  device = CreateObject<SimpleWirelessNetDevice> ();
+  device->Initialize ();
+  queueInterface = device->GetObject<NetDeviceQueueInterface> ();
+  NS_TEST_ASSERT_MSG_NE (queueInterface, nullptr, "No queue interface aggregated to the device");
+  NS_TEST_ASSERT_MSG_EQ (queueInterface->GetNTxQueues (), 1, "One transmit queue expected without a TxQueue");
+  Simulator::Destroy ();
+}
+
+class SimpleWirelessArq : public TestCase
+{
+public:
+  SimpleWirelessArq ();
+  virtual ~SimpleWirelessArq ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send 1000 byte frames at once from one device to another, with ARQ
+   *
+   * \param rxErrors the indices of the receive error model draws of the
+   * receiver that fail (two per frame received, one per frame lost)
+   * \param ackErrors the indices of the ACKs lost at the sender
+   */
+  void RunScenario (uint32_t nPackets, uint32_t windowSize, uint32_t retryLimit,
+                    std::list<uint32_t> rxErrors, std::list<uint32_t> ackErrors);
+  static void Retries (std::vector<uint32_t> *retries, Ptr<const Packet> p, uint32_t n);
+
+  std::vector<Time> m_txTimes;
+  std::vector<uint32_t> m_retries;
+  uint32_t m_txDrops;
+  std::vector<Reception> m_received;
+  uint32_t m_duplicates;
+};
+
+SimpleWirelessArq::SimpleWirelessArq ()
+  : TestCase ("Check that ARQ frames are retransmitted until acknowledged and that duplicates are discarded")
+{
+}
+
+SimpleWirelessArq::~SimpleWirelessArq ()
+{
+}
+
+void
+SimpleWirelessArq::Retries (std::vector<uint32_t> *retries, Ptr<const Packet> p, uint32_t n)
+{
+  retries->push_back (n);
+}
+
+void
+SimpleWirelessArq::RunScenario (uint32_t nPackets, uint32_t windowSize, uint32_t retryLimit,
+                                std::list<uint32_t> rxErrors, std::list<uint32_t> ackErrors)
+{
+  m_txTimes.clear ();
+  m_retries.clear ();
+  m_txDrops = 0;
+  m_received.clear ();
+  m_duplicates = 0;
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (2, 10));
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      devices[i]->SetDataRate (DataRate ("16Mbps"));
+      devices[i]->SetAttribute ("Arq", BooleanValue (true));
+      devices[i]->SetAttribute ("ArqWindowSize", UintegerValue (windowSize));
+      devices[i]->SetAttribute ("ArqRetryLimit", UintegerValue (retryLimit));
+      devices[i]->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+      Ptr<ReceiveListErrorModel> errorModel = CreateObject<ReceiveListErrorModel> ();
+      errorModel->SetList (i == 0 ? ackErrors : rxErrors);
+      devices[i]->SetReceiveErrorModel (errorModel);
+    }
+  devices[0]->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&RecordTransmission, &m_txTimes));
+  devices[0]->TraceConnectWithoutContext ("ArqRetries", MakeBoundCallback (&SimpleWirelessArq::Retries, &m_retries));
+  devices[0]->TraceConnectWithoutContext ("MacTxDrop", MakeBoundCallback (&CountPackets, &m_txDrops));
+  RecordReceptions (devices[1], 1, &m_received, true);
+  devices[1]->TraceConnectWithoutContext ("MacDrop", MakeBoundCallback (&CountPackets, &m_duplicates));
+
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      Simulator::Schedule (Seconds (1), &SendPacket, devices[0], devices[1]->GetAddress (), 1000 + i);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+SimpleWirelessArq::DoRun (void)
+{
+  // Stop-and-wait: the lost first frame is retransmitted before the others go
+  RunScenario (3, 1, 7, {0}, {});
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 4, "Lost frame not retransmitted once");
+  std::vector<uint32_t> sizes = {1000, 1001, 1002};
+  NS_TEST_ASSERT_MSG_EQ ((GetSizes (m_received) == sizes), true, "Frames not all received, in order");
+  std::vector<uint32_t> retries = {1, 0, 0};
+  NS_TEST_ASSERT_MSG_EQ ((m_retries == retries), true, "Wrong retry counts");
+
+  // Selective repeat: the others go on while the first one waits for its
+  // ACK, and only the lost frame is retransmitted
+  RunScenario (3, 4, 7, {0}, {});
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 4, "Frames other than the lost one retransmitted");
+  sizes = {1001, 1002, 1000};
+  NS_TEST_ASSERT_MSG_EQ ((GetSizes (m_received) == sizes), true, "Frames not sent past the unacknowledged one");
+  retries = {0, 0, 1};
+  NS_TEST_ASSERT_MSG_EQ ((m_retries == retries), true, "Wrong retry counts");
+
+  // A lost ACK: the retransmission is acknowledged but not passed up again
+  RunScenario (3, 1, 7, {}, {0});
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 4, "Frame not retransmitted after its ACK was lost");
+  sizes = {1000, 1001, 1002};
+  NS_TEST_ASSERT_MSG_EQ ((GetSizes (m_received) == sizes), true, "Duplicate frame passed up");
+  NS_TEST_ASSERT_MSG_EQ (m_duplicates, 1, "Duplicate frame not dropped");
+  retries = {1, 0, 0};
+  NS_TEST_ASSERT_MSG_EQ ((m_retries == retries), true, "Wrong retry counts");
+
+  // Dropped after the retry limit, and the next frame goes
+  RunScenario (2, 1, 2, {0, 1, 2}, {});
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 4, "Frame not dropped at the retry limit");
+  NS_TEST_ASSERT_MSG_EQ (m_txDrops, 1, "Drop at the retry limit not reported");
+  sizes = {1001};
+  NS_TEST_ASSERT_MSG_EQ ((GetSizes (m_received) == sizes), true, "Frame after the dropped one not received");
+  retries = {2, 0};
+  NS_TEST_ASSERT_MSG_EQ ((m_retries == retries), true, "Wrong retry counts");
+}
+
+class SimpleWirelessRateAdaptation : public TestCase
+{
+public:
+  SimpleWirelessRateAdaptation ();
+  virtual ~SimpleWirelessRateAdaptation ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Add to a rate manager three MCS, of 1, 6 and 24 Mbps, which need an
+   * SNR of 0, 10 and 30 dB
+   */
+  static void AddMcsTable (Ptr<SimpleWirelessRateManager> manager);
+  /**
+   * Send 1000 byte frames, one every interval, with stop-and-wait ARQ
+   * from one device to another 10 m away, without propagation loss and
+   * at an SNR of 20 dB
+   *
+   * \param manager the rate manager of the sender, without MCS; the
+   * receiver has an oracle with the same MCS
+   */
+  void RunScenario (Ptr<SimpleWirelessRateManager> manager, uint32_t nPackets, Time interval);
+  static void Transmit (std::vector<uint32_t> *mcs, Ptr<const Packet> p, Mac48Address from, Mac48Address to, uint16_t proto);
+
+  std::vector<uint32_t> m_txMcs;
+  std::vector<Reception> m_received;
+  Mac48Address m_receiver;
+  int64_t m_streams; //!< streams assigned by the sender
+};
+
+SimpleWirelessRateAdaptation::SimpleWirelessRateAdaptation ()
+  : TestCase ("Check the rate chosen by the oracle, ARF, AARF and Minstrel rate managers and its airtime")
+{
+}
+
+SimpleWirelessRateAdaptation::~SimpleWirelessRateAdaptation ()
+{
+}
+
+void
+SimpleWirelessRateAdaptation::AddMcsTable (Ptr<SimpleWirelessRateManager> manager)
+{
+  const char *rates[] = {"1Mbps", "6Mbps", "24Mbps"};
+  double thresholds[] = {0, 10, 30};
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<TableSnrPerErrorModel> perModel = CreateObject<TableSnrPerErrorModel> ();
+      perModel->AddValue (thresholds[i] - 1, 1);
+      perModel->AddValue (thresholds[i], 0);
+      manager->AddMcs (DataRate (rates[i]), perModel);
+    }
+}
+
+void
+SimpleWirelessRateAdaptation::Transmit (std::vector<uint32_t> *mcs, Ptr<const Packet> p, Mac48Address from, Mac48Address to, uint16_t proto)
+{
+  McsTag mcsTag;
+  if (p->PeekPacketTag (mcsTag))
+    {
+      mcs->push_back (mcsTag.GetMcs ());
+    }
+}
+
+void
+SimpleWirelessRateAdaptation::RunScenario (Ptr<SimpleWirelessRateManager> manager, uint32_t nPackets, Time interval)
+{
+  m_txMcs.clear ();
+  m_received.clear ();
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (2, 10));
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      // 16 dBm received, without a loss model
+      devices[i]->SetAttribute ("NoisePower", DoubleValue (-4));
+      devices[i]->SetAttribute ("Arq", BooleanValue (true));
+      devices[i]->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+      if (i == 1)
+        {
+          manager = CreateObject<OracleRateManager> ();
+        }
+      AddMcsTable (manager);
+      devices[i]->SetRateManager (manager);
+    }
+  m_streams = devices[0]->AssignStreams (1);
+  m_receiver = Mac48Address::ConvertFrom (devices[1]->GetAddress ());
+  devices[0]->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&SimpleWirelessRateAdaptation::Transmit, &m_txMcs));
+  RecordReceptions (devices[1], 1, &m_received, true);
+
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      Simulator::Schedule (Seconds (1) + interval * i, &SendPacket, devices[0], devices[1]->GetAddress (), 1000);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+SimpleWirelessRateAdaptation::DoRun (void)
+{
+  // The oracle knows the SNR from the ACK of the first frame, and then
+  // picks 6 Mbps, the fastest rate received at 20 dB
+  RunScenario (CreateObject<OracleRateManager> (), 2, Seconds (0));
+  std::vector<uint32_t> mcs = {0, 1};
+  NS_TEST_ASSERT_MSG_EQ ((m_txMcs == mcs), true, "Oracle did not move to the best rate");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 2, "Frames not received");
+  NS_TEST_ASSERT_MSG_EQ (m_streams, 1, "The oracle has no random variable");
+  // The airtime comes from the rate: 1003 bytes (with the ARQ header) at
+  // 1 Mbps, then the ACK (14 bytes at 1 Mbps) and 1003 bytes at 6 Mbps
+  NS_TEST_ASSERT_MSG_EQ_TOL ((m_received[0].time - Seconds (1)).GetMicroSeconds (), 8024, 1, "Wrong airtime at 1 Mbps");
+  NS_TEST_ASSERT_MSG_EQ_TOL ((m_received[1].time - m_received[0].time).GetMicroSeconds (), 112 + 1337, 1, "Wrong airtime at 6 Mbps");
+
+  // ARF moves up after 10 frames acknowledged in a row; the probe of
+  // 24 Mbps fails, and the frame goes again at 6 Mbps
+  Ptr<ArfRateManager> arf = CreateObject<ArfRateManager> ();
+  RunScenario (arf, 25, Seconds (0));
+  mcs.assign (10, 0);
+  mcs.insert (mcs.end (), 10, 1);
+  mcs.push_back (2);
+  mcs.insert (mcs.end (), 5, 1);
+  NS_TEST_ASSERT_MSG_EQ ((m_txMcs == mcs), true, "Wrong ARF rates");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 25, "Frames not all received");
+  NS_TEST_ASSERT_MSG_EQ (arf->GetSuccessThreshold (m_receiver), 10, "ARF changed its success threshold");
+
+  // AARF doubles the success threshold after the failed probe
+  arf = CreateObject<ArfRateManager> ();
+  arf->SetAttribute ("Adaptive", BooleanValue (true));
+  RunScenario (arf, 25, Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ ((m_txMcs == mcs), true, "Wrong AARF rates");
+  NS_TEST_ASSERT_MSG_EQ (arf->GetSuccessThreshold (m_receiver), 20,
+                         "AARF did not double its success threshold");
+
+  // Minstrel settles on 6 Mbps once its statistics are updated, and keeps
+  // sampling the other rates
+  Ptr<MinstrelRateManager> minstrel = CreateObject<MinstrelRateManager> ();
+  RunScenario (minstrel, 1000, MilliSeconds (2));
+  NS_TEST_ASSERT_MSG_EQ (m_streams, 2, "Device did not assign the stream of Minstrel");
+  NS_TEST_ASSERT_MSG_EQ_TOL (minstrel->GetSuccessProbability (m_receiver, 1), 1, 1e-9, "6 Mbps frames lost");
+  NS_TEST_ASSERT_MSG_EQ_TOL (minstrel->GetSuccessProbability (m_receiver, 2), 0, 1e-9, "24 Mbps frames received");
+  uint32_t best = std::count (m_txMcs.begin () + m_txMcs.size () / 2, m_txMcs.end (), 1u);
+  NS_TEST_ASSERT_MSG_GT (best, 0.8 * (m_txMcs.size () - m_txMcs.size () / 2), "Minstrel did not settle on 6 Mbps");
+  NS_TEST_ASSERT_MSG_GT (m_txMcs.size (), 1000, "Minstrel did not sample the other rates");
+
+  // The descriptor queue does not copy the packet of the upper layer; the
+  // MCS is tagged on the frame sent, not on that packet
+  m_txMcs.clear ();
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (2, 10));
+  devices[0]->SetAttribute ("TxDescriptorQueue", BooleanValue (true));
+  Ptr<SimpleWirelessRateManager> oracle = CreateObject<OracleRateManager> ();
+  AddMcsTable (oracle);
+  devices[0]->SetRateManager (oracle);
+  devices[0]->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&SimpleWirelessRateAdaptation::Transmit, &m_txMcs));
+  Ptr<Packet> packet = Create<Packet> (1000);
+  Simulator::Schedule (Seconds (1), &SimpleWirelessNetDevice::Send, devices[0], packet, devices[1]->GetAddress (), 1);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  NS_TEST_ASSERT_MSG_EQ (m_txMcs.size (), 1, "Frame sent without its MCS");
+  McsTag mcsTag;
+  NS_TEST_ASSERT_MSG_EQ (packet->PeekPacketTag (mcsTag), false, "MCS tagged on the packet of the upper layer");
+}
+
+class SimpleWirelessPcap : public TestCase
+{
+public:
+  SimpleWirelessPcap ();
+  virtual ~SimpleWirelessPcap ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send a 9000 byte packet with a capture file of the given snap length
+   * on the sender
+   *
+   * \param inclLen set to the length written to the file
+   * \param origLen set to the length of the packet sent
+   */
+  void RunScenario (uint32_t snapLen, uint32_t *inclLen, uint32_t *origLen);
+};
+
+SimpleWirelessPcap::SimpleWirelessPcap ()
+  : TestCase ("Check the length of the packets written by EnablePcapAll")
+{
+}
+
+SimpleWirelessPcap::~SimpleWirelessPcap ()
+{
+}
+
+void
+SimpleWirelessPcap::RunScenario (uint32_t snapLen, uint32_t *inclLen, uint32_t *origLen)
+{
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (2, 10));
+  std::string filename = CreateTempDirFilename ("simple-wireless-pcap.pcap");
+  if (snapLen)
+    {
+      devices[0]->SetAttribute ("PcapSnapLen", UintegerValue (snapLen));
+    }
+  devices[0]->EnablePcapAll (filename);
+  Simulator::Schedule (Seconds (1), &SendPacket, devices[0], devices[1]->GetAddress (), 9000);
+  Simulator::Run ();
+  // The file is closed when the devices are disposed of
+  Simulator::Destroy ();
+
+  PcapFile file;
+  file.Open (filename, std::ios::in);
+  NS_TEST_ASSERT_MSG_EQ (file.Fail (), false, "Capture file not written");
+  std::vector<uint8_t> data (0xffff + 14);
+  uint32_t tsSec, tsUsec, readLen;
+  file.Read (&data[0], data.size (), tsSec, tsUsec, *inclLen, *origLen, readLen);
+  NS_TEST_ASSERT_MSG_EQ (file.Fail (), false, "No packet in the capture file");
+  file.Close ();
+}
+
+void
+SimpleWirelessPcap::DoRun (void)
+{
+  // The default snap length keeps the whole packet and its 14 byte
+  // Ethernet header, more than the 8192 bytes a packet of 8178 bytes
+  // takes with it
+  uint32_t inclLen = 0;
+  uint32_t origLen = 0;
+  RunScenario (0, &inclLen, &origLen);
+  NS_TEST_ASSERT_MSG_EQ (origLen, 9014, "Wrong length of the packet captured");
+  NS_TEST_ASSERT_MSG_EQ (inclLen, 9014, "Packet truncated at the default snap length");
+
+  // A small snap length truncates the packet, and keeps its length
+  RunScenario (100, &inclLen, &origLen);
+  NS_TEST_ASSERT_MSG_EQ (origLen, 9014, "Wrong length of the truncated packet");
+  NS_TEST_ASSERT_MSG_EQ (inclLen, 100, "Packet not truncated at the snap length");
+}
+
+class SimpleWirelessMultiLink : public TestCase
+{
+public:
+  SimpleWirelessMultiLink ();
+  virtual ~SimpleWirelessMultiLink ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send four 1000 byte frames at once from one two-link device to
+   * another, with link 1 three times as fast as link 2
+   */
+  void RunScenario (Ptr<SimpleWirelessLinkSelector> selector);
+  static void LinkTx (std::vector<uint32_t> *linkTx, Ptr<const Packet> p, uint32_t link);
+
+  std::vector<uint32_t> m_linkTx;
+  std::vector<Reception> m_received;
+};
+
+SimpleWirelessMultiLink::SimpleWirelessMultiLink ()
+  : TestCase ("Check the link selection of the multi-link device")
+{
+}
+
+SimpleWirelessMultiLink::~SimpleWirelessMultiLink ()
+{
+}
+
+void
+SimpleWirelessMultiLink::LinkTx (std::vector<uint32_t> *linkTx, Ptr<const Packet> p, uint32_t link)
+{
+  (*linkTx)[link]++;
+}
+
+void
+SimpleWirelessMultiLink::RunScenario (Ptr<SimpleWirelessLinkSelector> selector)
+{
+  m_linkTx.assign (2, 0);
+  m_received.clear ();
+  Ptr<SimpleWirelessChannel> channels[2];
+  for (uint32_t l = 0; l < 2; l++)
+    {
+      channels[l] = CreateObject<SimpleWirelessChannel> ();
+      channels[l]->SetAttribute ("MaxRange", DoubleValue (100));
+    }
+
+  std::vector<Ptr<SimpleWirelessMldNetDevice> > devices;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<Node> node = CreateNode (Vector (10.0 * i, 0, 0));
+      Ptr<SimpleWirelessMldNetDevice> device = CreateObject<SimpleWirelessMldNetDevice> ();
+      device->SetAddress (Mac48Address::Allocate ());
+      for (uint32_t l = 0; l < 2; l++)
+        {
+          Ptr<SimpleWirelessNetDevice> link = CreateObject<SimpleWirelessNetDevice> ();
+          link->SetChannel (channels[l]);
+          link->SetDataRate (DataRate (l == 0 ? "48Mbps" : "16Mbps"));
+          link->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+          device->AddLink (link);
+        }
+      node->AddDevice (device);
+      devices.push_back (device);
+    }
+  devices[0]->SetLinkSelector (selector);
+  devices[0]->TraceConnectWithoutContext ("LinkTx", MakeBoundCallback (&SimpleWirelessMultiLink::LinkTx, &m_linkTx));
+  RecordReceptions (devices[1], 1, &m_received, true);
+
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Simulator::Schedule (Seconds (1), &SendPacket, devices[0], devices[1]->GetAddress (), 1000);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+SimpleWirelessMultiLink::DoRun (void)
+{
+  // All frames on the only link with a weight
+  Ptr<ProbabilisticLinkSelector> probabilistic = CreateObject<ProbabilisticLinkSelector> ();
+  probabilistic->SetWeights (std::vector<double> {1, 0});
+  RunScenario (probabilistic);
+  NS_TEST_ASSERT_MSG_EQ (m_linkTx[0], 4, "Frames not all sent on link 1");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 4, "Frames not received");
+
+  // The queues are kept even, whatever the data rates
+  RunScenario (CreateObject<ShortestQueueLinkSelector> ());
+  NS_TEST_ASSERT_MSG_EQ (m_linkTx[0], 2, "Shortest queue did not alternate links");
+  NS_TEST_ASSERT_MSG_EQ (m_linkTx[1], 2, "Shortest queue did not alternate links");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 4, "Frames not received");
+
+  // Link 1 finishes its third frame before link 2 finishes its first
+  RunScenario (CreateObject<EarliestCompletionLinkSelector> ());
+  NS_TEST_ASSERT_MSG_EQ (m_linkTx[0], 3, "Earliest completion did not favor the fast link");
+  NS_TEST_ASSERT_MSG_EQ (m_linkTx[1], 1, "Earliest completion did not favor the fast link");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 4, "Frames not received");
+}
+
+class SimpleWirelessContentionCount : public TestCase
+{
+public:
+  SimpleWirelessContentionCount ();
+  virtual ~SimpleWirelessContentionCount ();
+
+private:
+  virtual void DoRun (void);
+  static void RecordCount (Ptr<SimpleWirelessChannel> channel, Ptr<SimpleWirelessNetDevice> device, std::vector<uint32_t> *counts);
+};
+
+SimpleWirelessContentionCount::SimpleWirelessContentionCount ()
+  : TestCase ("Check the fixed contention neighbor counts kept by the channel")
+{
+}
+
+SimpleWirelessContentionCount::~SimpleWirelessContentionCount ()
+{
+}
+
+void
+SimpleWirelessContentionCount::RecordCount (Ptr<SimpleWirelessChannel> channel, Ptr<SimpleWirelessNetDevice> device, std::vector<uint32_t> *counts)
+{
+  counts->push_back (channel->GetContentionCount (device));
+}
+
+void
+SimpleWirelessContentionCount::DoRun (void)
+{
+  Ptr<SimpleWirelessChannel> channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  channel->EnableFixedContention ();
+  channel->SetFixedContentionRange (70);
+
+  // 5 nodes on a line, 30 m apart
+  std::vector<Ptr<SimpleWirelessNetDevice> > devices = CreateDevices (channel, LinePositions (5, 30));
+
+  // Available before anything is sent
+  NS_TEST_ASSERT_MSG_EQ (channel->GetContentionCount (devices[0]), 3, "Node 0 contends with nodes 1 and 2");
+  NS_TEST_ASSERT_MSG_EQ (channel->GetContentionCount (devices[2]), 5, "Node 2 contends with all nodes");
+  NS_TEST_ASSERT_MSG_EQ (channel->GetContentionCount (devices[4]), 3, "Node 4 contends with nodes 2 and 3");
+
+  // Follows course changes
+  devices[4]->GetNode ()->GetObject<MobilityModel> ()->SetPosition (Vector (10, 0, 0));
+  NS_TEST_ASSERT_MSG_EQ (channel->GetContentionCount (devices[0]), 4, "Node 4 moved next to node 0");
+  NS_TEST_ASSERT_MSG_EQ (channel->GetContentionCount (devices[3]), 3, "Node 4 moved away from node 3");
+  NS_TEST_ASSERT_MSG_EQ (channel->GetContentionCount (devices[4]), 4, "Node 4 contends with nodes 0, 1 and 2");
+
+  // and range changes
+  channel->SetFixedContentionRange (200);
+  NS_TEST_ASSERT_MSG_EQ (channel->GetContentionCount (devices[0]), 5, "All nodes within the new range");
+  Simulator::Destroy ();
+
+  // The same line of nodes, with STOCHASTIC links that are all down after
+  // about 10 us, node 0 sending to its directional neighbor node 1 only,
+  // and node 5 moving at -100 m/s from 250 m, which reports no course
+  // change. The counts stay geometric.
+  channel = CreateObject<SimpleWirelessChannel> ();
+  channel->SetAttribute ("MaxRange", DoubleValue (100));
+  channel->setErrorModelType (STOCHASTIC);
+  channel->SetAttribute ("AvgLinkUpDuration", TimeValue (MicroSeconds (10)));
+  channel->SetAttribute ("AvgLinkDownDuration", TimeValue (Seconds (1000)));
+  channel->EnableFixedContention ();
+  channel->SetFixedContentionRange (70);
+  devices = CreateDevices (channel, LinePositions (5, 30));
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<ConstantVelocityMobilityModel> moving = CreateObject<ConstantVelocityMobilityModel> ();
+  moving->SetPosition (Vector (250, 0, 0));
+  moving->SetVelocity (Vector (-100, 0, 0));
+  node->AggregateObject (moving);
+  devices.push_back (CreateDevice (channel, node));
+  devices[0]->SetAttribute ("FixedNeighborListEnabled", BooleanValue (true));
+  devices[0]->AddDirectionalNeighbor (devices[1]->GetNode ()->GetId (), Mac48Address::ConvertFrom (devices[1]->GetAddress ()));
+  channel->InitStochasticModel ();
+
+  // At 1 s node 5 is at 150 m, and at 1.5 s at 100 m
+  std::vector<uint32_t> counts;
+  Simulator::Schedule (Seconds (1), &SendPacket, devices[0], devices[0]->GetBroadcast (), 100);
+  Simulator::Schedule (Seconds (1), &SendPacket, devices[2], devices[2]->GetBroadcast (), 100);
+  uint32_t order[] = {0, 2, 4, 5, 4};
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      Simulator::Schedule (Seconds (1), &SimpleWirelessContentionCount::RecordCount, channel, devices[order[i]], &counts);
+    }
+  Simulator::Schedule (Seconds (1.5), &SimpleWirelessContentionCount::RecordCount, channel, devices[2], &counts);
+  Simulator::Schedule (Seconds (1.5), &SimpleWirelessContentionCount::RecordCount, channel, devices[4], &counts);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  std::vector<uint32_t> expected = {3, 5, 4, 3, 4, 6, 4};
+  NS_TEST_ASSERT_MSG_EQ ((counts == expected), true, "Contention counts changed");
+}
+
 class SimpleWirelessTestSuite : public TestSuite
 {
 public:
@@ -149,6 +2336,26 @@ SimpleWirelessTestSuite::SimpleWirelessTestSuite ()
 {
   AddTestCase (new SimpleWirelessSnrPerMethods, TestCase::QUICK);
   AddTestCase (new SimpleWirelessTableModel, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessPerCurve, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessStochastic, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessStochasticCatchUp, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessSpatialIndex, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessNodeDevices, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessBatchDelivery, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessContentionCount, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessDescriptorQueue, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessDirectionalNeighbors, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessSlottedAloha, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessDcf, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessMultiLink, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessAggregation, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessMultiQueueTest, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessCoDel, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessBackpressure, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessTxQueues, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessArq, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessRateAdaptation, TestCase::QUICK);
+  AddTestCase (new SimpleWirelessPcap, TestCase::QUICK);
 }
 
 static SimpleWirelessTestSuite simpleWirelessTestSuite;